@@ -13,7 +13,14 @@
 #endif
 
 /* helper to write a little-endian 16-bit number portably */
-#define write_num(fd, n) write((fd), (uint8_t []) {(n) & 0xFF, (n) >> 8}, 2)
+#define write_num(gif, n) put_bytes((gif), (uint8_t []) {(n) & 0xFF, (n) >> 8}, 2)
+
+/* output is collected in memory and written out in blocks this large */
+#define FLUSH_SIZE 0x10000
+
+/* LZW hash table size, a power of two over twice the 0x1000 codes */
+#define LZW_HASH_BITS 13
+#define LZW_HASH_SIZE (1 << LZW_HASH_BITS)
 
 static uint8_t vga[0x30] = {
     0x00, 0x00, 0x00,
@@ -34,40 +41,33 @@ static uint8_t vga[0x30] = {
     0xFF, 0xFF, 0xFF,
 };
 
-struct Node {
-    uint16_t key;
-    struct Node *children[];
-};
-typedef struct Node Node;
-
-static Node *
-new_node(uint16_t key, int degree)
+static void
+flush_out(ge_GIF *gif)
 {
-    Node *node = calloc(1, sizeof(*node) + degree * sizeof(Node *));
-    if (node)
-        node->key = key;
-    return node;
-}
+    size_t done = 0;
+    ssize_t n;
 
-static Node *
-new_trie(int degree, int *nkeys)
-{
-    Node *root = new_node(0, degree);
-    /* Create nodes for single pixels. */
-    for (*nkeys = 0; *nkeys < degree; (*nkeys)++)
-        root->children[*nkeys] = new_node(*nkeys, degree);
-    *nkeys += 2; /* skip clear code and stop code */
-    return root;
+    while (done < gif->out_len) {
+        n = write(gif->fd, gif->out + done, gif->out_len - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    gif->out_len = 0;
 }
 
 static void
-del_trie(Node *root, int degree)
+put_bytes(ge_GIF *gif, const void *data, size_t len)
 {
-    if (!root)
-        return;
-    for (int i = 0; i < degree; i++)
-        del_trie(root->children[i], degree);
-    free(root);
+    if (gif->out_len + len > gif->out_size) {
+        flush_out(gif);
+        if (len > gif->out_size) {
+            write(gif->fd, data, len);
+            return;
+        }
+    }
+    memcpy(gif->out + gif->out_len, data, len);
+    gif->out_len += len;
 }
 
 static void put_loop(ge_GIF *gif, uint16_t loop);
@@ -86,27 +86,40 @@ ge_new_gif(
     gif->depth = depth > 1 ? depth : 2;
     gif->frame = (uint8_t *) &gif[1];
     gif->back = &gif->frame[width*height];
+    gif->lzw_keys = malloc(LZW_HASH_SIZE * sizeof(*gif->lzw_keys));
+    gif->lzw_codes = malloc(LZW_HASH_SIZE * sizeof(*gif->lzw_codes));
+    gif->out_size = FLUSH_SIZE;
+    gif->out = malloc(gif->out_size);
+    gif->local = malloc(3 << gif->depth);
+    if (!gif->lzw_keys || !gif->lzw_codes || !gif->out || !gif->local)
+        goto no_fd;
+    if (palette) {
+        gif->palette = calloc(1, 3 << gif->depth);
+        if (!gif->palette)
+            goto no_fd;
+        memcpy(gif->palette, palette, 3 << depth);
+    }
     gif->fd = creat(fname, 0666);
     if (gif->fd == -1)
         goto no_fd;
 #ifdef _WIN32
     setmode(gif->fd, O_BINARY);
 #endif
-    write(gif->fd, "GIF89a", 6);
-    write_num(gif->fd, width);
-    write_num(gif->fd, height);
-    write(gif->fd, (uint8_t []) {0xF0 | (depth-1), 0x00, 0x00}, 3);
+    put_bytes(gif, "GIF89a", 6);
+    write_num(gif, width);
+    write_num(gif, height);
+    put_bytes(gif, (uint8_t []) {0xF0 | (depth-1), 0x00, 0x00}, 3);
     if (palette) {
-        write(gif->fd, palette, 3 << depth);
+        put_bytes(gif, palette, 3 << depth);
     } else if (depth <= 4) {
-        write(gif->fd, vga, 3 << depth);
+        put_bytes(gif, vga, 3 << depth);
     } else {
-        write(gif->fd, vga, sizeof(vga));
+        put_bytes(gif, vga, sizeof(vga));
         i = 0x10;
         for (r = 0; r < 6; r++) {
             for (g = 0; g < 6; g++) {
                 for (b = 0; b < 6; b++) {
-                    write(gif->fd, (uint8_t []) {r*51, g*51, b*51}, 3);
+                    put_bytes(gif, (uint8_t []) {r*51, g*51, b*51}, 3);
                     if (++i == 1 << depth)
                         goto done_gct;
                 }
@@ -114,7 +127,7 @@ ge_new_gif(
         }
         for (i = 1; i <= 24; i++) {
             v = i * 0xFF / 25;
-            write(gif->fd, (uint8_t []) {v, v, v}, 3);
+            put_bytes(gif, (uint8_t []) {v, v, v}, 3);
         }
     }
 done_gct:
@@ -122,6 +135,11 @@ done_gct:
         put_loop(gif, (uint16_t) loop);
     return gif;
 no_fd:
+    free(gif->lzw_keys);
+    free(gif->lzw_codes);
+    free(gif->out);
+    free(gif->local);
+    free(gif->palette);
     free(gif);
 no_gif:
     return NULL;
@@ -130,11 +148,11 @@ no_gif:
 static void
 put_loop(ge_GIF *gif, uint16_t loop)
 {
-    write(gif->fd, (uint8_t []) {'!', 0xFF, 0x0B}, 3);
-    write(gif->fd, "NETSCAPE2.0", 11);
-    write(gif->fd, (uint8_t []) {0x03, 0x01}, 2);
-    write_num(gif->fd, loop);
-    write(gif->fd, "\0", 1);
+    put_bytes(gif, (uint8_t []) {'!', 0xFF, 0x0B}, 3);
+    put_bytes(gif, "NETSCAPE2.0", 11);
+    put_bytes(gif, (uint8_t []) {0x03, 0x01}, 2);
+    write_num(gif, loop);
+    put_bytes(gif, "\0", 1);
 }
 
 /* Add packed key to buffer, updating offset and partial.
@@ -151,8 +169,8 @@ put_key(ge_GIF *gif, uint16_t key, int key_size)
     while (bits_to_write >= 8) {
         gif->buffer[byte_offset++] = gif->partial & 0xFF;
         if (byte_offset == 0xFF) {
-            write(gif->fd, "\xFF", 1);
-            write(gif->fd, gif->buffer, 0xFF);
+            put_bytes(gif, "\xFF", 1);
+            put_bytes(gif, gif->buffer, 0xFF);
             byte_offset = 0;
         }
         gif->partial >>= 8;
@@ -168,75 +186,110 @@ end_key(ge_GIF *gif)
     byte_offset = gif->offset / 8;
     if (gif->offset % 8)
         gif->buffer[byte_offset++] = gif->partial & 0xFF;
-    write(gif->fd, (uint8_t []) {byte_offset}, 1);
-    write(gif->fd, gif->buffer, byte_offset);
-    write(gif->fd, "\0", 1);
+    put_bytes(gif, (uint8_t []) {byte_offset}, 1);
+    put_bytes(gif, gif->buffer, byte_offset);
+    put_bytes(gif, "\0", 1);
     gif->offset = gif->partial = 0;
 }
 
+/* Look up the code for a string: a known prefix followed by a pixel.
+ * Returns the slot that holds it, or the empty slot to put it in. */
+static int
+lzw_slot(ge_GIF *gif, uint32_t key)
+{
+    int slot = (key * 2654435761U) >> (32 - LZW_HASH_BITS);
+    while (gif->lzw_keys[slot] && gif->lzw_keys[slot] != key)
+        slot = (slot + 1) & (LZW_HASH_SIZE - 1);
+    return slot;
+}
+
 static void
 put_image(ge_GIF *gif, uint16_t w, uint16_t h, uint16_t x, uint16_t y)
 {
-    int nkeys, key_size, i, j;
-    Node *node, *child, *root;
+    int nkeys, key_size, i, j, slot;
     int degree = 1 << gif->depth;
+    int prefix = -1;
+    uint32_t key;
 
-    write(gif->fd, ",", 1);
-    write_num(gif->fd, x);
-    write_num(gif->fd, y);
-    write_num(gif->fd, w);
-    write_num(gif->fd, h);
-    write(gif->fd, (uint8_t []) {0x00, gif->depth}, 2);
-    root = node = new_trie(degree, &nkeys);
+    put_bytes(gif, ",", 1);
+    write_num(gif, x);
+    write_num(gif, y);
+    write_num(gif, w);
+    write_num(gif, h);
+    if (gif->has_local) {
+        put_bytes(gif, (uint8_t []) {0x80 | (gif->depth-1)}, 1);
+        put_bytes(gif, gif->local, 3 << gif->depth);
+    } else {
+        put_bytes(gif, (uint8_t []) {0x00}, 1);
+    }
+    put_bytes(gif, (uint8_t []) {gif->depth}, 1);
+    /* codes for single pixels are implicit; skip clear and stop code */
+    memset(gif->lzw_keys, 0, LZW_HASH_SIZE * sizeof(*gif->lzw_keys));
+    nkeys = degree + 2;
     key_size = gif->depth + 1;
     put_key(gif, degree, key_size); /* clear code */
     for (i = y; i < y+h; i++) {
         for (j = x; j < x+w; j++) {
             uint8_t pixel = gif->frame[i*gif->w+j] & (degree - 1);
-            child = node->children[pixel];
-            if (child) {
-                node = child;
+            if (prefix < 0) {
+                prefix = pixel;
+                continue;
+            }
+            /* keys are offset by one so that 0 marks an empty slot */
+            key = ((uint32_t) prefix << 8 | pixel) + 1;
+            slot = lzw_slot(gif, key);
+            if (gif->lzw_keys[slot]) {
+                prefix = gif->lzw_codes[slot];
+                continue;
+            }
+            put_key(gif, prefix, key_size);
+            if (nkeys < 0x1000) {
+                if (nkeys == (1 << key_size))
+                    key_size++;
+                gif->lzw_keys[slot] = key;
+                gif->lzw_codes[slot] = nkeys++;
             } else {
-                put_key(gif, node->key, key_size);
-                if (nkeys < 0x1000) {
-                    if (nkeys == (1 << key_size))
-                        key_size++;
-                    node->children[pixel] = new_node(nkeys++, degree);
-                } else {
-                    put_key(gif, degree, key_size); /* clear code */
-                    del_trie(root, degree);
-                    root = node = new_trie(degree, &nkeys);
-                    key_size = gif->depth + 1;
-                }
-                node = root->children[pixel];
+                put_key(gif, degree, key_size); /* clear code */
+                memset(gif->lzw_keys, 0,
+                       LZW_HASH_SIZE * sizeof(*gif->lzw_keys));
+                nkeys = degree + 2;
+                key_size = gif->depth + 1;
             }
+            prefix = pixel;
         }
     }
-    put_key(gif, node->key, key_size);
+    put_key(gif, prefix, key_size);
     put_key(gif, degree + 1, key_size); /* stop code */
     end_key(gif);
-    del_trie(root, degree);
 }
 
+/* Find the part of the rectangle given in x, y, w and h that differs
+ * from the last frame. Pixels outside of it must not have changed. */
 static int
 get_bbox(ge_GIF *gif, uint16_t *w, uint16_t *h, uint16_t *x, uint16_t *y)
 {
-    int i, j, k;
+    int i, j;
     int left, right, top, bottom;
-    left = gif->w; right = 0;
-    top = gif->h; bottom = 0;
-    k = 0;
-    for (i = 0; i < gif->h; i++) {
-        for (j = 0; j < gif->w; j++, k++) {
-            if (gif->frame[k] != gif->back[k]) {
-                if (j < left)   left    = j;
-                if (j > right)  right   = j;
-                if (i < top)    top     = i;
-                if (i > bottom) bottom  = i;
-            }
-        }
+    int x0 = *x, x1 = *x + *w, y1 = *y + *h;
+    const uint8_t *frame, *back;
+    left = x1; right = x0;
+    top = y1; bottom = 0;
+    for (i = *y; i < y1; i++) {
+        frame = &gif->frame[i*gif->w];
+        back = &gif->back[i*gif->w];
+        /* most rows are the same as in the last frame */
+        if (!memcmp(&frame[x0], &back[x0], x1 - x0))
+            continue;
+        for (j = x0; j < left && frame[j] == back[j]; j++)
+            ;
+        if (j < left)   left    = j;
+        for (j = x1 - 1; j > right && frame[j] == back[j]; j--)
+            ;
+        if (j > right)  right   = j;
+        if (i < top)    top     = i;
+        bottom = i;
     }
-    if (left != gif->w && top != gif->h) {
+    if (left != x1 && top != y1) {
         *x = left; *y = top;
         *w = right - left + 1;
         *h = bottom - top + 1;
@@ -249,24 +302,39 @@ get_bbox(ge_GIF *gif, uint16_t *w, uint16_t *h, uint16_t *x, uint16_t *y)
 static void
 set_delay(ge_GIF *gif, uint16_t d)
 {
-    write(gif->fd, (uint8_t []) {'!', 0xF9, 0x04, 0x04}, 4);
-    write_num(gif->fd, d);
-    write(gif->fd, "\0\0", 2);
+    put_bytes(gif, (uint8_t []) {'!', 0xF9, 0x04, 0x04}, 4);
+    write_num(gif, d);
+    put_bytes(gif, "\0\0", 2);
 }
 
 void
 ge_add_frame(ge_GIF *gif, uint16_t delay)
 {
-    uint16_t w, h, x, y;
+    ge_add_frame_rect(gif, delay, 0, 0, gif->w, gif->h);
+}
+
+/* Add a frame that differs from the last one only inside the given
+ * rectangle, which saves looking for changes elsewhere. */
+void
+ge_add_frame_rect(
+    ge_GIF *gif, uint16_t delay,
+    uint16_t x, uint16_t y, uint16_t w, uint16_t h
+)
+{
     uint8_t *tmp;
 
+    if (x > gif->w) x = gif->w;
+    if (y > gif->h) y = gif->h;
+    if (w > gif->w - x) w = gif->w - x;
+    if (h > gif->h - y) h = gif->h - y;
     if (delay)
         set_delay(gif, delay);
-    if (gif->nframes == 0) {
+    if (gif->nframes == 0 || gif->redraw) {
         w = gif->w;
         h = gif->h;
         x = y = 0;
-    } else if (!get_bbox(gif, &w, &h, &x, &y)) {
+        gif->redraw = 0;
+    } else if (!w || !h || !get_bbox(gif, &w, &h, &x, &y)) {
         /* image's not changed; save one pixel just to add delay */
         w = h = 1;
         x = y = 0;
@@ -278,10 +346,36 @@ ge_add_frame(ge_GIF *gif, uint16_t delay)
     gif->frame = tmp;
 }
 
+/* Use another palette from the next frame on. Frames drawn with a
+ * palette other than the global one carry it as a local color table,
+ * and a change of palette redraws the whole image. */
+void
+ge_set_palette(ge_GIF *gif, uint8_t *palette)
+{
+    int size = 3 << gif->depth;
+
+    if (gif->palette && !memcmp(palette, gif->palette, size)) {
+        if (gif->has_local) {
+            gif->has_local = 0;
+            gif->redraw = 1;
+        }
+    } else if (!gif->has_local || memcmp(palette, gif->local, size)) {
+        memcpy(gif->local, palette, size);
+        gif->has_local = 1;
+        gif->redraw = 1;
+    }
+}
+
 void
 ge_close_gif(ge_GIF* gif)
 {
-    write(gif->fd, ";", 1);
+    put_bytes(gif, ";", 1);
+    flush_out(gif);
     close(gif->fd);
+    free(gif->lzw_keys);
+    free(gif->lzw_codes);
+    free(gif->out);
+    free(gif->local);
+    free(gif->palette);
     free(gif);
 }
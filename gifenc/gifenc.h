@@ -1,6 +1,7 @@
 #ifndef GIFENC_H
 #define GIFENC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct ge_GIF {
@@ -10,8 +11,19 @@ typedef struct ge_GIF {
     int offset;
     int nframes;
     uint8_t *frame, *back;
+    /* global color table, or NULL for the default one */
+    uint8_t *palette;
+    /* local color table for frames that use another palette */
+    uint8_t *local;
+    int has_local, redraw;
     uint32_t partial;
     uint8_t buffer[0xFF];
+    /* LZW dictionary, a hash table of (prefix, pixel) -> code */
+    uint32_t *lzw_keys;
+    uint16_t *lzw_codes;
+    /* output not yet written to fd */
+    uint8_t *out;
+    size_t out_len, out_size;
 } ge_GIF;
 
 ge_GIF *ge_new_gif(
@@ -19,6 +31,11 @@ ge_GIF *ge_new_gif(
     uint8_t *palette, int depth, int loop
 );
 void ge_add_frame(ge_GIF *gif, uint16_t delay);
+void ge_add_frame_rect(
+    ge_GIF *gif, uint16_t delay,
+    uint16_t x, uint16_t y, uint16_t w, uint16_t h
+);
+void ge_set_palette(ge_GIF *gif, uint8_t *palette);
 void ge_close_gif(ge_GIF* gif);
 
 #endif /* GIFENC_H */
@@ -222,6 +222,15 @@ extern DECLSPEC void SDLCALL Mix_SetPostMix(void (SDLCALL *mix_func)(void *udata
  */
 extern DECLSPEC void SDLCALL Mix_HookMusic(void (SDLCALL *mix_func)(void *udata, Uint8 *stream, int len), void *arg);
 
+/* Pause or resume the audio device. */
+extern DECLSPEC void SDLCALL Mix_PauseAudio(int pause_on);
+
+/* Mix the next 'len' bytes of output into 'stream', for rendering audio
+   offline. The audio device should be paused so that it doesn't take its
+   own share of the output.
+ */
+extern DECLSPEC void SDLCALL Mix_MixAudio(Uint8 *stream, int len);
+
 /* Add your own callback for when the music has finished playing or when it is
  * stopped from a call to Mix_HaltMusic.
  */
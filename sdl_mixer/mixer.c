@@ -452,6 +452,18 @@ int Mix_OpenAudioDevice(int frequency, Uint16 format, int nchannels, int chunksi
     return(0);
 }
 
+void Mix_PauseAudio(int pause_on)
+{
+    SDL_PauseAudioDevice(audio_device, pause_on);
+}
+
+void Mix_MixAudio(Uint8 *stream, int len)
+{
+    Mix_LockAudio();
+    mix_channels(NULL, stream, len);
+    Mix_UnlockAudio();
+}
+
 /* Open the mixer with a certain desired audio format */
 int Mix_OpenAudio(int frequency, Uint16 format, int nchannels, int chunksize)
 {
@@ -4,6 +4,10 @@
 #define HAVE_DECL_STRCASECMP 1
 #define HAVE_DECL_STRNCASECMP 1
 #define HAVE_LIBPNG
+/* Define to use mmap() for WAD files (native builds on POSIX systems). */
+#if !defined(__EMSCRIPTEN__) && !defined(_WIN32)
+#define HAVE_MMAP 1
+#endif
 
 /* Name of package */
 #define PACKAGE "wasm-doom"
@@ -0,0 +1,327 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Timedemo benchmark harness. Plays a list of demos back to back
+//	with G_TimeDemo and reports the time spent in the playsim
+//	(P_Ticker) and in the renderer (R_RenderPlayerView) as JSON.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "doomtype.h"
+
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "r_plane.h"
+
+#include "bench.h"
+
+#define MAX_BENCH_DEMOS 64
+
+typedef struct
+{
+    char lumpname[9];
+    boolean played;
+
+    int tics;
+    int frames;
+
+    uint64_t start_us;
+    uint64_t total_us;
+    uint64_t tic_us;
+    uint64_t render_us;
+
+    uint64_t visplanes_created;
+    uint64_t visplanes_reused;
+    int max_visplanes;
+} benchdemo_t;
+
+boolean benchmarking = false;
+
+static benchdemo_t bench_demos[MAX_BENCH_DEMOS];
+static int num_bench_demos = 0;
+static int current_demo = -1;
+
+static boolean timing_tic = false;
+static uint64_t tic_start_us;
+static boolean timing_render = false;
+static uint64_t render_start_us;
+
+void BenchAddDemo(const char *lumpname)
+{
+    benchdemo_t *demo;
+
+    if (num_bench_demos >= MAX_BENCH_DEMOS)
+    {
+        printf("BenchAddDemo: Too many demos, ignoring %s\n", lumpname);
+        return;
+    }
+
+    demo = &bench_demos[num_bench_demos++];
+    memset(demo, 0, sizeof(*demo));
+    M_StringCopy(demo->lumpname, lumpname, sizeof(demo->lumpname));
+}
+
+static void StartDemo(int i)
+{
+    current_demo = i;
+    G_TimeDemo(bench_demos[i].lumpname);
+}
+
+boolean BenchStart(void)
+{
+    if (num_bench_demos == 0)
+    {
+        return false;
+    }
+
+    benchmarking = true;
+    StartDemo(0);
+
+    return true;
+}
+
+static double ToMS(uint64_t us)
+{
+    return us / 1000.0;
+}
+
+// Average over rendered frames; with -nodraw there are none, so fall
+// back to the number of tics run.
+
+static double PerFrame(uint64_t us, benchdemo_t *demo)
+{
+    int frames;
+
+    frames = demo->frames > 0 ? demo->frames : demo->tics;
+
+    return frames > 0 ? ToMS(us) / frames : 0.0;
+}
+
+static void PrintDemo(FILE *stream, benchdemo_t *demo)
+{
+    fprintf(stream, "    {\n");
+    fprintf(stream, "      \"demo\": \"%s\",\n", demo->lumpname);
+    fprintf(stream, "      \"played\": %s,\n",
+            demo->played ? "true" : "false");
+    fprintf(stream, "      \"tics\": %i,\n", demo->tics);
+    fprintf(stream, "      \"frames\": %i,\n", demo->frames);
+    fprintf(stream, "      \"total_ms\": %.3f,\n", ToMS(demo->total_us));
+    fprintf(stream, "      \"tic_ms\": %.3f,\n", ToMS(demo->tic_us));
+    fprintf(stream, "      \"render_ms\": %.3f,\n", ToMS(demo->render_us));
+    fprintf(stream, "      \"ms_per_frame\": %.4f,\n",
+            PerFrame(demo->total_us, demo));
+    fprintf(stream, "      \"tic_ms_per_frame\": %.4f,\n",
+            PerFrame(demo->tic_us, demo));
+    fprintf(stream, "      \"render_ms_per_frame\": %.4f,\n",
+            PerFrame(demo->render_us, demo));
+    fprintf(stream, "      \"visplanes_created\": %" PRIu64 ",\n",
+            demo->visplanes_created);
+    fprintf(stream, "      \"visplanes_reused\": %" PRIu64 ",\n",
+            demo->visplanes_reused);
+    fprintf(stream, "      \"max_visplanes\": %i\n", demo->max_visplanes);
+    fprintf(stream, "    }");
+}
+
+static void PrintReport(FILE *stream)
+{
+    benchdemo_t total;
+    int i;
+
+    memset(&total, 0, sizeof(total));
+
+    fprintf(stream, "{\n");
+    fprintf(stream, "  \"version\": \"%s\",\n", PACKAGE_STRING);
+    fprintf(stream, "  \"demos\": [\n");
+
+    for (i = 0; i < num_bench_demos; ++i)
+    {
+        PrintDemo(stream, &bench_demos[i]);
+        fprintf(stream, i < num_bench_demos - 1 ? ",\n" : "\n");
+
+        total.tics += bench_demos[i].tics;
+        total.frames += bench_demos[i].frames;
+        total.total_us += bench_demos[i].total_us;
+        total.tic_us += bench_demos[i].tic_us;
+        total.render_us += bench_demos[i].render_us;
+        total.visplanes_created += bench_demos[i].visplanes_created;
+        total.visplanes_reused += bench_demos[i].visplanes_reused;
+
+        if (bench_demos[i].max_visplanes > total.max_visplanes)
+        {
+            total.max_visplanes = bench_demos[i].max_visplanes;
+        }
+    }
+
+    fprintf(stream, "  ],\n");
+    fprintf(stream, "  \"total\": {\n");
+    fprintf(stream, "    \"tics\": %i,\n", total.tics);
+    fprintf(stream, "    \"frames\": %i,\n", total.frames);
+    fprintf(stream, "    \"total_ms\": %.3f,\n", ToMS(total.total_us));
+    fprintf(stream, "    \"ms_per_frame\": %.4f,\n",
+            PerFrame(total.total_us, &total));
+    fprintf(stream, "    \"tic_ms_per_frame\": %.4f,\n",
+            PerFrame(total.tic_us, &total));
+    fprintf(stream, "    \"render_ms_per_frame\": %.4f,\n",
+            PerFrame(total.render_us, &total));
+    fprintf(stream, "    \"visplanes_created\": %" PRIu64 ",\n",
+            total.visplanes_created);
+    fprintf(stream, "    \"visplanes_reused\": %" PRIu64 ",\n",
+            total.visplanes_reused);
+    fprintf(stream, "    \"max_visplanes\": %i\n", total.max_visplanes);
+    fprintf(stream, "  }\n");
+    fprintf(stream, "}\n");
+}
+
+static void WriteReport(void)
+{
+    FILE *stream;
+    int p;
+
+    //!
+    // @category demo
+    // @arg <filename>
+    //
+    // Write the -bench report to the specified file instead of stdout.
+    //
+
+    p = M_CheckParmWithArgs("-benchout", 1);
+
+    if (p > 0 && strcmp(myargv[p + 1], "-") != 0)
+    {
+        stream = fopen(myargv[p + 1], "w");
+
+        if (stream == NULL)
+        {
+            I_Error("WriteReport: Unable to open %s", myargv[p + 1]);
+        }
+
+        PrintReport(stream);
+        fclose(stream);
+    }
+    else
+    {
+        PrintReport(stdout);
+        fflush(stdout);
+    }
+}
+
+void BenchDemoDone(boolean played)
+{
+    benchdemo_t *demo;
+
+    if (!benchmarking || current_demo < 0)
+    {
+        return;
+    }
+
+    demo = &bench_demos[current_demo];
+    demo->played = played;
+
+    if (played && demo->tics > 0)
+    {
+        demo->total_us = I_GetTimeUS() - demo->start_us;
+    }
+
+    if (current_demo + 1 < num_bench_demos)
+    {
+        StartDemo(current_demo + 1);
+        return;
+    }
+
+    benchmarking = false;
+    current_demo = -1;
+
+    WriteReport();
+    I_Quit();
+}
+
+// Only tics and frames run while a demo is actually playing back are
+// counted; BenchDemoDone is called from inside G_Ticker, and the rest of
+// that tic belongs to neither demo.
+
+void BenchTicStart(void)
+{
+    if (!benchmarking || !demoplayback)
+    {
+        return;
+    }
+
+    timing_tic = true;
+    tic_start_us = I_GetTimeUS();
+
+    // The wall clock starts with the first tic, so that level loading
+    // is not included in the per-frame figures.
+
+    if (bench_demos[current_demo].tics == 0)
+    {
+        bench_demos[current_demo].start_us = tic_start_us;
+    }
+}
+
+void BenchTicEnd(void)
+{
+    benchdemo_t *demo;
+
+    if (!timing_tic)
+    {
+        return;
+    }
+
+    timing_tic = false;
+
+    demo = &bench_demos[current_demo];
+    demo->tic_us += I_GetTimeUS() - tic_start_us;
+    ++demo->tics;
+}
+
+void BenchRenderStart(void)
+{
+    if (!benchmarking || !demoplayback)
+    {
+        return;
+    }
+
+    timing_render = true;
+    render_start_us = I_GetTimeUS();
+}
+
+void BenchRenderEnd(void)
+{
+    benchdemo_t *demo;
+
+    if (!timing_render)
+    {
+        return;
+    }
+
+    timing_render = false;
+
+    demo = &bench_demos[current_demo];
+    demo->render_us += I_GetTimeUS() - render_start_us;
+    ++demo->frames;
+
+    demo->visplanes_created += visplanes_created;
+    demo->visplanes_reused += visplanes_reused;
+
+    if (visplanes_created > demo->max_visplanes)
+    {
+        demo->max_visplanes = visplanes_created;
+    }
+}
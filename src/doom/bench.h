@@ -0,0 +1,45 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Timedemo benchmark harness (-bench).
+//
+
+#ifndef __BENCH__
+#define __BENCH__
+
+#include "doomtype.h"
+
+// True while a -bench run is in progress.
+
+extern boolean benchmarking;
+
+// Queue a demo lump to be timed.
+
+void BenchAddDemo(const char *lumpname);
+
+// Start timing the first queued demo. Returns false if nothing was queued.
+
+boolean BenchStart(void);
+
+// Called when the current demo has finished (or could not be played).
+// Schedules the next demo, or writes the report and quits.
+
+void BenchDemoDone(boolean played);
+
+// Timing hooks around P_Ticker and R_RenderPlayerView.
+
+void BenchTicStart(void);
+void BenchTicEnd(void);
+void BenchRenderStart(void);
+void BenchRenderEnd(void);
+
+#endif
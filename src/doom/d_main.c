@@ -55,6 +55,8 @@
 #include "i_endoom.h"
 #include "i_input.h"
 #include "i_joystick.h"
+#include "i_perf.h"
+#include "i_sound.h"
 #include "i_system.h"
 #include "i_timer.h"
 #include "i_video.h"
@@ -69,6 +71,9 @@
 #include "p_setup.h"
 #include "r_local.h"
 #include "statdump.h"
+#include "bench.h"
+#include "renderdemo.h"
+#include "verify.h"
 
 
 #include "d_main.h"
@@ -289,7 +294,8 @@ void D_Display (void)
     }
 
     // save the current screen if about to wipe
-    if (gamestate != wipegamestate)
+    // (the melt runs in real time, so -bench and -renderdemo skip it)
+    if (gamestate != wipegamestate && !benchmarking && !renderingdemo)
     {
 	wipe = true;
 	wipe_StartScreen(0, 0, SCREENWIDTH, SCREENHEIGHT);
@@ -334,7 +340,11 @@ void D_Display (void)
     
     // draw the view directly
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
+	BenchRenderStart ();
 	R_RenderPlayerView (&players[displayplayer]);
+	BenchRenderEnd ();
+    }
 
     if (gamestate == GS_LEVEL && gametic)
 	HU_Drawer ();
@@ -395,7 +405,10 @@ void D_Display (void)
     // normal update
     if (!wipe)
     {
-	I_FinishUpdate ();              // page flip or blit buffer
+	if (renderingdemo)
+	    RenderDemoFrame ();
+	else
+	    I_FinishUpdate ();          // page flip or blit buffer
 	return;
     }
     
@@ -498,28 +511,41 @@ boolean D_GrabMouseCallback(void)
 
 void D_DoomLoopIter()
 {
+    I_PerfBeginFrame ();
+
     if (wipestart > 0)
     {
+        I_PerfBegin (PERF_HUD);
         D_Display();
+        I_PerfEnd (PERF_HUD);
+        I_PerfEndFrame ();
         return;
     }
 
     I_StartFrame ();
 
+    I_PerfBegin (PERF_TICS);
     TryRunTics (); // will run at least one tic
+    I_PerfEnd (PERF_TICS);
 
+    I_PerfBegin (PERF_SOUND);
     S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
+    I_PerfEnd (PERF_SOUND);
 
     // Update display, next frame, with current state.
     if (screenvisible)
     {
+        I_PerfBegin (PERF_HUD);
         D_Display ();
+        I_PerfEnd (PERF_HUD);
         if (inspectmode && firstScreen)
         {
             firstScreen = false;
             G_ScreenShot();
         }
     }
+
+    I_PerfEndFrame ();
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -580,6 +606,9 @@ void D_DoomLoop (void)
                " may cause demos and network games to get out of sync.\n");
     }
 
+    if (demorecording)
+	G_BeginRecording ();
+
     main_loop_started = true;
 
     I_SetWindowTitle(gamedescription);
@@ -1395,9 +1424,12 @@ static void LoadNerveWad(void)
         for (i = 0; i < 9; i++)
         {
             char lumpname[9];
+            lumpinfo_t *lump;
 
             M_snprintf (lumpname, 9, "CWILV%2.2d", i);
-            lumpinfo[W_GetNumForName(lumpname)]->name[0] = 'N';
+            lump = lumpinfo[W_GetNumForName(lumpname)];
+            lump->name[0] = 'N';
+            lump->namekey = W_LumpNameKey(lump->name);
         }
     }
 }
@@ -1419,6 +1451,44 @@ static void LoadMasterlevelsWad(void)
     }
 }
 
+// Load the demo file given on the command line, if it exists, and
+// return the name of the lump to play back.
+
+static void AddDemoFile(const char *name, char *demolumpname)
+{
+    char file[256];
+    char *uc_filename = strdup(name);
+    M_ForceUppercase(uc_filename);
+
+    // With Vanilla you have to specify the file without extension,
+    // but make that optional.
+    if (M_StringEndsWith(uc_filename, ".LMP"))
+    {
+        M_StringCopy(file, name, sizeof(file));
+    }
+    else
+    {
+        DEH_snprintf(file, sizeof(file), "%s.lmp", name);
+    }
+
+    free(uc_filename);
+
+    if (D_AddFile(file))
+    {
+        M_StringCopy(demolumpname, lumpinfo[numlumps - 1]->name, 9);
+    }
+    else
+    {
+        // If file failed to load, still continue trying to play
+        // the demo in the same way as Vanilla Doom.  This makes
+        // tricks like "-playdemo demo1" possible.
+
+        M_StringCopy(demolumpname, name, 9);
+    }
+
+    printf("Playing demo %s.\n", file);
+}
+
 static void G_CheckDemoStatusAtExit (void)
 {
     G_CheckDemoStatus();
@@ -1434,6 +1504,10 @@ void D_DoomMain (void)
     char demolumpname[9];
     int numiwadlumps;
 
+    // With -verify, this process only runs the workers, which carry
+    // on from here as if started with the command line of their job.
+    VerifyRunJobs ();
+
     // print banner
 
     I_PrintBanner(PACKAGE_STRING);
@@ -1446,6 +1520,18 @@ void D_DoomMain (void)
     DEH_printf("Z_Init: Init zone memory allocation daemon. \n");
     Z_Init ();
 
+    //!
+    // @category obscure
+    //
+    // Print zone memory statistics, per tag and per call site, as
+    // JSON on exit.
+    //
+
+    if (M_ParmExists("-zonestats"))
+    {
+        I_AtExit(Z_DumpStats, true);
+    }
+
     //!
     // @category game
     // @vanilla
@@ -1484,6 +1570,15 @@ void D_DoomMain (void)
 
     I_DisplayFPSDots(devparm);
 
+    //!
+    // @category video
+    //
+    // Draw a graph of the time taken by recent frames, broken down
+    // by phase, in the top right corner of the screen.
+    //
+
+    I_DisplayPerfGraph(M_ParmExists("-perfgraph"));
+
     //!
     // @category net
     // @vanilla
@@ -1682,39 +1777,68 @@ void D_DoomMain (void)
 
     }
 
-    if (p)
+    if (!p)
     {
-        char *uc_filename = strdup(myargv[p + 1]);
-        M_ForceUppercase(uc_filename);
+        //!
+        // @arg <demo>
+        // @category demo
+        //
+        // Render the demo named demo.lmp to a video as fast as it can
+        // be drawn, rather than playing it. The video is written to
+        // the file given with -renderout, whose extension picks the
+        // format: .y4m (the default), .gif or .rgb for raw frames.
+        // The sound is mixed along with it into a WAV file, named
+        // with -renderaudio or after the video. Use -rthreads to
+        // render with more threads.
+        //
+        p = M_CheckParmWithArgs("-renderdemo", 1);
 
-        // With Vanilla you have to specify the file without extension,
-        // but make that optional.
-        if (M_StringEndsWith(uc_filename, ".LMP"))
-        {
-            M_StringCopy(file, myargv[p + 1], sizeof(file));
-        }
-        else
+        if (p)
         {
-            DEH_snprintf(file, sizeof(file), "%s.lmp", myargv[p+1]);
+            snd_offline = true;
         }
+    }
 
-        free(uc_filename);
+    if (!p)
+    {
+        //!
+        // @arg <demo>
+        // @category demo
+        //
+        // Play back the demo named demo.lmp as fast as possible without
+        // drawing it, and print a checksum of the play state over every
+        // tic along with the player's final position. See -verify to
+        // check many demos at once.
+        //
+        p = M_CheckParmWithArgs("-verifydemo", 1);
+    }
 
-        if (D_AddFile(file))
-        {
-            M_StringCopy(demolumpname, lumpinfo[numlumps - 1]->name,
-                         sizeof(demolumpname));
-        }
-        else
-        {
-            // If file failed to load, still continue trying to play
-            // the demo in the same way as Vanilla Doom.  This makes
-            // tricks like "-playdemo demo1" possible.
+    if (p)
+    {
+        AddDemoFile(myargv[p + 1], demolumpname);
+    }
 
-            M_StringCopy(demolumpname, myargv[p + 1], sizeof(demolumpname));
-        }
+    //!
+    // @arg <demo> ...
+    // @category demo
+    //
+    // Time each of the given demos in turn like -timedemo and write a
+    // JSON report of the milliseconds per frame spent in the playsim
+    // and in the renderer (see -benchout). Without any demos, DEMO1 to
+    // DEMO4 from the loaded WADs are used.
+    //
 
-        printf("Playing demo %s.\n", file);
+    p = M_CheckParm("-bench");
+
+    if (p)
+    {
+        char benchlumpname[9];
+
+        while (++p < myargc && myargv[p][0] != '-')
+        {
+            AddDemoFile(myargv[p], benchlumpname);
+            BenchAddDemo(benchlumpname);
+        }
     }
 
     I_AtExit(G_CheckDemoStatusAtExit, true);
@@ -2047,6 +2171,45 @@ void D_DoomMain (void)
 	G_TimeDemo (demolumpname);
 	return D_DoomLoop ();  // never returns
     }
+
+    p = M_CheckParmWithArgs("-renderdemo", 1);
+    if (p)
+    {
+	RenderDemoStart (demolumpname);
+	return D_DoomLoop ();  // never returns
+    }
+
+    p = M_CheckParmWithArgs("-verifydemo", 1);
+    if (p)
+    {
+	VerifyDemoStart (demolumpname);
+	return D_DoomLoop ();  // never returns
+    }
+
+    p = M_CheckParm("-bench");
+    if (p)
+    {
+        // No demos given, time the ones in the loaded WADs.
+        if (p + 1 >= myargc || myargv[p + 1][0] == '-')
+        {
+            int i;
+
+            for (i = 1; i <= 4; ++i)
+            {
+                DEH_snprintf(demolumpname, sizeof(demolumpname), "demo%i", i);
+
+                if (W_CheckNumForName(demolumpname) >= 0)
+                {
+                    BenchAddDemo(demolumpname);
+                }
+            }
+        }
+
+        if (BenchStart())
+        {
+            return D_DoomLoop ();  // never returns
+        }
+    }
 	
     if (startloadgame >= 0)
     {
@@ -60,6 +60,14 @@ typedef struct thinker_s
     struct thinker_s*	prev;
     struct thinker_s*	next;
     think_t		function;
+
+    // Links in the list of thinkers of the same class,
+    // see thinkerclasscap.
+    struct thinker_s*	cprev;
+    struct thinker_s*	cnext;
+
+    // Pool the memory goes back to, see P_AllocateThinker.
+    int			pool;
     
 } thinker_t;
 
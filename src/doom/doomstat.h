@@ -189,6 +189,10 @@ extern  boolean	usergame;
 extern  boolean	demoplayback;
 extern  boolean	demorecording;
 
+// Set while G_DoPlayDemo loads the first level of a demo, before
+// demoplayback is, as G_InitNew clears it.
+extern  boolean	demostarting;
+
 // Round angleturn in ticcmds to the nearest 256.  This is used when
 // recording Vanilla demos in netgames.
 
@@ -274,6 +278,7 @@ extern int		skyflatnum;
 
 
 extern	int		rndindex;
+extern	int		prndindex;
 
 extern  ticcmd_t       *netcmds;
 
@@ -53,6 +53,9 @@
 #include "st_stuff.h"
 #include "am_map.h"
 #include "statdump.h"
+#include "bench.h"
+#include "renderdemo.h"
+#include "verify.h"
 
 // Needs access to LFB.
 #include "v_video.h"
@@ -147,6 +150,7 @@ boolean         demorecording;
 boolean         longtics;               // cph's doom 1.91 longtics hack
 boolean         lowres_turn;            // low resolution turning for longtics
 boolean         demoplayback; 
+boolean         demostarting;
 boolean		netdemo; 
 byte*		demobuffer;
 byte*		demo_p;
@@ -854,6 +858,8 @@ boolean G_Responder (event_t* ev)
     return false; 
 } 
  
+static void G_DemoChecksumTic (void);
+
 //
 // G_Ticker
 // Make ticcmd_ts for the players.
@@ -888,7 +894,16 @@ void G_Ticker (void)
 	    break; 
 	  case ga_playdemo: 
 	    if ( !G_DoPlayDemo () )
-            D_AdvanceDemo(); 
+            {
+                if (benchmarking)
+                    BenchDemoDone(false);
+                else if (renderingdemo)
+                    RenderDemoDone(false);
+                else if (verifyingdemo)
+                    VerifyDemoDone(false);
+                else
+                    D_AdvanceDemo();
+            }
 	    break; 
 	  case ga_completed: 
 	    G_DoCompleted (); 
@@ -974,7 +989,9 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
       case GS_LEVEL: 
+	BenchTicStart ();
 	P_Ticker (); 
+	BenchTicEnd ();
 	ST_Ticker (); 
 	AM_Ticker (); 
 	HU_Ticker ();            
@@ -992,6 +1009,9 @@ void G_Ticker (void)
 	D_PageTicker (); 
 	break;
     }        
+
+    G_DemoChecksumTic ();
+    VerifyTic ();
 } 
  
  
@@ -1537,6 +1557,8 @@ void G_DoCompleted (void)
  
     WI_Start (&wminfo); 
 
+    P_PrefetchLevel (gameepisode, wminfo.next + 1);
+
     const char *s = HU_GetMapName();
 
     EM_ASM_({
@@ -2020,6 +2042,35 @@ G_InitNew
 // 
 #define DEMOMARKER		0x80
 
+// With -demochecksums, the checksums of the play state for every tic
+// are written after the end of the demo, where nothing else looks,
+// and checked when it is played back to tell the first tic that went
+// out of sync, and in what.
+
+#define CHECKSUMS_MAGIC		"CSUM"
+
+static unsigned int*	demochecksums;		// recorded so far
+static int		maxdemochecksums;
+static byte*		demochecksums_p;	// played back against
+static int		numdemochecksums;
+static int		demochecksumtic;
+
+int		demodesynctic = -1;
+int		demodesyncmask;
+
+static void WriteLong (byte **p, unsigned int value)
+{
+    *(*p)++ = value & 0xff;
+    *(*p)++ = (value >> 8) & 0xff;
+    *(*p)++ = (value >> 16) & 0xff;
+    *(*p)++ = (value >> 24) & 0xff;
+}
+
+static unsigned int ReadLong (const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
 
 void G_ReadDemoTiccmd (ticcmd_t* cmd) 
 { 
@@ -2047,9 +2098,224 @@ void G_ReadDemoTiccmd (ticcmd_t* cmd)
     cmd->buttons = (unsigned char)*demo_p++; 
 } 
 
+// Increase the size of the demo buffer to allow unlimited demos
+
+static void IncreaseDemoBuffer(void)
+{
+    int current_length;
+    byte *new_demobuffer;
+    byte *new_demop;
+    int new_length;
+
+    // Find the current size
+
+    current_length = demoend - demobuffer;
+
+    // Generate a new buffer twice the size
+    new_length = current_length * 2;
+
+    new_demobuffer = Z_Malloc(new_length, PU_STATIC, 0);
+    new_demop = new_demobuffer + (demo_p - demobuffer);
+
+    // Copy over the old data
+
+    memcpy(new_demobuffer, demobuffer, current_length);
+
+    // Free the old buffer and point the demo pointers at the new buffer.
+
+    Z_Free(demobuffer);
+
+    demobuffer = new_demobuffer;
+    demo_p = new_demop;
+    demoend = demobuffer + new_length;
+}
+
 void G_WriteDemoTiccmd (ticcmd_t* cmd) 
 { 
+    byte *demo_start;
+
+    if (gamekeydown[key_demo_quit])           // press q to end demo recording 
+    {
+	G_CheckDemoStatus (); 
+	return;
+    }
+
+    demo_start = demo_p;
+
+    *demo_p++ = cmd->forwardmove; 
+    *demo_p++ = cmd->sidemove; 
+
+    // If this is a longtics demo, record in higher resolution
+ 
+    if (longtics)
+    {
+        *demo_p++ = (cmd->angleturn & 0xff);
+        *demo_p++ = (cmd->angleturn >> 8) & 0xff;
+    }
+    else
+    {
+        *demo_p++ = cmd->angleturn >> 8; 
+    }
+
+    *demo_p++ = cmd->buttons; 
+
+    // reset demo pointer back
+    demo_p = demo_start;
+
+    if (demo_p > demoend - 16)
+    {
+        if (vanilla_demo_limit)
+        {
+            // no more space 
+            G_CheckDemoStatus (); 
+            return; 
+        }
+        else
+        {
+            // Vanilla demo limit disabled: unlimited
+            // demo lengths!
+
+            IncreaseDemoBuffer();
+        }
+    } 
+	
+    G_ReadDemoTiccmd (cmd);         // make SURE it is exactly the same 
 } 
+
+//
+// G_ReadDemoChecksums
+// Find the checksums after the end of the demo being played, if any.
+//
+static void G_ReadDemoChecksums (int lumpnum)
+{
+    byte*	p;
+    byte*	end;
+    int		n;
+
+    demochecksums_p = NULL;
+    numdemochecksums = 0;
+    demochecksumtic = 0;
+    demodesynctic = -1;
+    demodesyncmask = 0;
+
+    // Skip the ticcmds.
+    p = demo_p;
+    end = demobuffer + W_LumpLength(lumpnum);
+
+    while (p < end && *p != DEMOMARKER)
+	p += longtics ? 5 : 4;
+
+    // The marker, the magic, the number of checksums in a tic and
+    // the number of tics.
+    if (end - p < 10
+     || memcmp(p + 1, CHECKSUMS_MAGIC, 4) != 0
+     || p[5] != NUMCHECKSUMS)
+    {
+	return;
+    }
+
+    n = ReadLong(p + 6);
+    p += 10;
+
+    if (n <= 0 || n > (end - p) / (NUMCHECKSUMS * 4))
+	return;
+
+    demochecksums_p = p;
+    numdemochecksums = n;
+    p_checksums = true;
+}
+
+//
+// G_WriteDemoChecksums
+// Called after the end marker of the demo being recorded.
+//
+static void G_WriteDemoChecksums (void)
+{
+    int		i;
+
+    if (!p_checksums)
+	return;
+
+    while (demoend - demo_p < 9 + numdemochecksums * NUMCHECKSUMS * 4)
+	IncreaseDemoBuffer ();
+
+    memcpy(demo_p, CHECKSUMS_MAGIC, 4);
+    demo_p += 4;
+    *demo_p++ = NUMCHECKSUMS;
+    WriteLong(&demo_p, numdemochecksums);
+
+    for (i = 0; i < numdemochecksums * NUMCHECKSUMS; i++)
+	WriteLong(&demo_p, demochecksums[i]);
+
+    free(demochecksums);
+    demochecksums = NULL;
+    maxdemochecksums = numdemochecksums = 0;
+    p_checksums = false;
+}
+
+//
+// G_DemoChecksumTic
+// Called at the end of every tic, to record the checksums of the
+// play state or check them against those recorded.
+//
+static void G_DemoChecksumTic (void)
+{
+    const byte*	expected;
+    int		i;
+
+    if (!p_checksums)
+	return;
+
+    if (demorecording)
+    {
+	if (numdemochecksums == maxdemochecksums)
+	{
+	    maxdemochecksums = maxdemochecksums ? maxdemochecksums * 2 : 1024;
+	    demochecksums = I_Realloc(demochecksums, maxdemochecksums
+				      * sizeof(tic_checksums));
+	}
+
+	memcpy(demochecksums + numdemochecksums * NUMCHECKSUMS,
+	       tic_checksums, sizeof(tic_checksums));
+	numdemochecksums++;
+	return;
+    }
+
+    // Only the first tic out of sync is told of; everything after
+    // it will be too.
+    if (!demoplayback || demochecksums_p == NULL || demodesynctic >= 0
+     || demochecksumtic >= numdemochecksums)
+    {
+	return;
+    }
+
+    expected = demochecksums_p + demochecksumtic * NUMCHECKSUMS * 4;
+
+    for (i = 0; i < NUMCHECKSUMS; i++)
+    {
+	if (ReadLong(expected + i * 4) != tic_checksums[i])
+	    demodesyncmask |= 1 << i;
+    }
+
+    if (demodesyncmask != 0)
+    {
+	demodesynctic = demochecksumtic;
+
+	printf("G_DemoChecksumTic: Demo out of sync at tic %i in",
+	       demodesynctic);
+
+	for (i = 0; i < NUMCHECKSUMS; i++)
+	{
+	    if (demodesyncmask & (1 << i))
+		printf(" %s (%08x, expected %08x)", checksum_names[i],
+		       tic_checksums[i], ReadLong(expected + i * 4));
+	}
+
+	printf("\n");
+    }
+
+    demochecksumtic++;
+}
  
 //
 // G_RecordDemo
@@ -2141,6 +2407,17 @@ void G_BeginRecording (void)
 	 
     for (i=0 ; i<MAXPLAYERS ; i++) 
 	*demo_p++ = playeringame[i]; 		 
+
+    //!
+    // @category demo
+    //
+    // Write checksums of the play state for every tic after the end
+    // of the recorded demo, so that playback can tell the first tic
+    // that goes out of sync. Other ports ignore them.
+    //
+
+    p_checksums = M_ParmExists("-demochecksums");
+    numdemochecksums = 0;
 } 
  
 
@@ -2206,6 +2483,8 @@ boolean G_DoPlayDemo (void)
     for (i=0 ; i<MAXPLAYERS ; i++) 
 	playeringame[i] = *demo_p++; 
 
+    G_ReadDemoChecksums (lumpnum);
+
     if (playeringame[1] || M_CheckParm("-solo-net") > 0
                         || M_CheckParm("-netdemo") > 0)
     {
@@ -2215,7 +2494,9 @@ boolean G_DoPlayDemo (void)
 
     // don't spend a lot of time in loadlevel 
     precache = false;
+    demostarting = true;
     G_InitNew (skill, episode, map); 
+    demostarting = false;
     precache = true; 
     starttime = I_GetTime (); 
 
@@ -2261,6 +2542,12 @@ boolean G_CheckDemoStatus (void)
 {
     int             endtime; 
 	 
+    // Timed demos are played back to back by -bench, rendered by
+    // -renderdemo and checked by -verifydemo; clean up as for a regular
+    // demo and let the harness pick the next one or finish up
+    if (timingdemo && (benchmarking || renderingdemo || verifyingdemo))
+        timingdemo = false;
+
     if (timingdemo) 
     { 
         float fps;
@@ -2282,6 +2569,8 @@ boolean G_CheckDemoStatus (void)
     { 
         W_ReleaseLumpName(defdemoname);
 	demoplayback = false; 
+	demochecksums_p = NULL;
+	p_checksums = false;
 	netdemo = false;
 	netgame = false;
 	deathmatch = false;
@@ -2316,7 +2605,13 @@ boolean G_CheckDemoStatus (void)
 
 	consoleplayer = 0;
         
-        if (singledemo) 
+        if (benchmarking)
+            BenchDemoDone (true);
+        else if (renderingdemo)
+            RenderDemoDone (true);
+        else if (verifyingdemo)
+            VerifyDemoDone (true);
+        else if (singledemo) 
             I_Quit (); 
         else 
             D_AdvanceDemo (); 
@@ -2327,6 +2622,7 @@ boolean G_CheckDemoStatus (void)
     if (demorecording) 
     { 
 	*demo_p++ = DEMOMARKER; 
+	G_WriteDemoChecksums ();
 	M_WriteFile (demoname, demobuffer, demo_p - demobuffer); 
 	Z_Free (demobuffer); 
 	demorecording = false; 
@@ -82,5 +82,11 @@ int G_VanillaVersionCode(void);
 
 extern int vanilla_savegame_limit;
 extern int vanilla_demo_limit;
+
+// First tic of the demo being played that did not match the checksums
+// recorded with it, or -1, and a mask of the checksums that differed.
+
+extern int demodesynctic;
+extern int demodesyncmask;
 #endif
 
@@ -16,19 +16,38 @@
 //
 // DESCRIPTION:
 //	[crispy] Create Blockmap
+//	Built blockmaps are cached in the configuration directory,
+//	named after a hash of the vertexes and linedefs.
 //
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "i_system.h"
+#include "m_config.h"
+#include "m_misc.h"
 #include "p_local.h"
 #include "z_zone.h"
 
+// Bump when the blockmap built here changes, to drop stale caches.
+#define BLOCKMAP_VERSION 1
+
+// One block that a line passes through.
+typedef struct { int block, line; } blockref_t;
+
 // [crispy] taken from mbfsrc/P_SETUP.C:547-707, slightly adapted
+//
+// Instead of growing a list per block, every block a line passes
+// through is appended to a single array, which is then sorted into
+// the blockmap lump by counting. The lists come out the same.
+// Returns the size of the lump in words.
 
-void P_CreateBlockMap(void)
+static int BuildBlockMap(void)
 {
   register int i;
   fixed_t minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+  int width, height;
+  int size;
 
   // First find limits of map
 
@@ -50,12 +69,8 @@ void P_CreateBlockMap(void)
   minx -= 8; miny -= 8;
   maxx += 8; maxy += 8;
 
-  // Save blockmap parameters
-
-  bmaporgx = minx << FRACBITS;
-  bmaporgy = miny << FRACBITS;
-  bmapwidth  = ((maxx-minx) >> MAPBTOFRAC) + 1;
-  bmapheight = ((maxy-miny) >> MAPBTOFRAC) + 1;
+  width  = ((maxx-minx) >> MAPBTOFRAC) + 1;
+  height = ((maxy-miny) >> MAPBTOFRAC) + 1;
 
   // Compute blockmap, which is stored as a 2d array of variable-sized lists.
   //
@@ -67,7 +82,7 @@ void P_CreateBlockMap(void)
   //
   //   Starting in the starting vertex's block, do:
   //
-  //     Add linedef to current block's list, dynamically resizing it.
+  //     Note the linedef as passing through the current block.
   //
   //     If current block is the same as the ending vertex's block, exit loop.
   //
@@ -75,9 +90,10 @@ void P_CreateBlockMap(void)
   //     either the x or y direction, to the block which contains the linedef.
 
   {
-    typedef struct { int n, nalloc, *list; } bmap_t;  // blocklist structure
-    unsigned tot = bmapwidth * bmapheight;            // size of blockmap
-    bmap_t *bmap = calloc(sizeof *bmap, tot);         // array of blocklists
+    unsigned tot = width * height;                    // size of blockmap
+    int *count = calloc(sizeof *count, tot);          // linedefs per block
+    blockref_t *refs = NULL;                          // blocks crossed
+    int numrefs = 0, maxrefs = 0;
     int x, y, adx, ady, bend;
 
     for (i=0; i < numlines; i++)
@@ -98,14 +114,14 @@ void P_CreateBlockMap(void)
 	  (((y >> MAPBTOFRAC) << MAPBTOFRAC) +
 	   (dy > 0 ? MAPBLOCKUNITS-1 : 0) - y) * (adx = abs(adx)) * dy;
 
-	// starting block, and pointer to its blocklist structure
-	b = (y >> MAPBTOFRAC)*bmapwidth + (x >> MAPBTOFRAC);
+	// starting block
+	b = (y >> MAPBTOFRAC)*width + (x >> MAPBTOFRAC);
 
 	bend = (((lines[i].v2->y >> FRACBITS) - miny) >> MAPBTOFRAC) *
-			bmapwidth + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
+			width + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
 
-	// delta for pointer when moving across y
-	dy *= bmapwidth;
+	// delta for block number when moving across y
+	dy *= width;
 
 	// deltas for diff inside the loop
 	adx <<= MAPBTOFRAC;
@@ -114,14 +130,15 @@ void P_CreateBlockMap(void)
 	// Now we simply iterate block-by-block until we reach the end block.
 	while ((unsigned) b < tot)    // failsafe -- should ALWAYS be true
 	  {
-	    // Increase size of allocated list if necessary
-	    if (bmap[b].n >= bmap[b].nalloc)
-	      bmap[b].list = I_Realloc(bmap[b].list,
-				     (bmap[b].nalloc = bmap[b].nalloc ?
-				      bmap[b].nalloc*2 : 8)*sizeof*bmap->list);
+	    // Increase size of allocated array if necessary
+	    if (numrefs >= maxrefs)
+	      refs = I_Realloc(refs, (maxrefs = maxrefs ?
+				      maxrefs*2 : 1024)*sizeof*refs);
 
-	    // Add linedef to end of list
-	    bmap[b].list[bmap[b].n++] = i;
+	    refs[numrefs].block = b;
+	    refs[numrefs].line = i;
+	    numrefs++;
+	    count[b]++;
 
 	    // If we have reached the last block, exit
 	    if (b == bend)
@@ -140,44 +157,215 @@ void P_CreateBlockMap(void)
     // Compression of empty blocks is performed by reserving two offset words
     // at tot and tot+1.
     //
-    // 4 words, unused if this routine is called, are reserved at the start.
+    // 4 words at the start hold the header, as in a BLOCKMAP lump.
 
     {
-      int count = tot+6;  // we need at least 1 word per block, plus reserved's
+      size = tot+6 + numrefs;      // 1 word per block, reserved's, linedefs
 
       for (i = 0; i < tot; i++)
-	if (bmap[i].n)
-	  count += bmap[i].n + 2; // 1 header word + 1 trailer word + blocklist
+	if (count[i])
+	  size += 2;                // 1 header word + 1 trailer word
 
-      // Allocate blockmap lump with computed count
-      blockmaplump = Z_Malloc(sizeof(*blockmaplump) * count, PU_LEVEL, 0);
+      // Allocate blockmap lump with computed size
+      blockmaplump = Z_Malloc(sizeof(*blockmaplump) * size, PU_LEVEL, 0);
     }
 
-    // Now compress the blockmap.
+    blockmaplump[0] = minx;
+    blockmaplump[1] = miny;
+    blockmaplump[2] = width;
+    blockmaplump[3] = height;
+
+    // Now lay out the blockmap, leaving room for each list.
     {
-      int ndx = tot += 4;         // Advance index to start of linedef lists
-      bmap_t *bp = bmap;          // Start of uncompressed blockmap
+      int ndx = tot + 4;          // Index of the reserved empty list
 
       blockmaplump[ndx++] = 0;    // Store an empty blockmap list at start
       blockmaplump[ndx++] = -1;   // (Used for compression)
 
-      for (i = 4; i < tot; i++, bp++)
-	if (bp->n)                                      // Non-empty blocklist
+      for (i = 0; i < tot; i++)
+	if (count[i])                                   // Non-empty blocklist
 	  {
-	    blockmaplump[blockmaplump[i] = ndx++] = 0;  // Store index & header
-	    do
-	      blockmaplump[ndx++] = bp->list[--bp->n];  // Copy linedef list
-	    while (bp->n);
+	    blockmaplump[4 + i] = ndx;                  // Store index
+	    blockmaplump[ndx] = 0;                      // and header
+	    ndx += count[i] + 1;
+	    count[i] = ndx;                             // End of its list
 	    blockmaplump[ndx++] = -1;                   // Store trailer
-	    free(bp->list);                             // Free linedef list
 	  }
 	else            // Empty blocklist: point to reserved empty blocklist
-	  blockmaplump[i] = tot;
-
-      free(bmap);    // Free uncompressed blockmap
+	  blockmaplump[4 + i] = tot + 4;
     }
+
+    // Fill each list from the end, so that the linedefs come out
+    // last found first, as they always have.
+
+    for (i = 0; i < numrefs; i++)
+      blockmaplump[--count[refs[i].block]] = refs[i].line;
+
+    free(refs);
+    free(count);
   }
 
+  return size;
+}
+
+static uint64_t HashBlockMapGeometry(void)
+{
+  uint64_t hash = M_HASH_INIT;
+  int32_t v[4];
+  int i;
+
+  v[0] = BLOCKMAP_VERSION;
+  v[1] = numvertexes;
+  v[2] = numlines;
+  hash = M_HashBytes(hash, v, 3 * sizeof(*v));
+
+  for (i = 0; i < numvertexes; i++)
+    {
+      v[0] = vertexes[i].x;
+      v[1] = vertexes[i].y;
+      hash = M_HashBytes(hash, v, 2 * sizeof(*v));
+    }
+
+  for (i = 0; i < numlines; i++)
+    {
+      v[0] = lines[i].v1->x;
+      v[1] = lines[i].v1->y;
+      v[2] = lines[i].v2->x;
+      v[3] = lines[i].v2->y;
+      hash = M_HashBytes(hash, v, sizeof(v));
+    }
+
+  return hash;
+}
+
+typedef struct
+{
+  char magic[8];
+  uint64_t hash;
+  int32_t size;               // words in the blockmap lump
+} blockmapheader_t;
+
+static char *CacheFileName(uint64_t hash)
+{
+  char name[32];
+
+  M_snprintf(name, sizeof(name), "blockmap%08x%08x.dat",
+	     (unsigned int) (hash >> 32), (unsigned int) hash);
+
+  return M_StringJoin(configdir, name, NULL);
+}
+
+// Whether every block list in a cached blockmap of 'size' words is
+// within it, and ends before running out, with only linedefs in it.
+
+static boolean ValidBlockMap(int size)
+{
+  int64_t tot;
+  int offset;
+  int i;
+
+  if (blockmaplump[2] <= 0 || blockmaplump[3] <= 0)
+    return false;
+
+  tot = (int64_t) blockmaplump[2] * blockmaplump[3];
+
+  if (tot + 4 >= size)
+    return false;
+
+  for (i = 0; i < tot; i++)
+    {
+      offset = blockmaplump[4 + i];
+
+      if (offset < tot + 4 || offset >= size)
+	return false;
+
+      for (; blockmaplump[offset] != -1; offset++)
+	if (blockmaplump[offset] < 0 || blockmaplump[offset] >= numlines
+	    || offset == size - 1)
+	  return false;
+    }
+
+  return true;
+}
+
+static boolean ReadCache(const char *filename, uint64_t hash)
+{
+  blockmapheader_t header;
+  FILE *fp;
+  boolean ok;
+
+  fp = fopen(filename, "rb");
+
+  if (fp == NULL)
+    return false;
+
+  ok = fread(&header, sizeof(header), 1, fp) == 1
+    && !memcmp(header.magic, "BLOCKMAP", sizeof(header.magic))
+    && header.hash == hash
+    && header.size > 6;
+
+  if (ok)
+    {
+      blockmaplump = Z_Malloc(sizeof(*blockmaplump) * header.size,
+			      PU_LEVEL, 0);
+      ok = fread(blockmaplump, sizeof(*blockmaplump), header.size, fp)
+	== header.size;
+
+      ok = ok && ValidBlockMap(header.size);
+
+      if (!ok)
+	Z_Free(blockmaplump);
+    }
+
+  fclose(fp);
+
+  return ok;
+}
+
+static void WriteCache(const char *filename, uint64_t hash, int size)
+{
+  blockmapheader_t header;
+  FILE *fp;
+
+  fp = fopen(filename, "wb");
+
+  if (fp == NULL)
+    return;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "BLOCKMAP", sizeof(header.magic));
+  header.hash = hash;
+  header.size = size;
+
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(blockmaplump, sizeof(*blockmaplump), size, fp);
+  fclose(fp);
+}
+
+void P_CreateBlockMap(void)
+{
+  char *filename;
+  uint64_t hash;
+  int size;
+
+  hash = HashBlockMapGeometry();
+  filename = CacheFileName(hash);
+
+  if (!ReadCache(filename, hash))
+    {
+      size = BuildBlockMap();
+      WriteCache(filename, hash, size);
+    }
+
+  free(filename);
+
+  // Save blockmap parameters
+
+  bmaporgx = blockmaplump[0] << FRACBITS;
+  bmaporgy = blockmaplump[1] << FRACBITS;
+  bmapwidth  = blockmaplump[2];
+  bmapheight = blockmaplump[3];
+
   // [crispy] copied over from P_LoadBlockMap()
 	int count = sizeof(*blocklinks) * bmapwidth * bmapheight;
 	blocklinks = Z_Malloc(count, PU_LEVEL, 0);
@@ -189,8 +189,8 @@ EV_DoCeiling
 	
 	// new door thinker
 	rtn = 1;
-	ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
-	P_AddThinker (&ceiling->thinker);
+	ceiling = P_AllocateThinker (sizeof(*ceiling), PU_LEVSPEC);
+	P_AddThinker (&ceiling->thinker, th_misc);
 	sec->ceilingdata = ceiling;
 	ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
 	ceiling->sector = sec;
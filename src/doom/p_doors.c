@@ -270,8 +270,8 @@ EV_DoDoor
 	
 	// new door thinker
 	rtn = 1;
-	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
-	P_AddThinker (&door->thinker);
+	door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
+	P_AddThinker (&door->thinker, th_misc);
 	sec->ceilingdata = door;
 
 	door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -477,8 +477,8 @@ EV_VerticalDoor
 	
     
     // new door thinker
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
-    P_AddThinker (&door->thinker);
+    door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
+    P_AddThinker (&door->thinker, th_misc);
     sec->ceilingdata = door;
     door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
     door->sector = sec;
@@ -527,9 +527,9 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 {
     vldoor_t*	door;
 	
-    door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
 
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_misc);
 
     sec->ceilingdata = door;
     sec->special = 0;
@@ -552,9 +552,9 @@ P_SpawnDoorRaiseIn5Mins
 {
     vldoor_t*	door;
 	
-    door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
     
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_misc);
 
     sec->ceilingdata = door;
     sec->special = 0;
@@ -763,8 +763,8 @@ EV_SlidingDoor
     // Init sliding door vars
     if (!door)
     {
-	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
-	P_AddThinker (&door->thinker);
+	door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
+	P_AddThinker (&door->thinker, th_misc);
 	sec->specialdata = door;
 		
 	door->type = sdt_openAndClose;
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "m_bbox.h"
 #include "m_random.h"
 #include "i_system.h"
 
@@ -558,11 +559,10 @@ void A_KeenDie (mobj_t* mo)
     
     // scan the remaining thinkers
     // to see if all Keens are dead
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ;
+	 th != &thinkerclasscap[th_mobj] ;
+	 th = th->cnext)
     {
-	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
-	    continue;
-
 	mo2 = (mobj_t *)th;
 	if (mo2 != mo
 	    && mo2->type == mo->type
@@ -1158,6 +1158,7 @@ void A_VileChase (mobj_t* actor)
     
     int			bx;
     int			by;
+    fixed_t		box[4];
 
     mobjinfo_t*		info;
     mobj_t*		temp;
@@ -1175,6 +1176,12 @@ void A_VileChase (mobj_t* actor)
 	yl = (viletryy - bmaporgy - MAXRADIUS*2)>>MAPBLOCKSHIFT;
 	yh = (viletryy - bmaporgy + MAXRADIUS*2)>>MAPBLOCKSHIFT;
 	
+	// A corpse has to be within its own radius of this.
+	box[BOXTOP] = viletryy + mobjinfo[MT_VILE].radius;
+	box[BOXBOTTOM] = viletryy - mobjinfo[MT_VILE].radius;
+	box[BOXRIGHT] = viletryx + mobjinfo[MT_VILE].radius;
+	box[BOXLEFT] = viletryx - mobjinfo[MT_VILE].radius;
+
 	vileobj = actor;
 	for (bx=xl ; bx<=xh ; bx++)
 	{
@@ -1183,7 +1190,7 @@ void A_VileChase (mobj_t* actor)
 		// Call PIT_VileCheck to check
 		// whether object is a corpse
 		// that canbe raised.
-		if (!P_BlockThingsIterator(bx,by,PIT_VileCheck))
+		if (!P_BlockThingsIteratorBox(bx,by,box,PIT_VileCheck))
 		{
 		    // got one!
 		    temp = actor->target;
@@ -1460,13 +1467,12 @@ A_PainShootSkull
     // count total number of skull currently on the level
     count = 0;
 
-    currentthinker = thinkercap.next;
-    while (currentthinker != &thinkercap)
+    currentthinker = thinkerclasscap[th_mobj].cnext;
+    while (currentthinker != &thinkerclasscap[th_mobj])
     {
-	if (   (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
-	    && ((mobj_t *)currentthinker)->type == MT_SKULL)
+	if (((mobj_t *)currentthinker)->type == MT_SKULL)
 	    count++;
-	currentthinker = currentthinker->next;
+	currentthinker = currentthinker->cnext;
     }
 
     // if there are allready 20 skulls on the level,
@@ -1687,11 +1693,10 @@ void A_BossDeath (mobj_t* mo)
     
     // scan the remaining thinkers to see
     // if all bosses are dead
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ;
+	 th != &thinkerclasscap[th_mobj] ;
+	 th = th->cnext)
     {
-	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
-	    continue;
-	
 	mo2 = (mobj_t *)th;
 	if (mo2 != mo
 	    && mo2->type == mo->type
@@ -1817,14 +1822,10 @@ void A_BrainAwake (mobj_t* mo)
     numbraintargets = 0;
     braintargeton = 0;
 	
-    thinker = thinkercap.next;
-    for (thinker = thinkercap.next ;
-	 thinker != &thinkercap ;
-	 thinker = thinker->next)
+    for (thinker = thinkerclasscap[th_mobj].cnext ;
+	 thinker != &thinkerclasscap[th_mobj] ;
+	 thinker = thinker->cnext)
     {
-	if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
-	    continue;	// not a mobj
-
 	m = (mobj_t *)thinker;
 
 	if (m->type == MT_BOSSTARGET )
@@ -18,6 +18,8 @@
 // 	format or DeePBSP format and/or LINEDEFS and THINGS lumps in Hexen format
 //
 
+#include <stdlib.h>
+
 #include "m_bbox.h"
 #include "p_local.h"
 #include "i_swap.h"
@@ -209,6 +211,91 @@ void P_LoadNodes_DeePBSP (int lump)
   W_ReleaseLumpNum(lump);
 }
 
+#ifdef HAVE_LIBZ
+// Inflate a compressed ZDBSP nodes lump, as read by the caller.
+// Uses neither the zone nor the WAD, so that it can run on another
+// thread while the rest of the level loads. The result is malloc()ed.
+// Nor does it call I_Error, which cannot be called on another thread:
+// on failure it returns NULL, with the reason in 'error'.
+byte *P_InflateNodes_ZDBSP (const byte *data, int len, const char **error)
+{
+	byte *output, *newoutput;
+	int outlen, err;
+	z_stream zstream;
+
+	if (len < 4)
+	{
+	    *error = "P_LoadNodes: ZDBSP nodes lump is too short!";
+	    return NULL;
+	}
+
+	// first estimate for compression rate:
+	// output buffer size == 2.5 * input size
+	outlen = 2.5 * len;
+	output = malloc(outlen);
+
+	if (output == NULL)
+	{
+	    *error = "P_LoadNodes: Out of memory for ZDBSP nodes decompression!";
+	    return NULL;
+	}
+
+	// initialize stream state for decompression
+	memset(&zstream, 0, sizeof(zstream));
+	zstream.next_in = (byte *) data + 4;
+	zstream.avail_in = len - 4;
+	zstream.next_out = output;
+	zstream.avail_out = outlen;
+
+	if (inflateInit(&zstream) != Z_OK)
+	{
+	    free(output);
+	    *error = "P_LoadNodes: Error during ZDBSP nodes decompression initialization!";
+	    return NULL;
+	}
+
+	// resize if output buffer runs full
+	while ((err = inflate(&zstream, Z_SYNC_FLUSH)) == Z_OK)
+	{
+	    int outlen_old = outlen;
+	    outlen = 2 * outlen_old;
+	    newoutput = realloc(output, outlen);
+
+	    if (newoutput == NULL)
+	    {
+		err = Z_MEM_ERROR;
+		break;
+	    }
+
+	    output = newoutput;
+	    zstream.next_out = output + outlen_old;
+	    zstream.avail_out = outlen - outlen_old;
+	}
+
+	if (err != Z_STREAM_END)
+	{
+	    inflateEnd(&zstream);
+	    free(output);
+	    *error = err == Z_MEM_ERROR
+	           ? "P_LoadNodes: Out of memory for ZDBSP nodes decompression!"
+	           : "P_LoadNodes: Error during ZDBSP nodes decompression!";
+	    return NULL;
+	}
+
+	fprintf(stderr, "P_LoadNodes: ZDBSP nodes compression ratio %.3f\n",
+	        (float)zstream.total_out/zstream.total_in);
+
+	if (inflateEnd(&zstream) != Z_OK)
+	{
+	    free(output);
+	    *error = "P_LoadNodes: Error during ZDBSP nodes decompression shut-down!";
+	    return NULL;
+	}
+
+	return output;
+}
+#endif
+
 // [crispy] support maps with compressed or uncompressed ZDBSP nodes
 // adapted from prboom-plus/src/p_setup.c:1040-1331
 // heavily modified, condensed and simplyfied
@@ -217,8 +304,14 @@ void P_LoadNodes_DeePBSP (int lump)
 // - inlined P_LoadZSegs()
 // - added support for compressed ZDBSP nodes
 // - added support for flipped levels
-void P_LoadNodes_ZDBSP (int lump, boolean compressed)
+//
+// Compressed nodes may have been inflated already, in which case
+// 'inflated' is the result of P_InflateNodes_ZDBSP, freed here.
+void P_LoadNodes_ZDBSP (int lump, boolean compressed, byte *inflated)
 {
+#ifdef HAVE_LIBZ
+    const char *error;
+#endif
     byte *data;
     unsigned int i;
 #ifdef HAVE_LIBZ
@@ -231,63 +324,32 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
     unsigned int numNodes;
     vertex_t *newvertarray = NULL;
 
-    data = W_CacheLumpNum(lump, PU_LEVEL);
-
     // 0. Uncompress nodes lump (or simply skip header)
 
     if (compressed)
     {
 #ifdef HAVE_LIBZ
-	const int len =  W_LumpLength(lump);
-	int outlen, err;
-	z_stream *zstream;
-
-	// first estimate for compression rate:
-	// output buffer size == 2.5 * input size
-	outlen = 2.5 * len;
-	output = Z_Malloc(outlen, PU_STATIC, 0);
-
-	// initialize stream state for decompression
-	zstream = malloc(sizeof(*zstream));
-	memset(zstream, 0, sizeof(*zstream));
-	zstream->next_in = data + 4;
-	zstream->avail_in = len - 4;
-	zstream->next_out = output;
-	zstream->avail_out = outlen;
-
-	if (inflateInit(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression initialization!");
-
-	// resize if output buffer runs full
-	while ((err = inflate(zstream, Z_SYNC_FLUSH)) == Z_OK)
+	if (inflated == NULL)
 	{
-	    int outlen_old = outlen;
-	    outlen = 2 * outlen_old;
-	    output = I_Realloc(output, outlen);
-	    zstream->next_out = output + outlen_old;
-	    zstream->avail_out = outlen - outlen_old;
-	}
-
-	if (err != Z_STREAM_END)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression!");
+	    inflated = P_InflateNodes_ZDBSP(W_CacheLumpNum(lump, PU_STATIC),
+	                                    W_LumpLength(lump), &error);
 
-	fprintf(stderr, "P_LoadNodes: ZDBSP nodes compression ratio %.3f\n",
-	        (float)zstream->total_out/zstream->total_in);
-
-	data = output;
+	    // release the original data lump
+	    W_ReleaseLumpNum(lump);
 
-	if (inflateEnd(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression shut-down!");
+	    if (inflated == NULL)
+		I_Error("%s", error);
+	}
 
-	// release the original data lump
-	W_ReleaseLumpNum(lump);
-	free(zstream);
+	data = output = inflated;
 #else
 	I_Error("P_LoadNodes: Compressed ZDBSP nodes are not supported!");
 #endif
     }
     else
     {
+	data = W_CacheLumpNum(lump, PU_LEVEL);
+
 	// skip header
 	data += 4;
     }
@@ -460,7 +522,7 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
 
 #ifdef HAVE_LIBZ
     if (compressed)
-	Z_Free(output);
+	free(output);
     else
 #endif
     W_ReleaseLumpNum(lump);
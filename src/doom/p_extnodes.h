@@ -36,7 +36,9 @@ extern mapformat_t P_CheckMapFormat (int lumpnum);
 extern void P_LoadSegs_DeePBSP (int lump);
 extern void P_LoadSubsectors_DeePBSP (int lump);
 extern void P_LoadNodes_DeePBSP (int lump);
-extern void P_LoadNodes_ZDBSP (int lump, boolean compressed);
+extern byte *P_InflateNodes_ZDBSP (const byte *data, int len,
+                                   const char **error);
+extern void P_LoadNodes_ZDBSP (int lump, boolean compressed, byte *inflated);
 extern void P_LoadThings_Hexen (int lump);
 extern void P_LoadLineDefs_Hexen (int lump);
 
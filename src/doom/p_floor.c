@@ -346,8 +346,8 @@ EV_DoFloor
 	
 	// new floor thinker
 	rtn = 1;
-	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-	P_AddThinker (&floor->thinker);
+	floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
+	P_AddThinker (&floor->thinker, th_misc);
 	sec->floordata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
 	floor->type = floortype;
@@ -549,8 +549,8 @@ EV_BuildStairs
 	
 	// new floor thinker
 	rtn = 1;
-	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-	P_AddThinker (&floor->thinker);
+	floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
+	P_AddThinker (&floor->thinker, th_misc);
 	sec->floordata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
 	floor->direction = 1;
@@ -605,9 +605,9 @@ EV_BuildStairs
 					
 		sec = tsec;
 		secnum = newsecnum;
-		floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+		floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
 
-		P_AddThinker (&floor->thinker);
+		P_AddThinker (&floor->thinker, th_misc);
 
 		sec->floordata = floor;
 		floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -710,9 +710,9 @@ int EV_DoElevator
 
     // create and initialize new elevator thinker
     rtn = 1;
-    elevator = Z_Malloc (sizeof(*elevator), PU_LEVSPEC, 0);
+    elevator = P_AllocateThinker (sizeof(*elevator), PU_LEVSPEC);
     memset(elevator, 0, sizeof(*elevator));
-    P_AddThinker (&elevator->thinker);
+    P_AddThinker (&elevator->thinker, th_misc);
     sec->floordata = elevator; //jff 2/22/98
     sec->ceilingdata = elevator; //jff 2/22/98
     elevator->thinker.function.acp1 = (actionf_p1) T_MoveElevator;
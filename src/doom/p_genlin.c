@@ -109,9 +109,9 @@ int EV_DoGenFloor
 
     // new floor thinker
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
     memset(floor, 0, sizeof(*floor));
-    P_AddThinker (&floor->thinker);
+    P_AddThinker (&floor->thinker, th_misc);
     sec->floordata = floor;
     floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
     floor->crush = Crsh;
@@ -311,9 +311,9 @@ int EV_DoGenCeiling
 
     // new ceiling thinker
     rtn = 1;
-    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
+    ceiling = P_AllocateThinker (sizeof(*ceiling), PU_LEVSPEC);
     memset(ceiling, 0, sizeof(*ceiling));
-    P_AddThinker (&ceiling->thinker);
+    P_AddThinker (&ceiling->thinker, th_misc);
     sec->ceilingdata = ceiling; //jff 2/22/98
     ceiling->thinker.function.acp1 = (actionf_p1) T_MoveCeiling;
     ceiling->crush = Crsh;
@@ -516,9 +516,9 @@ int EV_DoGenLift
 
     // Setup the plat thinker
     rtn = 1;
-    plat = Z_Malloc( sizeof(*plat), PU_LEVSPEC, 0);
+    plat = P_AllocateThinker (sizeof(*plat), PU_LEVSPEC);
     memset(plat, 0, sizeof(*plat));
-    P_AddThinker(&plat->thinker);
+    P_AddThinker(&plat->thinker, th_misc);
 
     plat->sector = sec;
     plat->sector->floordata = plat;
@@ -676,9 +676,9 @@ int EV_DoGenStairs
 
     // new floor thinker
     rtn = 1;
-    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+    floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
     memset(floor, 0, sizeof(*floor));
-    P_AddThinker (&floor->thinker);
+    P_AddThinker (&floor->thinker, th_misc);
     sec->floordata = floor;
     floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
     floor->direction = Dirn? 1 : -1;
@@ -777,10 +777,10 @@ int EV_DoGenStairs
 
         sec = tsec;
         secnum = newsecnum;
-        floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+        floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
 
         memset(floor, 0, sizeof(*floor));
-        P_AddThinker (&floor->thinker);
+        P_AddThinker (&floor->thinker, th_misc);
 
         sec->floordata = floor;
         floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -860,9 +860,9 @@ int EV_DoGenCrusher
 
     // new ceiling thinker
     rtn = 1;
-    ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
+    ceiling = P_AllocateThinker (sizeof(*ceiling), PU_LEVSPEC);
     memset(ceiling, 0, sizeof(*ceiling));
-    P_AddThinker (&ceiling->thinker);
+    P_AddThinker (&ceiling->thinker, th_misc);
     sec->ceilingdata = ceiling; //jff 2/22/98
     ceiling->thinker.function.acp1 = (actionf_p1) T_MoveCeiling;
     ceiling->crush = true;
@@ -955,9 +955,9 @@ int EV_DoGenLockedDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
     memset(door, 0, sizeof(*door));
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_misc);
     sec->ceilingdata = door; //jff 2/22/98
 
     door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -1064,9 +1064,9 @@ int EV_DoGenDoor
 
     // new door thinker
     rtn = 1;
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door), PU_LEVSPEC);
     memset(door, 0, sizeof(*door));
-    P_AddThinker (&door->thinker);
+    P_AddThinker (&door->thinker, th_misc);
     sec->ceilingdata = door; //jff 2/22/98
 
     door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -0,0 +1,563 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Cache of the processed BSP geometry of a level: vertexes,
+//	segs, subsectors and nodes as they are once the nodes have
+//	been loaded (or inflated, for compressed ZDBSP nodes), slime
+//	trails removed and seg lengths and angles worked out.
+//
+//	The cache file is a header followed by flat arrays, with
+//	indices in place of pointers, so it can be read in one go and
+//	copied out. It is named after a hash of the map lumps the
+//	geometry was built from. Sectors, sidedefs and linedefs are
+//	not cached: they are cheap to load and refer to textures.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_config.h"
+#include "m_misc.h"
+#include "p_local.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+sector_t* GetSectorAtNullAddress(void);
+
+// Bump when anything that goes into the cached geometry changes,
+// to drop stale caches.
+
+#define LEVELCACHE_VERSION 1
+
+typedef struct
+{
+    char magic[8];
+    uint64_t hash;
+    int32_t version;
+    int32_t numlumpvertexes;    // vertexes in the VERTEXES lump
+    int32_t numvertexes;        // and added by the node builder
+    int32_t numsegs;
+    int32_t numsubsectors;
+    int32_t numnodes;
+} levelheader_t;
+
+typedef struct
+{
+    int32_t x, y;
+    int32_t r_x, r_y;
+    int32_t moved;
+} levelvertex_t;
+
+typedef struct
+{
+    int32_t v1, v2;
+    int32_t linedef;
+    int32_t side;
+    int32_t offset;
+    uint32_t angle;
+    uint32_t length;
+    uint32_t r_angle;
+    int32_t fakecontrast;
+} levelseg_t;
+
+typedef struct
+{
+    int32_t numlines;
+    int32_t firstline;
+} levelsubsector_t;
+
+typedef struct
+{
+    int32_t x, y, dx, dy;
+    int32_t bbox[2][4];
+    int32_t children[2];
+} levelnode_t;
+
+static boolean levelcache = false;
+static uint64_t levelhash;
+static int numlumpvertexes;
+
+// Cache file found by P_FindLevelCache, for P_LoadLevelCache.
+
+static byte *cachedata = NULL;
+
+static uint64_t HashLump(uint64_t hash, int lump)
+{
+    int32_t len;
+
+    len = W_LumpLength(lump);
+    hash = M_HashBytes(hash, &len, sizeof(len));
+    hash = M_HashBytes(hash, W_CacheLumpNum(lump, PU_STATIC), len);
+    W_ReleaseLumpNum(lump);
+
+    return hash;
+}
+
+static uint64_t HashLevelLumps(int lumpnum, int mapformat)
+{
+    uint64_t hash;
+    int32_t v[2];
+
+    hash = M_HASH_INIT;
+
+    v[0] = LEVELCACHE_VERSION;
+    v[1] = mapformat;
+    hash = M_HashBytes(hash, v, sizeof(v));
+
+    hash = HashLump(hash, lumpnum + ML_VERTEXES);
+    hash = HashLump(hash, lumpnum + ML_LINEDEFS);
+    hash = HashLump(hash, lumpnum + ML_SSECTORS);
+    hash = HashLump(hash, lumpnum + ML_SEGS);
+    hash = HashLump(hash, lumpnum + ML_NODES);
+
+    return hash;
+}
+
+static char *CacheFileName(uint64_t hash)
+{
+    char name[32];
+
+    M_snprintf(name, sizeof(name), "level%08x%08x.dat",
+               (unsigned int) (hash >> 32), (unsigned int) hash);
+
+    return M_StringJoin(configdir, name, NULL);
+}
+
+// Sidedef and sectors of a seg, as the node loaders set them.
+
+static void SetSegSides(seg_t *li, int side, int segnum)
+{
+    line_t *ldef;
+    int sidenum;
+
+    ldef = li->linedef;
+
+    if ((unsigned) ldef->sidenum[side] >= (unsigned) numsides)
+    {
+        I_Error("P_LoadSegs: linedef %d for seg %d references a "
+                "non-existent sidedef %d",
+                (int) (ldef - lines), segnum, (unsigned) ldef->sidenum[side]);
+    }
+
+    li->sidedef = &sides[ldef->sidenum[side]];
+    li->frontsector = sides[ldef->sidenum[side]].sector;
+
+    if (ldef->flags & ML_TWOSIDED)
+    {
+        sidenum = ldef->sidenum[side ^ 1];
+
+        if (sidenum < 0 || sidenum >= numsides)
+        {
+            if (li->sidedef->midtexture)
+            {
+                li->backsector = 0;
+                fprintf(stderr, "P_LoadSegs: Linedef %d has two-sided flag "
+                                "set, but no second sidedef\n", segnum);
+            }
+            else
+            {
+                li->backsector = GetSectorAtNullAddress();
+            }
+        }
+        else
+        {
+            li->backsector = sides[sidenum].sector;
+        }
+    }
+    else
+    {
+        li->backsector = 0;
+    }
+}
+
+// Whether the indices in the cached arrays are all in range, checked
+// before anything is changed, so that a stale or truncated cache can
+// still be left for the lump loaders.
+
+static boolean ValidLevelCache(levelheader_t *header, levelseg_t *ls,
+                               levelsubsector_t *lss, levelnode_t *ln)
+{
+    line_t *ldef;
+    int child;
+    int i, j;
+
+    for (i = 0; i < header->numsegs; i++, ls++)
+    {
+        if ((unsigned) ls->v1 >= header->numvertexes
+         || (unsigned) ls->v2 >= header->numvertexes
+         || (unsigned) ls->linedef >= numlines
+         || (unsigned) ls->side > 1)
+        {
+            return false;
+        }
+
+        ldef = &lines[ls->linedef];
+
+        if ((unsigned) ldef->sidenum[ls->side] >= (unsigned) numsides)
+        {
+            return false;
+        }
+    }
+
+    for (i = 0; i < header->numsubsectors; i++, lss++)
+    {
+        if (lss->firstline < 0 || lss->numlines < 0
+         || lss->numlines > header->numsegs - lss->firstline)
+        {
+            return false;
+        }
+    }
+
+    for (i = 0; i < header->numnodes; i++, ln++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            child = ln->children[j];
+
+            if (child & NF_SUBSECTOR)
+            {
+                if ((child & ~NF_SUBSECTOR) >= header->numsubsectors)
+                {
+                    return false;
+                }
+            }
+            else if (child >= header->numnodes)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Read the cache file and check its header. The rest can only be
+// checked once the linedefs have been loaded.
+
+static byte *ReadLevelCache(const char *filename)
+{
+    levelheader_t *header;
+    byte *data;
+    int len;
+
+    if (!M_FileExists(filename))
+    {
+        return NULL;
+    }
+
+    len = M_ReadFile(filename, &data);
+    header = (levelheader_t *) data;
+
+    if (len < sizeof(*header)
+     || memcmp(header->magic, "LEVELGEO", sizeof(header->magic))
+     || header->hash != levelhash
+     || header->version != LEVELCACHE_VERSION
+     || header->numlumpvertexes < 0
+     || header->numvertexes < header->numlumpvertexes
+     || header->numsubsectors < 1
+     || header->numsegs < 0 || header->numnodes < 0
+     || (uint64_t) len != sizeof(*header)
+             + (uint64_t) header->numvertexes * sizeof(levelvertex_t)
+             + (uint64_t) header->numsegs * sizeof(levelseg_t)
+             + (uint64_t) header->numsubsectors * sizeof(levelsubsector_t)
+             + (uint64_t) header->numnodes * sizeof(levelnode_t))
+    {
+        Z_Free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+static boolean CopyLevelCache(byte *data)
+{
+    levelheader_t *header;
+    levelvertex_t *lv;
+    levelseg_t *ls;
+    levelsubsector_t *lss;
+    levelnode_t *ln;
+    vertex_t *newvertexes;
+    int i, j, k;
+
+    header = (levelheader_t *) data;
+    lv = (levelvertex_t *) (header + 1);
+    ls = (levelseg_t *) (lv + header->numvertexes);
+    lss = (levelsubsector_t *) (ls + header->numsegs);
+    ln = (levelnode_t *) (lss + header->numsubsectors);
+
+    if (header->numlumpvertexes != numlumpvertexes
+     || !ValidLevelCache(header, ls, lss, ln))
+    {
+        return false;
+    }
+
+    // Vertexes added by the node builder go after those of the lump,
+    // so the linedefs need pointing at the new array.
+
+    if (header->numvertexes != numvertexes)
+    {
+        newvertexes = Z_Malloc(header->numvertexes * sizeof(vertex_t),
+                               PU_LEVEL, 0);
+
+        for (i = 0; i < numlines; i++)
+        {
+            lines[i].v1 = lines[i].v1 - vertexes + newvertexes;
+            lines[i].v2 = lines[i].v2 - vertexes + newvertexes;
+        }
+
+        Z_Free(vertexes);
+        vertexes = newvertexes;
+        numvertexes = header->numvertexes;
+    }
+
+    for (i = 0; i < numvertexes; i++, lv++)
+    {
+        vertexes[i].x = lv->x;
+        vertexes[i].y = lv->y;
+        vertexes[i].r_x = lv->r_x;
+        vertexes[i].r_y = lv->r_y;
+        vertexes[i].moved = lv->moved;
+    }
+
+    numsegs = header->numsegs;
+    segs = Z_Malloc(numsegs * sizeof(seg_t), PU_LEVEL, 0);
+    memset(segs, 0, numsegs * sizeof(seg_t));
+
+    for (i = 0; i < numsegs; i++, ls++)
+    {
+        segs[i].v1 = &vertexes[ls->v1];
+        segs[i].v2 = &vertexes[ls->v2];
+        segs[i].linedef = &lines[ls->linedef];
+        segs[i].offset = ls->offset;
+        segs[i].angle = ls->angle;
+        segs[i].length = ls->length;
+        segs[i].r_angle = ls->r_angle;
+        segs[i].fakecontrast = ls->fakecontrast;
+
+        SetSegSides(&segs[i], ls->side, i);
+    }
+
+    numsubsectors = header->numsubsectors;
+    subsectors = Z_Malloc(numsubsectors * sizeof(subsector_t), PU_LEVEL, 0);
+    memset(subsectors, 0, numsubsectors * sizeof(subsector_t));
+
+    for (i = 0; i < numsubsectors; i++, lss++)
+    {
+        subsectors[i].numlines = lss->numlines;
+        subsectors[i].firstline = lss->firstline;
+    }
+
+    numnodes = header->numnodes;
+    nodes = Z_Malloc(numnodes * sizeof(node_t), PU_LEVEL, 0);
+
+    for (i = 0; i < numnodes; i++, ln++)
+    {
+        nodes[i].x = ln->x;
+        nodes[i].y = ln->y;
+        nodes[i].dx = ln->dx;
+        nodes[i].dy = ln->dy;
+
+        for (j = 0; j < 2; j++)
+        {
+            nodes[i].children[j] = ln->children[j];
+
+            for (k = 0; k < 4; k++)
+            {
+                nodes[i].bbox[j][k] = ln->bbox[j][k];
+            }
+        }
+    }
+
+    return true;
+}
+
+//
+// P_FindLevelCache
+//
+// Called before anything of the level is loaded, so that compressed
+// nodes need not be inflated if the geometry is in the cache.
+// Returns true if a cache file was found for the level; it may still
+// be turned down by P_LoadLevelCache.
+//
+
+boolean P_FindLevelCache(int lumpnum, int mapformat)
+{
+    char *filename;
+
+    //!
+    // @category obscure
+    //
+    // Cache the BSP geometry of levels once it has been loaded and
+    // processed, in the configuration directory, to cut the time
+    // taken to load large maps, especially with compressed nodes.
+    //
+
+    levelcache = M_ParmExists("-levelcache");
+
+    if (cachedata != NULL)
+    {
+        Z_Free(cachedata);
+        cachedata = NULL;
+    }
+
+    if (!levelcache)
+    {
+        return false;
+    }
+
+    levelhash = HashLevelLumps(lumpnum, mapformat);
+
+    filename = CacheFileName(levelhash);
+    cachedata = ReadLevelCache(filename);
+    free(filename);
+
+    return cachedata != NULL;
+}
+
+//
+// P_LoadLevelCache
+//
+// Called in place of the node loaders, with the vertexes, sidedefs
+// and linedefs loaded. Returns true if the BSP geometry came from
+// the cache, in which case it is complete: slime trails have been
+// removed and seg lengths set.
+//
+
+boolean P_LoadLevelCache(void)
+{
+    boolean result;
+
+    if (!levelcache)
+    {
+        return false;
+    }
+
+    numlumpvertexes = numvertexes;
+
+    if (cachedata == NULL)
+    {
+        return false;
+    }
+
+    result = CopyLevelCache(cachedata);
+    Z_Free(cachedata);
+    cachedata = NULL;
+
+    return result;
+}
+
+//
+// P_SaveLevelCache
+//
+// Called once the BSP geometry has been built from the lumps.
+//
+
+void P_SaveLevelCache(void)
+{
+    levelheader_t header;
+    levelvertex_t lv;
+    levelseg_t ls;
+    levelsubsector_t lss;
+    levelnode_t ln;
+    char *filename;
+    FILE *fp;
+    int i, j, k;
+
+    if (!levelcache)
+    {
+        return;
+    }
+
+    filename = CacheFileName(levelhash);
+    fp = fopen(filename, "wb");
+    free(filename);
+
+    if (fp == NULL)
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "LEVELGEO", sizeof(header.magic));
+    header.hash = levelhash;
+    header.version = LEVELCACHE_VERSION;
+    header.numlumpvertexes = numlumpvertexes;
+    header.numvertexes = numvertexes;
+    header.numsegs = numsegs;
+    header.numsubsectors = numsubsectors;
+    header.numnodes = numnodes;
+
+    fwrite(&header, sizeof(header), 1, fp);
+
+    for (i = 0; i < numvertexes; i++)
+    {
+        lv.x = vertexes[i].x;
+        lv.y = vertexes[i].y;
+        lv.r_x = vertexes[i].r_x;
+        lv.r_y = vertexes[i].r_y;
+        lv.moved = vertexes[i].moved;
+
+        fwrite(&lv, sizeof(lv), 1, fp);
+    }
+
+    for (i = 0; i < numsegs; i++)
+    {
+        ls.v1 = segs[i].v1 - vertexes;
+        ls.v2 = segs[i].v2 - vertexes;
+        ls.linedef = segs[i].linedef - lines;
+        ls.side = segs[i].sidedef != &sides[segs[i].linedef->sidenum[0]];
+        ls.offset = segs[i].offset;
+        ls.angle = segs[i].angle;
+        ls.length = segs[i].length;
+        ls.r_angle = segs[i].r_angle;
+        ls.fakecontrast = segs[i].fakecontrast;
+
+        fwrite(&ls, sizeof(ls), 1, fp);
+    }
+
+    for (i = 0; i < numsubsectors; i++)
+    {
+        lss.numlines = subsectors[i].numlines;
+        lss.firstline = subsectors[i].firstline;
+
+        fwrite(&lss, sizeof(lss), 1, fp);
+    }
+
+    for (i = 0; i < numnodes; i++)
+    {
+        ln.x = nodes[i].x;
+        ln.y = nodes[i].y;
+        ln.dx = nodes[i].dx;
+        ln.dy = nodes[i].dy;
+
+        for (j = 0; j < 2; j++)
+        {
+            ln.children[j] = nodes[i].children[j];
+
+            for (k = 0; k < 4; k++)
+            {
+                ln.bbox[j][k] = nodes[i].bbox[j][k];
+            }
+        }
+
+        fwrite(&ln, sizeof(ln), 1, fp);
+    }
+
+    fclose(fp);
+}
@@ -70,10 +70,25 @@
 // both the head and tail of the thinker list
 extern	thinker_t	thinkercap;	
 
+// Thinkers are also kept in one list per class, in the same
+// order as in thinkercap, so that a scan for mobjs need not
+// step over every door and light. Thinkers leave their class
+// list as soon as they are removed.
+typedef enum
+{
+    th_mobj,		// function is P_MobjThinker
+    th_misc,		// movers, lights and everything else
+    NUMTHCLASS
+} th_class;
+
+extern	thinker_t	thinkerclasscap[NUMTHCLASS];
+
 
 void P_InitThinkers (void);
-void P_AddThinker (thinker_t* thinker);
+void* P_AllocateThinker (size_t size, int tag);
+void P_AddThinker (thinker_t* thinker, th_class thclass);
 void P_RemoveThinker (thinker_t* thinker);
+void P_ReclaimThinkers (void);
 
 
 //
@@ -182,6 +197,8 @@ void 	P_LineOpening (line_t* linedef);
 
 boolean P_BlockLinesIterator (int x, int y, boolean(*func)(line_t*) );
 boolean P_BlockThingsIterator (int x, int y, boolean(*func)(mobj_t*) );
+boolean P_BlockThingsIteratorBox (int x, int y, fixed_t* box, boolean(*func)(mobj_t*) );
+void	P_InitThingGrid (void);
 
 #define PT_ADDLINES		1
 #define PT_ADDTHINGS	2
@@ -276,6 +293,19 @@ extern mobj_t**		blocklinks;	// for thing chains
 
 // [crispy] factor out map lump name and number finding into a separate function
 extern int P_GetNumForMap (int episode, int map, boolean critical);
+void P_PrefetchLevel (int episode, int map);
+
+//
+// P_REJECT
+//
+void P_UpgradeReject (void);
+
+//
+// P_LEVELCACHE
+//
+boolean P_FindLevelCache (int lumpnum, int mapformat);
+boolean P_LoadLevelCache (void);
+void P_SaveLevelCache (void);
 
 // [crispy] blinking key or skull in the status bar
 #define KEYBLINKMASK 0x8
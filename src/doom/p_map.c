@@ -177,7 +177,7 @@ P_TeleportMove
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_StompThing))
+	    if (!P_BlockThingsIteratorBox(bx,by,tmbbox,PIT_StompThing))
 		return false;
     
     // the move is ok,
@@ -453,7 +453,7 @@ P_CheckPosition
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+	    if (!P_BlockThingsIteratorBox(bx,by,tmbbox,PIT_CheckThing))
 		return false;
     
     // check lines
@@ -1266,6 +1266,7 @@ P_RadiusAttack
     int		yh;
     
     fixed_t	dist;
+    fixed_t	box[4];
 	
     dist = (damage+MAXRADIUS)<<FRACBITS;
     yh = (spot->y + dist - bmaporgy)>>MAPBLOCKSHIFT;
@@ -1275,10 +1276,16 @@ P_RadiusAttack
     bombspot = spot;
     bombsource = source;
     bombdamage = damage;
+
+    // Things further away than this are out of range.
+    box[BOXTOP] = spot->y + (damage<<FRACBITS);
+    box[BOXBOTTOM] = spot->y - (damage<<FRACBITS);
+    box[BOXRIGHT] = spot->x + (damage<<FRACBITS);
+    box[BOXLEFT] = spot->x - (damage<<FRACBITS);
 	
     for (y=yl ; y<=yh ; y++)
 	for (x=xl ; x<=xh ; x++)
-	    P_BlockThingsIterator (x, y, PIT_RadiusAttack );
+	    P_BlockThingsIteratorBox (x, y, box, PIT_RadiusAttack );
 }
 
 
@@ -22,11 +22,15 @@
 
 
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #include "i_system.h" // [crispy] I_Realloc()
+#include "m_argv.h"
 #include "m_bbox.h"
+#include "z_zone.h"
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -294,6 +298,155 @@ void P_LineOpening (line_t* linedef)
 }
 
 
+//
+// THING GRID
+// A finer copy of the blocklinks, THINGGRIDCELLS by
+// THINGGRIDCELLS cells to a mapblock, so that a query for
+// a small area does not have to look at every thing in the
+// mapblocks it touches. Each link gets a sequence number,
+// which lets P_BlockThingsIteratorBox put the things of a
+// mapblock back in blocklinks order.
+//
+
+#define THINGGRIDSHIFT		(MAPBLOCKSHIFT-2)
+#define THINGGRIDCELLS		(1<<(MAPBLOCKSHIFT-THINGGRIDSHIFT))
+
+// Anything bigger is left to the blockmap alone.
+#define MAXTHINGGRID		(1<<22)
+
+static mobj_t**		thinggrid;
+static int		thinggridwidth;
+static int		thinggridheight;
+static unsigned int	thinggridseq;
+
+// No thing on the level has a larger radius.
+static fixed_t		thinggridradius;
+
+
+//
+// P_InitThingGrid
+// Called after the blockmap has been set up.
+//
+void P_InitThingGrid (void)
+{
+    int		count;
+    int		i;
+
+    thinggrid = NULL;
+    thinggridseq = 0;
+
+    //!
+    // @category obscure
+    //
+    // Do not keep the finer grid used for thing-vs-thing
+    // collision checks.
+    //
+
+    if (M_CheckParm("-nothinggrid"))
+	return;
+
+    thinggridwidth = bmapwidth * THINGGRIDCELLS;
+    thinggridheight = bmapheight * THINGGRIDCELLS;
+
+    if ((int64_t) thinggridwidth * thinggridheight > MAXTHINGGRID)
+	return;
+
+    thinggridradius = 0;
+
+    for (i = 0; i < NUMMOBJTYPES; i++)
+    {
+	if (mobjinfo[i].radius > thinggridradius)
+	    thinggridradius = mobjinfo[i].radius;
+    }
+
+    count = sizeof(*thinggrid) * thinggridwidth * thinggridheight;
+    thinggrid = Z_Malloc(count, PU_LEVEL, 0);
+    memset(thinggrid, 0, count);
+}
+
+
+//
+// P_RenumberThingGrid
+// Restart the sequence numbers when they are about to wrap.
+// Only their order within a mapblock matters.
+//
+static void P_RenumberThingGrid (void)
+{
+    mobj_t*	mobj;
+    unsigned int	count;
+    int		i;
+
+    thinggridseq = 0;
+
+    for (i = 0; i < bmapwidth * bmapheight; i++)
+    {
+	count = 0;
+
+	for (mobj = blocklinks[i]; mobj; mobj = mobj->bnext)
+	    count++;
+
+	if (count > thinggridseq)
+	    thinggridseq = count;
+
+	for (mobj = blocklinks[i]; mobj; mobj = mobj->bnext)
+	    mobj->linkseq = count--;
+    }
+}
+
+
+static void P_UnlinkThingGrid (mobj_t* thing)
+{
+    int		gridx;
+    int		gridy;
+
+    if (thing->gnext)
+	thing->gnext->gprev = thing->gprev;
+
+    if (thing->gprev)
+	thing->gprev->gnext = thing->gnext;
+    else
+    {
+	gridx = (thing->x - bmaporgx)>>THINGGRIDSHIFT;
+	gridy = (thing->y - bmaporgy)>>THINGGRIDSHIFT;
+
+	if (gridx>=0 && gridx < thinggridwidth
+	    && gridy>=0 && gridy < thinggridheight)
+	{
+	    thinggrid[gridy*thinggridwidth+gridx] = thing->gnext;
+	}
+    }
+}
+
+
+static void P_LinkThingGrid (mobj_t* thing)
+{
+    int		gridx;
+    int		gridy;
+    mobj_t**	link;
+
+    // The mapblock is on the map, so the cell is too.
+    gridx = (thing->x - bmaporgx)>>THINGGRIDSHIFT;
+    gridy = (thing->y - bmaporgy)>>THINGGRIDSHIFT;
+
+    if (thinggridseq == UINT_MAX)
+	P_RenumberThingGrid ();
+
+    thing->linkseq = ++thinggridseq;
+
+    if (thing->radius > thinggridradius)
+	thinggridradius = thing->radius;
+
+    link = &thinggrid[gridy*thinggridwidth+gridx];
+    thing->gprev = NULL;
+    thing->gnext = *link;
+    if (*link)
+	(*link)->gprev = thing;
+
+    *link = thing;
+}
+
+
+
 //
 // THING POSITION SETTING
 //
@@ -344,6 +497,9 @@ void P_UnsetThingPosition (mobj_t* thing)
 		blocklinks[blocky*bmapwidth+blockx] = thing->bnext;
 	    }
 	}
+
+	if (thinggrid)
+	    P_UnlinkThingGrid (thing);
     }
 }
 
@@ -402,11 +558,15 @@ P_SetThingPosition (mobj_t* thing)
 		(*link)->bprev = thing;
 
 	    *link = thing;
+
+	    if (thinggrid)
+		P_LinkThingGrid (thing);
 	}
 	else
 	{
 	    // thing is off the map
 	    thing->bnext = thing->bprev = NULL;
+	    thing->gnext = thing->gprev = NULL;
 	}
     }
 }
@@ -499,6 +659,91 @@ P_BlockThingsIterator
 }
 
 
+//
+// P_BlockThingsIteratorBox
+// Like P_BlockThingsIterator, but skips things too far
+// from the box to touch it: those whose origin is more
+// than the radius of the largest thing outside of it.
+// Only for PIT_* functions that ignore such things anyway.
+//
+boolean
+P_BlockThingsIteratorBox
+( int			x,
+  int			y,
+  fixed_t*		box,
+  boolean(*func)(mobj_t*) )
+{
+    mobj_t*		cursor[THINGGRIDCELLS*THINGGRIDCELLS];
+    mobj_t*		mobj;
+    int			numcursors;
+    int			best;
+    int			i;
+    int			gx, gxl, gxh;
+    int			gy, gyl, gyh;
+
+    if (!thinggrid)
+	return P_BlockThingsIterator (x, y, func);
+
+    if ( x<0
+	 || y<0
+	 || x>=bmapwidth
+	 || y>=bmapheight)
+    {
+	return true;
+    }
+
+    // The cells of this mapblock that the box reaches.
+    gxl = (box[BOXLEFT] - thinggridradius - bmaporgx)>>THINGGRIDSHIFT;
+    gxh = (box[BOXRIGHT] + thinggridradius - bmaporgx)>>THINGGRIDSHIFT;
+    gyl = (box[BOXBOTTOM] - thinggridradius - bmaporgy)>>THINGGRIDSHIFT;
+    gyh = (box[BOXTOP] + thinggridradius - bmaporgy)>>THINGGRIDSHIFT;
+
+    gxl = MAX(gxl, x*THINGGRIDCELLS);
+    gxh = MIN(gxh, x*THINGGRIDCELLS + THINGGRIDCELLS-1);
+    gyl = MAX(gyl, y*THINGGRIDCELLS);
+    gyh = MIN(gyh, y*THINGGRIDCELLS + THINGGRIDCELLS-1);
+
+    numcursors = 0;
+
+    for (gy = gyl ; gy <= gyh ; gy++)
+    {
+	for (gx = gxl ; gx <= gxh ; gx++)
+	{
+	    mobj = thinggrid[gy*thinggridwidth+gx];
+
+	    if (mobj)
+		cursor[numcursors++] = mobj;
+	}
+    }
+
+    // The blocklinks chain is newest first, so always take the
+    // most recently linked thing of all the cells. The next link
+    // is only read after func, as in P_BlockThingsIterator.
+    while (numcursors > 0)
+    {
+	best = 0;
+
+	for (i = 1 ; i < numcursors ; i++)
+	{
+	    if (cursor[i]->linkseq > cursor[best]->linkseq)
+		best = i;
+	}
+
+	mobj = cursor[best];
+
+	if (!func( mobj ) )
+	    return false;
+
+	cursor[best] = mobj->gnext;
+
+	if (!cursor[best])
+	    cursor[best] = cursor[--numcursors];
+    }
+
+    return true;
+}
+
+
 
 //
 // INTERCEPT ROUTINES
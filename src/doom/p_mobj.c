@@ -525,7 +525,7 @@ P_SpawnMobj
     state_t*	st;
     mobjinfo_t*	info;
 	
-    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+    mobj = P_AllocateThinker (sizeof(*mobj), PU_LEVEL);
     memset (mobj, 0, sizeof (*mobj));
     info = &mobjinfo[type];
 	
@@ -566,7 +566,7 @@ P_SpawnMobj
 
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
-    P_AddThinker (&mobj->thinker);
+    P_AddThinker (&mobj->thinker, th_mobj);
 
     return mobj;
 }
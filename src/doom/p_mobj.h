@@ -227,6 +227,12 @@ typedef struct mobj_s
     // Links in blocks (if needed).
     struct mobj_s*	bnext;
     struct mobj_s*	bprev;
+
+    // Links in the finer thing grid, and when the
+    // thing was linked, see P_BlockThingsIteratorBox.
+    struct mobj_s*	gnext;
+    struct mobj_s*	gprev;
+    unsigned int	linkseq;
     
     struct subsector_s*	subsector;
 
@@ -0,0 +1,779 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Sector to sector sight table, built from the map geometry and
+//	merged into the REJECT matrix, for PWADs that ship an empty or
+//	poor REJECT lump.
+//
+//	A sight line leaves its sector through two sided lines only, so
+//	it is traced as a chain of "portals". Following the chain from
+//	each sector, the next portal is clipped to the wedge that could
+//	be seen through the source portal and the last one passed, in
+//	the manner of a Quake vis flow. Heights are ignored, since doors
+//	and lifts move. Everything is rounded in favour of visibility:
+//	portals are lengthened and clipping is done with a tolerance, and
+//	a sector whose flow gets too expensive falls back to a simple
+//	flood through the portals in front of its own.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_config.h"
+#include "m_misc.h"
+#include "p_local.h"
+#include "z_zone.h"
+
+// Bump when the way the table is built changes, to drop stale caches.
+
+#define SIGHT_VERSION 1
+
+// Portals are lengthened by this much at each end, and points this
+// close to the wrong side of a clipping line are kept, to cover the
+// integer rounding in P_DivlineSide.
+
+#define PORTAL_EXTEND 2.0
+#define CLIP_EPSILON 1.0
+
+// Portal steps that one sector's flow may take before it falls back
+// to the coarser per-portal flood.
+
+#define FLOW_BUDGET (1 << 12)
+
+// Give up on maps where the per-portal flood sets would need more.
+
+#define MAX_FLOOD_BYTES (64 * 1024 * 1024)
+
+typedef struct
+{
+    double x1, y1;
+    double x2, y2;
+} winding_t;
+
+// A two sided line, crossed in one direction. The sector being
+// entered is on the left of (x1,y1)->(x2,y2).
+
+typedef struct
+{
+    winding_t w;
+    int line;
+    int from;
+    int to;
+} portal_t;
+
+static portal_t *portals;
+static int numportals;
+
+// Portals leaving each sector: sectorportals[firstportal[s] ..
+// firstportal[s + 1] - 1].
+
+static int *firstportal;
+static int *sectorportals;
+
+// For every portal, the sectors that a sight line through it could
+// possibly reach, tested against the portal itself only.
+
+static byte *portalflood;
+static int floodbytes;
+
+static boolean *onstack;
+static byte *visible;
+static byte **mightstack;
+static int flowsteps;
+
+#define TESTBIT(set, n) ((set)[(n) >> 3] & (1 << ((n) & 7)))
+#define SETBIT(set, n) ((set)[(n) >> 3] |= (1 << ((n) & 7)))
+
+// Signed distance of (x,y) from the line through w; positive on the
+// left.
+
+static double PointDist(const winding_t *w, double x, double y)
+{
+    double dx, dy, len;
+
+    dx = w->x2 - w->x1;
+    dy = w->y2 - w->y1;
+    len = sqrt(dx * dx + dy * dy);
+
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    return (dx * (y - w->y1) - dy * (x - w->x1)) / len;
+}
+
+// Cut w down to the part within CLIP_EPSILON of the given side of the
+// line (sign 1 for left, -1 for right). Returns false if nothing is left.
+
+static boolean ClipWinding(winding_t *w, const winding_t *line, double sign)
+{
+    double d1, d2, t;
+
+    d1 = sign * PointDist(line, w->x1, w->y1) + CLIP_EPSILON;
+    d2 = sign * PointDist(line, w->x2, w->y2) + CLIP_EPSILON;
+
+    if (d1 >= 0 && d2 >= 0)
+    {
+        return true;
+    }
+
+    if (d1 < 0 && d2 < 0)
+    {
+        return false;
+    }
+
+    t = d1 / (d1 - d2);
+
+    if (d1 < 0)
+    {
+        w->x1 += t * (w->x2 - w->x1);
+        w->y1 += t * (w->y2 - w->y1);
+    }
+    else
+    {
+        w->x2 = w->x1 + t * (w->x2 - w->x1);
+        w->y2 = w->y1 + t * (w->y2 - w->y1);
+    }
+
+    return true;
+}
+
+// Clip target to what can be seen from source through pass. Each line
+// through an end of source and an end of pass that has the rest of
+// source on one side and the rest of pass on the other bounds the
+// region beyond pass.
+
+static boolean ClipToSeparators(winding_t *target, const winding_t *source,
+                                const winding_t *pass)
+{
+    double sx[2], sy[2], px[2], py[2];
+    winding_t sep;
+    double ds, dp;
+    int i, j;
+
+    sx[0] = source->x1; sy[0] = source->y1;
+    sx[1] = source->x2; sy[1] = source->y2;
+    px[0] = pass->x1; py[0] = pass->y1;
+    px[1] = pass->x2; py[1] = pass->y2;
+
+    for (i = 0; i < 2; ++i)
+    {
+        for (j = 0; j < 2; ++j)
+        {
+            sep.x1 = sx[i]; sep.y1 = sy[i];
+            sep.x2 = px[j]; sep.y2 = py[j];
+
+            if (fabs(sep.x2 - sep.x1) + fabs(sep.y2 - sep.y1) < 1.0)
+            {
+                continue;
+            }
+
+            ds = PointDist(&sep, sx[i ^ 1], sy[i ^ 1]);
+            dp = PointDist(&sep, px[j ^ 1], py[j ^ 1]);
+
+            if (!((ds < 0 && dp > 0) || (ds > 0 && dp < 0)))
+            {
+                continue;
+            }
+
+            if (!ClipWinding(target, &sep, dp > 0 ? 1 : -1))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void AddPortal(int line, int from, int to, vertex_t *v1, vertex_t *v2)
+{
+    portal_t *p;
+    double dx, dy, len;
+
+    p = &portals[numportals++];
+    p->line = line;
+    p->from = from;
+    p->to = to;
+
+    p->w.x1 = (double) v1->x / FRACUNIT;
+    p->w.y1 = (double) v1->y / FRACUNIT;
+    p->w.x2 = (double) v2->x / FRACUNIT;
+    p->w.y2 = (double) v2->y / FRACUNIT;
+
+    dx = p->w.x2 - p->w.x1;
+    dy = p->w.y2 - p->w.y1;
+    len = sqrt(dx * dx + dy * dy);
+
+    if (len > 0)
+    {
+        dx *= PORTAL_EXTEND / len;
+        dy *= PORTAL_EXTEND / len;
+        p->w.x1 -= dx; p->w.y1 -= dy;
+        p->w.x2 += dx; p->w.y2 += dy;
+    }
+}
+
+static void CollectPortals(void)
+{
+    line_t *line;
+    int *count;
+    int i, s;
+
+    portals = Z_Malloc(2 * numlines * sizeof(*portals), PU_STATIC, NULL);
+    sectorportals = Z_Malloc(2 * numlines * sizeof(*sectorportals),
+                             PU_STATIC, NULL);
+    numportals = 0;
+
+    // Same rule as P_CrossSubsector: anything else blocks sight.
+    // Lines with the same sector on both sides do not change sector
+    // and can be ignored.
+
+    for (i = 0; i < numlines; ++i)
+    {
+        line = &lines[i];
+
+        if (!(line->flags & ML_TWOSIDED) || line->backsector == NULL
+         || line->frontsector == line->backsector)
+        {
+            continue;
+        }
+
+        // The front sector is on the right of v1->v2.
+
+        AddPortal(i, line->frontsector->id, line->backsector->id,
+                  line->v1, line->v2);
+        AddPortal(i, line->backsector->id, line->frontsector->id,
+                  line->v2, line->v1);
+    }
+
+    // Bucket the portals by the sector they leave.
+
+    firstportal = Z_Malloc((numsectors + 1) * sizeof(*firstportal),
+                           PU_STATIC, NULL);
+    count = Z_Malloc((numsectors + 1) * sizeof(*count), PU_STATIC, NULL);
+    memset(count, 0, (numsectors + 1) * sizeof(*count));
+
+    for (i = 0; i < numportals; ++i)
+    {
+        ++count[portals[i].from + 1];
+    }
+
+    for (s = 0; s < numsectors; ++s)
+    {
+        count[s + 1] += count[s];
+    }
+
+    memcpy(firstportal, count, (numsectors + 1) * sizeof(*firstportal));
+
+    for (i = 0; i < numportals; ++i)
+    {
+        s = portals[i].from;
+        sectorportals[count[s]++] = i;
+    }
+
+    Z_Free(count);
+}
+
+// Flood from portal base through every portal that has a point in
+// front of base, and to which base has a point behind.
+
+static void SimpleFlood(int base, byte *flood, byte *seen, int *stack)
+{
+    const portal_t *p;
+    winding_t w;
+    int sp, sector;
+    int i, n;
+
+    SETBIT(flood, portals[base].to);
+
+    stack[0] = base;
+    sp = 1;
+
+    while (sp > 0)
+    {
+        sector = portals[stack[--sp]].to;
+
+        for (i = firstportal[sector]; i < firstportal[sector + 1]; ++i)
+        {
+            n = sectorportals[i];
+            p = &portals[n];
+
+            if (TESTBIT(seen, n) || p->line == portals[base].line)
+            {
+                continue;
+            }
+
+            w = p->w;
+
+            if (!ClipWinding(&w, &portals[base].w, 1))
+            {
+                continue;
+            }
+
+            w = portals[base].w;
+
+            if (!ClipWinding(&w, &p->w, -1))
+            {
+                continue;
+            }
+
+            SETBIT(seen, n);
+            SETBIT(flood, p->to);
+            stack[sp++] = n;
+        }
+    }
+}
+
+static void BasePortalVis(void)
+{
+    byte *seen;
+    int *stack;
+    int i;
+
+    seen = Z_Malloc((numportals + 7) / 8, PU_STATIC, NULL);
+    stack = Z_Malloc((numportals + 1) * sizeof(*stack), PU_STATIC, NULL);
+
+    for (i = 0; i < numportals; ++i)
+    {
+        memset(portalflood + i * floodbytes, 0, floodbytes);
+        memset(seen, 0, (numportals + 7) / 8);
+
+        SimpleFlood(i, portalflood + i * floodbytes, seen, stack);
+    }
+
+    Z_Free(stack);
+    Z_Free(seen);
+}
+
+static boolean RecursiveFlow(const winding_t *source, const winding_t *pass,
+                             int sector, const byte *might, int depth)
+{
+    const portal_t *p;
+    winding_t src, target;
+    const byte *flood;
+    byte *newmight;
+    boolean more;
+    int i, j, n;
+
+    if (mightstack[depth] == NULL)
+    {
+        mightstack[depth] = Z_Malloc(floodbytes, PU_STATIC, NULL);
+    }
+
+    newmight = mightstack[depth];
+
+    for (i = firstportal[sector]; i < firstportal[sector + 1]; ++i)
+    {
+        n = sectorportals[i];
+        p = &portals[n];
+
+        if (onstack[p->line] || !TESTBIT(might, p->to))
+        {
+            continue;
+        }
+
+        // Only go on if something not yet known to be visible might
+        // be found through this portal.
+
+        flood = portalflood + n * floodbytes;
+        more = false;
+
+        for (j = 0; j < floodbytes; ++j)
+        {
+            newmight[j] = might[j] & flood[j];
+
+            if (newmight[j] & ~visible[j])
+            {
+                more = true;
+            }
+        }
+
+        if (!more)
+        {
+            continue;
+        }
+
+        if (++flowsteps > FLOW_BUDGET)
+        {
+            return false;
+        }
+
+        // The sight line goes through source, then pass, then target.
+
+        target = p->w;
+
+        if (!ClipWinding(&target, source, 1)
+         || !ClipWinding(&target, pass, 1))
+        {
+            continue;
+        }
+
+        src = *source;
+
+        if (!ClipWinding(&src, &target, -1))
+        {
+            continue;
+        }
+
+        if (pass != source && !ClipToSeparators(&target, &src, pass))
+        {
+            continue;
+        }
+
+        SETBIT(visible, p->to);
+
+        onstack[p->line] = true;
+
+        if (!RecursiveFlow(&src, &target, p->to, newmight, depth + 1))
+        {
+            onstack[p->line] = false;
+            return false;
+        }
+
+        onstack[p->line] = false;
+    }
+
+    return true;
+}
+
+// Mark the sectors that might be seen from sector s in visible.
+// Returns false if the flow was abandoned, in which case visible
+// holds the union of the floods instead.
+
+static boolean SectorFlow(int s)
+{
+    const portal_t *p;
+    const byte *flood;
+    int i, j, n;
+
+    memset(visible, 0, floodbytes);
+    SETBIT(visible, s);
+    flowsteps = 0;
+
+    for (i = firstportal[s]; i < firstportal[s + 1]; ++i)
+    {
+        n = sectorportals[i];
+        p = &portals[n];
+
+        SETBIT(visible, p->to);
+
+        onstack[p->line] = true;
+
+        if (!RecursiveFlow(&p->w, &p->w, p->to,
+                           portalflood + n * floodbytes, 0))
+        {
+            onstack[p->line] = false;
+            break;
+        }
+
+        onstack[p->line] = false;
+    }
+
+    if (i == firstportal[s + 1])
+    {
+        return true;
+    }
+
+    for (i = firstportal[s]; i < firstportal[s + 1]; ++i)
+    {
+        flood = portalflood + sectorportals[i] * floodbytes;
+
+        for (j = 0; j < floodbytes; ++j)
+        {
+            visible[j] |= flood[j];
+        }
+    }
+
+    return false;
+}
+
+// Build the table: bit (s1 * numsectors + s2) is set where s2 can
+// never be seen from s1.
+
+static boolean BuildSightTable(byte *hidden)
+{
+    byte *seen;
+    int gaveup;
+    int s1, s2;
+    int pnum;
+    int i;
+
+    floodbytes = (numsectors + 7) / 8;
+
+    CollectPortals();
+
+    if ((int64_t) numportals * floodbytes > MAX_FLOOD_BYTES)
+    {
+        fprintf(stderr, "P_UpgradeReject: map too big (%i portals)\n",
+                numportals);
+        Z_Free(portals);
+        Z_Free(sectorportals);
+        Z_Free(firstportal);
+        return false;
+    }
+
+    portalflood = Z_Malloc(numportals * floodbytes, PU_STATIC, NULL);
+    BasePortalVis();
+
+    onstack = Z_Malloc(numlines * sizeof(*onstack), PU_STATIC, NULL);
+    memset(onstack, 0, numlines * sizeof(*onstack));
+    mightstack = Z_Malloc((numlines + 1) * sizeof(*mightstack),
+                          PU_STATIC, NULL);
+    memset(mightstack, 0, (numlines + 1) * sizeof(*mightstack));
+    visible = Z_Malloc(floodbytes, PU_STATIC, NULL);
+
+    // Work out what each sector sees, then hide a pair only when
+    // neither side saw the other.
+
+    seen = Z_Malloc(numsectors * floodbytes, PU_STATIC, NULL);
+    gaveup = 0;
+
+    for (s1 = 0; s1 < numsectors; ++s1)
+    {
+        if (!SectorFlow(s1))
+        {
+            ++gaveup;
+        }
+
+        memcpy(seen + s1 * floodbytes, visible, floodbytes);
+    }
+
+    memset(hidden, 0, (numsectors * numsectors + 7) / 8);
+
+    for (s1 = 0; s1 < numsectors; ++s1)
+    {
+        for (s2 = 0; s2 < numsectors; ++s2)
+        {
+            if (!TESTBIT(seen + s1 * floodbytes, s2)
+             && !TESTBIT(seen + s2 * floodbytes, s1))
+            {
+                pnum = s1 * numsectors + s2;
+                SETBIT(hidden, pnum);
+            }
+        }
+    }
+
+    if (gaveup > 0)
+    {
+        fprintf(stderr, "P_UpgradeReject: full flow abandoned for %i "
+                        "of %i sectors\n", gaveup, numsectors);
+    }
+
+    for (i = 0; i <= numlines && mightstack[i] != NULL; ++i)
+    {
+        Z_Free(mightstack[i]);
+    }
+
+    Z_Free(seen);
+    Z_Free(visible);
+    Z_Free(mightstack);
+    Z_Free(onstack);
+    Z_Free(portalflood);
+    Z_Free(portals);
+    Z_Free(sectorportals);
+    Z_Free(firstportal);
+
+    return true;
+}
+
+// FNV-1a over everything the table is built from.
+
+static uint64_t HashMapGeometry(void)
+{
+    uint64_t hash;
+    int32_t v[7];
+    line_t *line;
+    int i;
+
+    hash = M_HASH_INIT;
+
+    v[0] = SIGHT_VERSION;
+    v[1] = numsectors;
+    v[2] = numlines;
+    hash = M_HashBytes(hash, v, 3 * sizeof(*v));
+
+    for (i = 0; i < numlines; ++i)
+    {
+        line = &lines[i];
+
+        v[0] = line->v1->x;
+        v[1] = line->v1->y;
+        v[2] = line->v2->x;
+        v[3] = line->v2->y;
+        v[4] = line->flags & ML_TWOSIDED;
+        v[5] = line->frontsector ? line->frontsector->id : -1;
+        v[6] = line->backsector ? line->backsector->id : -1;
+
+        hash = M_HashBytes(hash, v, sizeof(v));
+    }
+
+    return hash;
+}
+
+typedef struct
+{
+    char magic[8];
+    uint64_t hash;
+    int32_t numsectors;
+} sightheader_t;
+
+static char *CacheFileName(uint64_t hash)
+{
+    char name[32];
+
+    M_snprintf(name, sizeof(name), "sight%08x%08x.dat",
+               (unsigned int) (hash >> 32), (unsigned int) hash);
+
+    return M_StringJoin(configdir, name, NULL);
+}
+
+static boolean ReadCache(const char *filename, uint64_t hash,
+                         byte *hidden, int len)
+{
+    sightheader_t header;
+    FILE *fp;
+    boolean ok;
+
+    fp = fopen(filename, "rb");
+
+    if (fp == NULL)
+    {
+        return false;
+    }
+
+    ok = fread(&header, sizeof(header), 1, fp) == 1
+      && !memcmp(header.magic, "SIGHTTBL", sizeof(header.magic))
+      && header.hash == hash
+      && header.numsectors == numsectors
+      && fread(hidden, 1, len, fp) == len;
+
+    fclose(fp);
+
+    return ok;
+}
+
+static void WriteCache(const char *filename, uint64_t hash,
+                       const byte *hidden, int len)
+{
+    sightheader_t header;
+    FILE *fp;
+
+    fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SIGHTTBL", sizeof(header.magic));
+    header.hash = hash;
+    header.numsectors = numsectors;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(hidden, 1, len, fp);
+    fclose(fp);
+}
+
+//
+// P_UpgradeReject
+//
+// Called once the REJECT lump has been loaded.
+//
+
+void P_UpgradeReject(void)
+{
+    byte *hidden;
+    byte *matrix;
+    char *filename;
+    uint64_t hash;
+    int starttime;
+    int hiddenpairs;
+    int len;
+    int bits;
+    int i;
+
+    //!
+    // @category game
+    //
+    // Work out which sectors can never see each other when a level is
+    // loaded, and add them to the REJECT table, so that monsters
+    // spend less time checking sight on maps with an empty REJECT
+    // lump. Tables are cached in the configuration directory. Not
+    // used in demos and netgames, which must match Vanilla exactly.
+    //
+
+    if (!M_ParmExists("-sighttable") || demoplayback || demostarting
+     || demorecording || netgame)
+    {
+        return;
+    }
+
+    len = (numsectors * numsectors + 7) / 8;
+    hidden = Z_Malloc(len, PU_STATIC, NULL);
+
+    hash = HashMapGeometry();
+    filename = CacheFileName(hash);
+
+    if (!ReadCache(filename, hash, hidden, len))
+    {
+        starttime = I_GetTimeMS();
+
+        if (!BuildSightTable(hidden))
+        {
+            Z_Free(hidden);
+            free(filename);
+            return;
+        }
+
+        printf("P_UpgradeReject: built sight table in %i ms\n",
+               I_GetTimeMS() - starttime);
+
+        WriteCache(filename, hash, hidden, len);
+    }
+
+    free(filename);
+
+    // The REJECT lump may be straight from the WAD, so merge into a
+    // copy of it.
+
+    matrix = Z_Malloc(len, PU_LEVEL, NULL);
+    hiddenpairs = 0;
+
+    for (i = 0; i < len; ++i)
+    {
+        matrix[i] = rejectmatrix[i] | hidden[i];
+
+        for (bits = hidden[i] & ~rejectmatrix[i]; bits != 0; bits &= bits - 1)
+        {
+            ++hiddenpairs;
+        }
+    }
+
+    rejectmatrix = matrix;
+
+    printf("P_UpgradeReject: %i more sector pairs rejected\n", hiddenpairs);
+
+    Z_Free(hidden);
+}
+
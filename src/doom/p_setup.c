@@ -20,6 +20,7 @@
 
 
 #include <math.h>
+#include <stdlib.h>
 
 #include "z_zone.h"
 
@@ -32,6 +33,7 @@
 #include "g_game.h"
 
 #include "i_system.h"
+#include "i_thread.h"
 #include "w_wad.h"
 
 #include "doomdef.h"
@@ -1202,9 +1204,101 @@ int P_GetNumForMap (int episode, int map, boolean critical)
     return lumpnum;
 }
 
+//
+// P_PrefetchLevel
+// Called as a level is completed, with the one that comes next, so
+// that its lumps can be read ahead during the intermission.
+//
+void P_PrefetchLevel (int episode, int map)
+{
+    lumpindex_t	lumps[ML_BLOCKMAP + 1];
+    int		lumpnum;
+    int		i, n;
+
+    lumpnum = P_GetNumForMap (episode, map, false);
+
+    if (lumpnum < 0)
+	return;
+
+    n = 0;
+
+    // [crispy] BEHAVIOR follows BLOCKMAP in Hexen format maps
+    for (i = ML_THINGS; i <= ML_BLOCKMAP + 1 && lumpnum + i < numlumps; i++)
+	lumps[n++] = lumpnum + i;
+
+    W_PrefetchLumps (lumps, n);
+}
+
 // pointer to the current map lump info struct
 lumpinfo_t *maplumpinfo;
 
+//
+// Level loading is split into jobs that may run on the worker threads.
+// The zone and the WAD cache are not thread safe, so all of the loaders
+// that use them stay in the first job, in their usual order; the other
+// jobs only work on memory handed to them.
+//
+enum
+{
+    LOADJOB_GEOMETRY,           // vertexes, sectors, sides, lines, blockmap
+    LOADJOB_INFLATE,            // ZDBSP node decompression
+    NUMLOADJOBS
+};
+
+typedef struct
+{
+    int         lumpnum;
+    mapformat_t mapformat;
+    boolean     validblockmap;
+    byte        *nodes;         // compressed NODES lump, or NULL
+    int         nodeslen;
+    byte        *inflated;      // and the result of inflating it
+    const char  *inflateerror;  // or why that failed
+} loadstage_t;
+
+static void P_LoadLevelJob (void *data, int job)
+{
+    loadstage_t *stage = data;
+    const int lumpnum = stage->lumpnum;
+
+    switch (job)
+    {
+      case LOADJOB_GEOMETRY:
+	// note: most of this ordering is important	
+	stage->validblockmap = P_LoadBlockMap (lumpnum+ML_BLOCKMAP); // [crispy] (re-)create BLOCKMAP if necessary
+	P_LoadVertexes (lumpnum+ML_VERTEXES);
+	P_LoadSectors (lumpnum+ML_SECTORS);
+	P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
+
+	if (stage->mapformat & MFMT_HEXEN)
+	    P_LoadLineDefs_Hexen (lumpnum+ML_LINEDEFS);
+	else
+	P_LoadLineDefs (lumpnum+ML_LINEDEFS);
+
+	// translucent 2s textures
+	P_LoadLineDefs2(lumpnum+ML_LINEDEFS);
+	// special sidedefs
+	P_LoadSideDefs2(lumpnum+ML_SIDEDEFS);
+
+	// [crispy] (re-)create BLOCKMAP if necessary
+	if (!stage->validblockmap)
+	{
+	    extern void P_CreateBlockMap (void);
+	    P_CreateBlockMap();
+	}
+	P_InitThingGrid ();
+	break;
+
+      case LOADJOB_INFLATE:
+#ifdef HAVE_LIBZ
+	if (stage->nodes != NULL)
+	    stage->inflated = P_InflateNodes_ZDBSP (stage->nodes, stage->nodeslen,
+	                                            &stage->inflateerror);
+#endif
+	break;
+    }
+}
+
 //
 // P_SetupLevel
 //
@@ -1218,7 +1312,8 @@ P_SetupLevel
     int		i;
     char	lumpname[9];
     int		lumpnum;
-    boolean	crispy_validblockmap;
+    boolean	levelcached;
+    loadstage_t	stage;
     mapformat_t	crispy_mapformat;
 	
     totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
@@ -1276,52 +1371,74 @@ P_SetupLevel
     // [crispy] check and log map and nodes format
     crispy_mapformat = P_CheckMapFormat(lumpnum);
 
-    // note: most of this ordering is important	
-    crispy_validblockmap = P_LoadBlockMap (lumpnum+ML_BLOCKMAP); // [crispy] (re-)create BLOCKMAP if necessary
-    P_LoadVertexes (lumpnum+ML_VERTEXES);
-    P_LoadSectors (lumpnum+ML_SECTORS);
-    P_LoadSideDefs (lumpnum+ML_SIDEDEFS);
-
-    if (crispy_mapformat & MFMT_HEXEN)
-	P_LoadLineDefs_Hexen (lumpnum+ML_LINEDEFS);
-    else
-    P_LoadLineDefs (lumpnum+ML_LINEDEFS);
+    stage.lumpnum = lumpnum;
+    stage.mapformat = crispy_mapformat;
+    stage.nodes = NULL;
+    stage.nodeslen = 0;
+    stage.inflated = NULL;
+    stage.inflateerror = NULL;
 
-    // translucent 2s textures
-    P_LoadLineDefs2(lumpnum+ML_LINEDEFS);
-    // special sidedefs
-    P_LoadSideDefs2(lumpnum+ML_SIDEDEFS);
+    levelcached = P_FindLevelCache (lumpnum, crispy_mapformat);
 
-    // [crispy] (re-)create BLOCKMAP if necessary
-    if (!crispy_validblockmap)
+    // Compressed nodes are read up front, so that they can be inflated
+    // while the sides look up their textures, unless the geometry is
+    // in the level cache.
+#ifdef HAVE_LIBZ
+    if ((crispy_mapformat & MFMT_ZDBSPZ) && !levelcached)
     {
-	extern void P_CreateBlockMap (void);
-	P_CreateBlockMap();
+	stage.nodes = W_CacheLumpNum (lumpnum+ML_NODES, PU_STATIC);
+	stage.nodeslen = W_LumpLength (lumpnum+ML_NODES);
     }
-    if (crispy_mapformat & (MFMT_ZDBSPX | MFMT_ZDBSPZ))
-	P_LoadNodes_ZDBSP (lumpnum+ML_NODES, crispy_mapformat & MFMT_ZDBSPZ);
-    else
-    if (crispy_mapformat & MFMT_DEEPBSP)
+#endif
+
+    I_RunParallel (P_LoadLevelJob, &stage, NUMLOADJOBS);
+
+    if (stage.nodes != NULL)
+	W_ReleaseLumpNum (lumpnum+ML_NODES);
+
+    // The inflate job may have run on another thread, which must not
+    // call I_Error.
+    if (stage.inflateerror != NULL)
+	I_Error ("%s", stage.inflateerror);
+
+    levelcached = P_LoadLevelCache ();
+    if (!levelcached)
     {
-	P_LoadSubsectors_DeePBSP (lumpnum+ML_SSECTORS);
-	P_LoadNodes_DeePBSP (lumpnum+ML_NODES);
-	P_LoadSegs_DeePBSP (lumpnum+ML_SEGS);
+	if (crispy_mapformat & (MFMT_ZDBSPX | MFMT_ZDBSPZ))
+	    P_LoadNodes_ZDBSP (lumpnum+ML_NODES, crispy_mapformat & MFMT_ZDBSPZ,
+	                       stage.inflated);
+	else
+	if (crispy_mapformat & MFMT_DEEPBSP)
+	{
+	    P_LoadSubsectors_DeePBSP (lumpnum+ML_SSECTORS);
+	    P_LoadNodes_DeePBSP (lumpnum+ML_NODES);
+	    P_LoadSegs_DeePBSP (lumpnum+ML_SEGS);
+	}
+	else
+	{
+	    P_LoadSubsectors (lumpnum+ML_SSECTORS);
+	    P_LoadNodes (lumpnum+ML_NODES);
+	    P_LoadSegs (lumpnum+ML_SEGS);
+	}
     }
     else
-    {
-    P_LoadSubsectors (lumpnum+ML_SSECTORS);
-    P_LoadNodes (lumpnum+ML_NODES);
-    P_LoadSegs (lumpnum+ML_SEGS);
-    }
+	free(stage.inflated);
 
     P_GroupLines ();
     P_LoadReject (lumpnum+ML_REJECT);
+    P_UpgradeReject ();
 
-    // [crispy] remove slime trails
-    P_RemoveSlimeTrails();
-    // R_CalcSegsLength();
-    // [crispy] fix long wall wobble
-    P_SegLengths(false);
+    // cached geometry has had this done already
+    if (!levelcached)
+    {
+	// [crispy] remove slime trails
+	P_RemoveSlimeTrails();
+	// R_CalcSegsLength();
+	// [crispy] fix long wall wobble
+	P_SegLengths(false);
+
+	P_SaveLevelCache ();
+    }
 
     bodyqueslot = 0;
     deathmatch_p = deathmatchstarts;
@@ -202,7 +202,7 @@ void P_InitPicAnims (void)
 	
     if (from_lump)
     {
-	Z_ChangeTag(animdefs, PU_CACHE);
+	W_ReleaseLumpName("ANIMATED");
     }
 }
 
@@ -2007,8 +2007,8 @@ int EV_DoDonut(line_t*	line)
             }
 
 	    //	Spawn rising slime
-	    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-	    P_AddThinker (&floor->thinker);
+	    floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
+	    P_AddThinker (&floor->thinker, th_misc);
 	    s2->floordata = floor;
 	    floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
 	    floor->type = donutRaise;
@@ -2021,8 +2021,8 @@ int EV_DoDonut(line_t*	line)
 	    floor->floordestheight = s3_floorheight;
 	    
 	    //	Spawn lowering donut-hole
-	    floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
-	    P_AddThinker (&floor->thinker);
+	    floor = P_AllocateThinker (sizeof(*floor), PU_LEVSPEC);
+	    P_AddThinker (&floor->thinker, th_misc);
 	    s1->floordata = floor;
 	    floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
 	    floor->type = lowerFloor;
@@ -48,13 +48,14 @@ static mobj_t* P_TeleportDestination(line_t* line)
   int i;
   for (i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;) {
     register thinker_t* th = NULL;
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-      if (th->function.acp1 == (actionf_p1) P_MobjThinker) {
+    for (th = thinkerclasscap[th_mobj].cnext ;
+         th != &thinkerclasscap[th_mobj] ;
+         th = th->cnext) {
         register mobj_t* m = (mobj_t*)th;
         if (m->type == MT_TELEPORTMAN  &&
             ((sectors - m->subsector->sector) == i))
             return m;
-      }
+    }
   }
   return NULL;
 }
@@ -94,15 +95,10 @@ EV_Teleport
     {
 	if (sectors[ i ].tag == tag )
 	{
-	    thinker = thinkercap.next;
-	    for (thinker = thinkercap.next;
-		 thinker != &thinkercap;
-		 thinker = thinker->next)
+	    for (thinker = thinkerclasscap[th_mobj].cnext;
+		 thinker != &thinkerclasscap[th_mobj];
+		 thinker = thinker->cnext)
 	    {
-		// not a mobj
-		if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
-		    continue;	
-
 		m = (mobj_t *)thinker;
 		
 		// not a teleportman
@@ -18,8 +18,11 @@
 //
 
 
+#include "i_system.h"
+#include "m_misc.h"
 #include "z_zone.h"
 #include "p_local.h"
+#include "p_tick.h"
 
 #include "doomstat.h"
 
@@ -39,13 +42,43 @@ int	leveltime;
 // Both the head and tail of the thinker list.
 thinker_t	thinkercap;
 
+// Heads and tails of the per-class lists.
+thinker_t	thinkerclasscap[NUMTHCLASS];
+
+// Removed thinkers are not given back to the zone, but kept in
+// a pool for their size and tag, so that their memory only ever
+// holds a thinker of the same type: a stale target or tracer
+// still points at a mobj. Thinkers freed during a tic sit in
+// 'limbo' until the tic is over before they can be reused.
+#define MAXTHINKERPOOLS 32
+
+typedef struct
+{
+    size_t	size;
+    int		tag;
+    thinker_t*	limbo;		// linked through cnext
+    thinker_t*	free;
+} thinkerpool_t;
+
+static thinkerpool_t	thinkerpools[MAXTHINKERPOOLS];
+static int		numthinkerpools;
+
 
 //
 // P_InitThinkers
 //
 void P_InitThinkers (void)
 {
+    int i;
+
     thinkercap.prev = thinkercap.next  = &thinkercap;
+
+    for (i = 0; i < NUMTHCLASS; i++)
+	thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
+
+    // Whatever was pooled went with the level.
+    for (i = 0; i < numthinkerpools; i++)
+	thinkerpools[i].limbo = thinkerpools[i].free = NULL;
 }
 
 
@@ -53,14 +86,24 @@ void P_InitThinkers (void)
 
 //
 // P_AddThinker
-// Adds a new thinker at the end of the list.
+// Adds a new thinker at the end of the list, and of the list
+// for its class. Most specials only set their function after.
 //
-void P_AddThinker (thinker_t* thinker)
+void P_AddThinker (thinker_t* thinker, th_class thclass)
 {
+    thinker_t*	cap;
+
     thinkercap.prev->next = thinker;
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    cap = &thinkerclasscap[thclass];
+
+    cap->cprev->cnext = thinker;
+    thinker->cnext = cap;
+    thinker->cprev = cap->cprev;
+    cap->cprev = thinker;
 }
 
 
@@ -72,6 +115,14 @@ void P_AddThinker (thinker_t* thinker)
 //
 void P_RemoveThinker (thinker_t* thinker)
 {
+  if (thinker->function.acv == (actionf_v)(-1))
+    return;
+
+  // Unlink from the class list now. cnext is left alone,
+  // so a scan that is standing on this thinker can go on.
+  thinker->cnext->cprev = thinker->cprev;
+  thinker->cprev->cnext = thinker->cnext;
+
   // FIXME: NOP.
   thinker->function.acv = (actionf_v)(-1);
 }
@@ -80,14 +131,164 @@ void P_RemoveThinker (thinker_t* thinker)
 
 //
 // P_AllocateThinker
-// Allocates memory and adds a new thinker at the end of the list.
+// Allocates memory for a thinker, from its pool if possible.
+// Every thinker must be allocated here.
+//
+void* P_AllocateThinker (size_t size, int tag)
+{
+    thinkerpool_t*	pool;
+    thinker_t*		thinker;
+    int			i;
+
+    for (i = 0; i < numthinkerpools; i++)
+    {
+	if (thinkerpools[i].size == size && thinkerpools[i].tag == tag)
+	    break;
+    }
+
+    if (i == numthinkerpools)
+    {
+	if (numthinkerpools == MAXTHINKERPOOLS)
+	    I_Error ("P_AllocateThinker: too many thinker sizes");
+
+	pool = &thinkerpools[numthinkerpools++];
+	pool->size = size;
+	pool->tag = tag;
+	pool->limbo = pool->free = NULL;
+    }
+
+    pool = &thinkerpools[i];
+
+    if (pool->free != NULL)
+    {
+	thinker = pool->free;
+	pool->free = thinker->cnext;
+    }
+    else
+    {
+	thinker = Z_Malloc (size, tag, NULL);
+    }
+
+    // Whatever was here before is not a function.
+    thinker->function.acv = NULL;
+    thinker->pool = i;
+
+    return thinker;
+}
+
+
+
+//
+// P_FreeThinker
+// Puts a thinker that has left the list in limbo.
+//
+static void P_FreeThinker (thinker_t* thinker)
+{
+    thinkerpool_t*	pool;
+
+    pool = &thinkerpools[thinker->pool];
+    thinker->cnext = pool->limbo;
+    pool->limbo = thinker;
+}
+
+
+
+//
+// P_ReclaimThinkers
+// Called at the end of the tic: limbo thinkers can be reused now.
 //
-void P_AllocateThinker (thinker_t*	thinker)
+void P_ReclaimThinkers (void)
 {
+    thinkerpool_t*	pool;
+    thinker_t*		thinker;
+    int			i;
+
+    for (i = 0; i < numthinkerpools; i++)
+    {
+	pool = &thinkerpools[i];
+
+	while (pool->limbo != NULL)
+	{
+	    thinker = pool->limbo;
+	    pool->limbo = thinker->cnext;
+	    thinker->cnext = pool->free;
+	    pool->free = thinker;
+	}
+    }
 }
 
 
 
+//
+// CHECKSUMS
+// M_HashInt, fed one int at a time. The mobjs are hashed as the
+// thinkers run, so that checking a demo costs no extra pass.
+//
+
+boolean		p_checksums;
+unsigned int	tic_checksums[NUMCHECKSUMS];
+
+const char*	checksum_names[NUMCHECKSUMS] =
+{
+    "random", "thinkers", "mobjs", "sectors",
+};
+
+static unsigned int	mobjs_checksum;
+static int		numthinkers;
+
+//
+// P_ChecksumThinker
+// Called after a thinker has had its turn.
+//
+static void P_ChecksumThinker (thinker_t* thinker)
+{
+    mobj_t*	mo;
+    unsigned int hash;
+
+    // Removed during its own turn.
+    if (thinker->function.acv == (actionf_v)(-1))
+	return;
+
+    numthinkers++;
+
+    if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
+	return;
+
+    mo = (mobj_t *) thinker;
+    hash = mobjs_checksum;
+    hash = M_HashInt (hash, mo->x);
+    hash = M_HashInt (hash, mo->y);
+    hash = M_HashInt (hash, mo->z);
+    hash = M_HashInt (hash, mo->momx);
+    hash = M_HashInt (hash, mo->momy);
+    hash = M_HashInt (hash, mo->momz);
+    hash = M_HashInt (hash, mo->health);
+    mobjs_checksum = hash;
+}
+
+//
+// P_FinishChecksums
+// Called at the end of the tic, once everything has moved.
+//
+static void P_FinishChecksums (void)
+{
+    unsigned int hash;
+    int		i;
+
+    hash = M_HASH32_INIT;
+
+    for (i = 0; i < numsectors; i++)
+    {
+	hash = M_HashInt (hash, sectors[i].floorheight);
+	hash = M_HashInt (hash, sectors[i].ceilingheight);
+    }
+
+    tic_checksums[cs_random] = M_HashInt (M_HASH32_INIT, prndindex);
+    tic_checksums[cs_thinkers] = M_HashInt (M_HASH32_INIT, numthinkers);
+    tic_checksums[cs_mobjs] = mobjs_checksum;
+    tic_checksums[cs_sectors] = hash;
+}
+
 //
 // P_RunThinkers
 //
@@ -104,12 +305,14 @@ void P_RunThinkers (void)
             nextthinker = currentthinker->next;
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
-	    Z_Free(currentthinker);
+	    P_FreeThinker(currentthinker);
 	}
 	else
 	{
 	    if (currentthinker->function.acp1)
 		currentthinker->function.acp1 (currentthinker);
+	    if (p_checksums)
+		P_ChecksumThinker (currentthinker);
             nextthinker = currentthinker->next;
 	}
 	currentthinker = nextthinker;
@@ -139,6 +342,11 @@ void P_Ticker (void)
 	return;
     }
     
+    if (p_checksums)
+    {
+	mobjs_checksum = M_HASH32_INIT;
+	numthinkers = 0;
+    }
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
@@ -150,4 +358,9 @@ void P_Ticker (void)
 
     // for par times
     leveltime++;	
+
+    if (p_checksums)
+	P_FinishChecksums ();
+
+    P_ReclaimThinkers ();
 }
@@ -20,6 +20,8 @@
 #ifndef __P_TICK__
 #define __P_TICK__
 
+#include "doomtype.h"
+
 
 
 
@@ -28,6 +30,22 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// Per-tic checksums of the play state, worked out by P_Ticker while
+// p_checksums is set, to find where a demo goes out of sync.
+
+typedef enum
+{
+    cs_random,		// P_Random index
+    cs_thinkers,	// number of thinkers
+    cs_mobjs,		// mobj positions, momenta and health
+    cs_sectors,		// floor and ceiling heights
+    NUMCHECKSUMS
+} checksum_t;
+
+extern boolean		p_checksums;
+extern unsigned int	tic_checksums[NUMCHECKSUMS];
+extern const char*	checksum_names[NUMCHECKSUMS];
+
 
 
 #endif
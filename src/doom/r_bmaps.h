@@ -31,4 +31,7 @@ extern byte *(*R_BrightmapForState) (const int state);
 
 extern byte **texturebrightmap;
 
+// All zeroes: every texel uses the regular colormap.
+extern byte nobrightmap[256];
+
 #endif
@@ -112,6 +112,9 @@ struct texture_s
     short	width;
     short	height;
 
+    // The name packed by W_LumpNameKey, for lookups
+    uint64_t	namekey;
+
     // Index in textures list
 
     int         index;
@@ -559,7 +562,11 @@ R_GetColumn
     
     // [crispy] single-patched mid-textures on two-sided walls
     if (lump > 0 && !opaque)
-	return (byte *)W_CacheLumpNum(lump,PU_CACHE)+ofs2;
+    {
+	byte *patch = W_CacheLumpNum(lump,PU_CACHE);
+	R_HoldLump(lump);
+	return patch+ofs2;
+    }
 
     if (!texturecomposite[tex])
 	R_GenerateComposite (tex);
@@ -629,8 +636,6 @@ void R_InitTextures (void)
 
     int*		maptex = NULL;
     
-    char		name[9];
-    
     int*		patchlookup;
     
     int			totalwidth;
@@ -739,15 +744,12 @@ void R_InitTextures (void)
     }
 
     // [crispy] fill up the patch lookup table
-    name[8] = 0;
     patchlookup = Z_Malloc(nummappatches * sizeof(*patchlookup), PU_STATIC, NULL);
     for (i = 0, k = 0; i < numpnameslumps; i++)
     {
-	for (j = 0; j < pnameslumps[i].nummappatches; j++)
-	{
-	    M_StringCopy(name, pnameslumps[i].name_p + j * 8, sizeof(name));
-	    patchlookup[k++] = W_CheckNumForName(name);
-	}
+	W_CheckNumsForNames(pnameslumps[i].name_p,
+	                    pnameslumps[i].nummappatches, patchlookup + k);
+	k += pnameslumps[i].nummappatches;
     }
 
     // [crispy] calculate total number of textures
@@ -834,6 +836,7 @@ void R_InitTextures (void)
 	texture->patchcount = SHORT(mtexture->patchcount);
 	
 	memcpy (texture->name, mtexture->name, sizeof(texture->name));
+	texture->namekey = W_LumpNameKey(texture->name);
 	mpatch = &mtexture->patches[0];
 	patch = &texture->patches[0];
 
@@ -1048,7 +1051,7 @@ void R_InitTranMap()
 
 	free(fname);
 
-	Z_ChangeTag(playpal, PU_CACHE);
+	W_ReleaseLumpName("PLAYPAL");
     }
 }
 
@@ -1104,7 +1107,7 @@ void R_InitColormaps (void)
 	    crstr[i] = M_StringDuplicate(c);
 	}
 
-	Z_ChangeTag(playpal, PU_CACHE);
+	W_ReleaseLumpName("PLAYPAL");
     }
 
 	extern byte *tinttable;
@@ -1178,19 +1181,21 @@ int R_FlatNumForName(const char *name)
 int R_CheckTextureNumForName(const char *name)
 {
     texture_t *texture;
+    uint64_t namekey;
     int key;
 
     // "NoTexture" marker.
     if (name[0] == '-')		
 	return 0;
 		
+    namekey = W_LumpNameKey(name);
     key = W_LumpNameHash(name) % numtextures;
 
     texture=textures_hashtable[key]; 
     
     while (texture != NULL)
     {
-	if (!strncasecmp (texture->name, name, 8) )
+	if (texture->namekey == namekey)
 	    return texture->index;
 
         texture = texture->next;
@@ -1237,6 +1242,25 @@ int		flatmemory;
 int		texturememory;
 int		spritememory;
 
+// Lumps to be cached, gathered first so that they can be prefetched
+// from streamed WADs in one go.
+
+static lumpindex_t	*precachelumps;
+static int		numprecachelumps;
+static int		maxprecachelumps;
+
+static void R_AddPrecacheLump (int lump)
+{
+    if (numprecachelumps == maxprecachelumps)
+    {
+	maxprecachelumps = maxprecachelumps ? 2 * maxprecachelumps : 1024;
+	precachelumps = I_Realloc(precachelumps,
+	                          maxprecachelumps * sizeof(*precachelumps));
+    }
+
+    precachelumps[numprecachelumps++] = lump;
+}
+
 void R_PrecacheLevel (void)
 {
     char*		flatpresent;
@@ -1255,6 +1279,8 @@ void R_PrecacheLevel (void)
     if (demoplayback)
 	return;
     
+    numprecachelumps = 0;
+
     // Precache flats.
     flatpresent = Z_Malloc(numflats, PU_STATIC, NULL);
     memset (flatpresent,0,numflats);	
@@ -1273,7 +1299,7 @@ void R_PrecacheLevel (void)
 	{
 	    lump = firstflat + i;
 	    flatmemory += lumpinfo[lump]->size;
-	    W_CacheLumpNum(lump, PU_CACHE);
+	    R_AddPrecacheLump(lump);
 	}
     }
 
@@ -1304,29 +1330,25 @@ void R_PrecacheLevel (void)
 	if (!texturepresent[i])
 	    continue;
 
-	// [crispy] precache composite textures
-	R_GenerateComposite(i);
-
 	texture = textures[i];
 	
 	for (j=0 ; j<texture->patchcount ; j++)
 	{
 	    lump = texture->patches[j].patch;
 	    texturememory += lumpinfo[lump]->size;
-	    W_CacheLumpNum(lump , PU_CACHE);
+	    R_AddPrecacheLump(lump);
 	}
     }
 
-    Z_Free(texturepresent);
-    
     // Precache sprites.
     spritepresent = Z_Malloc(numsprites, PU_STATIC, NULL);
     memset (spritepresent,0, numsprites);
 	
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ;
+	 th != &thinkerclasscap[th_mobj] ;
+	 th = th->cnext)
     {
-	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-	    spritepresent[((mobj_t *)th)->sprite] = 1;
+	spritepresent[((mobj_t *)th)->sprite] = 1;
     }
 	
     spritememory = 0;
@@ -1342,12 +1364,28 @@ void R_PrecacheLevel (void)
 	    {
 		lump = firstspritelump + sf->lump[k];
 		spritememory += lumpinfo[lump]->size;
-		W_CacheLumpNum(lump , PU_CACHE);
+		R_AddPrecacheLump(lump);
 	    }
 	}
     }
 
     Z_Free(spritepresent);
+
+    W_PrefetchLumps(precachelumps, numprecachelumps);
+
+    for (i=0 ; i<numprecachelumps ; i++)
+    {
+	W_CacheLumpNum(precachelumps[i], PU_CACHE);
+    }
+
+    // [crispy] precache composite textures
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (texturepresent[i])
+	    R_GenerateComposite(i);
+    }
+
+    Z_Free(texturepresent);
 }
 
 
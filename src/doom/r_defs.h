@@ -508,6 +508,9 @@ typedef struct
   int			lightlevel;
   int			minx;
   int			maxx;
+
+  // next visplane in the R_FindPlane hash chain, -1 terminates
+  int			next;
   
   // leave pads for [minx-1]/[maxx+1]
   
@@ -523,6 +526,24 @@ typedef struct
 
 } visplane_t;
 
+
+//
+// One horizontal run of a visplane, as handed to spanfunc.
+//
+typedef struct
+{
+  int			y;
+  int			x1;
+  int			x2;
+
+  fixed_t		xfrac;
+  fixed_t		yfrac;
+  fixed_t		xstep;
+  fixed_t		ystep;
+
+  lighttable_t*		colormap[2];
+} spandef_t;
+
 typedef struct
 {
 	char c;
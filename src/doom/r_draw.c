@@ -21,14 +21,27 @@
 
 
 
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
 #include "doomdef.h"
 #include "deh_main.h"
 
 #include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
 #include "r_local.h"
+#include "r_bmaps.h"
 
 // Needs access to LFB (guess what).
 #include "v_video.h"
@@ -79,16 +92,16 @@ static pixel_t *background_buffer = NULL;
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap[2]; // [crispy] brightmaps
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
-int			dc_texheight; // [crispy] Tutti-Frutti fix
+THREADLOCAL lighttable_t*		dc_colormap[2]; // [crispy] brightmaps
+THREADLOCAL int			dc_x; 
+THREADLOCAL int			dc_yl; 
+THREADLOCAL int			dc_yh; 
+THREADLOCAL fixed_t			dc_iscale; 
+THREADLOCAL fixed_t			dc_texturemid;
+THREADLOCAL int			dc_texheight; // [crispy] Tutti-Frutti fix
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+THREADLOCAL byte*			dc_source;		
 
 // just for profiling 
 int			dccount;
@@ -102,160 +115,102 @@ int			dccount;
 // 
 // [crispy] replace R_DrawColumn() with Lee Killough's implementation
 // found in MBF to fix Tutti-Frutti, taken from mbfsrc/R_DRAW.C:99-1979
+//
+// The drawers are generated from the kernel in r_drawcol.h, one
+//  for each combination of detail level, texture height and
+//  brightmap use; R_DrawColumn picks one per column.
+//
 
-void R_DrawColumn (void) 
-{ 
-    int			count; 
-    pixel_t*		dest;
-    fixed_t		frac;
-    fixed_t		fracstep;	 
-    int			heightmask = dc_texheight - 1;
- 
-    count = dc_yh - dc_yl; 
-
-    // Zero length, column does not exceed a pixel.
-    if (count < 0) 
-	return; 
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT) 
-	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x); 
-#endif 
-
-    // Framebuffer destination address.
-    // Use ylookup LUT to avoid multiply with ScreenWidth.
-    // Use columnofs LUT for subwindows? 
-    dest = ylookup[dc_yl] + columnofs[dc_x];  
-
-    // Determine scaling,
-    //  which is the only mapping to be done.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
-
-    // Inner loop that does the actual texture mapping,
-    //  e.g. a DDA-lile scaling.
-    // This is as fast as it gets.
-
-  // heightmask is the Tutti-Frutti fix -- killough
-  if (dc_texheight & heightmask) // not a power of 2 -- killough
-  {
-    heightmask++;
-    heightmask <<= FRACBITS;
-
-    if (frac < 0)
-	while ((frac += heightmask) < 0);
-    else
-	while (frac >= heightmask)
-	    frac -= heightmask;
-
-    do
+// [crispy] brightmaps
+#define BRIGHTPIXEL(s, d)	dc_colormap[dc_brightmap[s]][s]
+#define PLAINPIXEL(s, d)	dc_colormap[0][s]
+
+#define DRAWCOL_NAME	R_DrawColumnPow2Bright
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	0
+#define DRAWCOL_WRAP	COLWRAP_POW2
+#define DRAWCOL_PIXEL(s, d)	fullcolormap[BRIGHTPIXEL(s, d)]
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnAnyBright
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	0
+#define DRAWCOL_WRAP	COLWRAP_ANY
+#define DRAWCOL_PIXEL(s, d)	fullcolormap[BRIGHTPIXEL(s, d)]
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnPow2
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	0
+#define DRAWCOL_WRAP	COLWRAP_POW2
+#define DRAWCOL_PIXEL(s, d)	fullcolormap[PLAINPIXEL(s, d)]
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnAny
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	0
+#define DRAWCOL_WRAP	COLWRAP_ANY
+#define DRAWCOL_PIXEL(s, d)	fullcolormap[PLAINPIXEL(s, d)]
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnLowPow2Bright
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	1
+#define DRAWCOL_WRAP	COLWRAP_POW2
+#define DRAWCOL_PIXEL(s, d)	BRIGHTPIXEL(s, d)
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnLowAnyBright
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	1
+#define DRAWCOL_WRAP	COLWRAP_ANY
+#define DRAWCOL_PIXEL(s, d)	BRIGHTPIXEL(s, d)
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnLowPow2
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	1
+#define DRAWCOL_WRAP	COLWRAP_POW2
+#define DRAWCOL_PIXEL(s, d)	PLAINPIXEL(s, d)
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawColumnLowAny
+#define DRAWCOL_STATIC
+#define DRAWCOL_LOW	1
+#define DRAWCOL_WRAP	COLWRAP_ANY
+#define DRAWCOL_PIXEL(s, d)	PLAINPIXEL(s, d)
+#include "r_drawcol.h"
+
+// Indexed by [low detail][non-power-of-two height][brightmap].
+static void (*const columndrawers[2][2][2]) (void) =
+{
     {
-	// [crispy] brightmaps
-	const byte source = dc_source[frac>>FRACBITS];
-	*dest = fullcolormap[dc_colormap[dc_brightmap[source]][source]];
-
-	dest += SCREENWIDTH;
-	if ((frac += fracstep) >= heightmask)
-	    frac -= heightmask;
-    } while (count--);
-  }
-  else // texture height is a power of 2 -- killough
-  {
-    do 
+	{ R_DrawColumnPow2, R_DrawColumnPow2Bright },
+	{ R_DrawColumnAny, R_DrawColumnAnyBright },
+    },
     {
-	// Re-map color indices from wall texture column
-	//  using a lighting/special effects LUT.
-	// [crispy] brightmaps
-	const byte source = dc_source[(frac>>FRACBITS)&heightmask];
-	*dest = fullcolormap[dc_colormap[dc_brightmap[source]][source]];
-	
-	dest += SCREENWIDTH; 
-	frac += fracstep;
-	
-    } while (count--); 
-  }
+	{ R_DrawColumnLowPow2, R_DrawColumnLowPow2Bright },
+	{ R_DrawColumnLowAny, R_DrawColumnLowAnyBright },
+    },
+};
+
+// The brightmap can be skipped when it is empty, or when both
+//  colormaps are the same anyway.
+#define R_ColumnDrawer(low) \
+    columndrawers[low] \
+                 [(dc_texheight & (dc_texheight - 1)) != 0] \
+                 [dc_brightmap != nobrightmap && dc_colormap[0] != dc_colormap[1]]
+
+void R_DrawColumn (void) 
+{ 
+    R_ColumnDrawer(0) ();
 } 
 
 void R_DrawColumnLow (void) 
 { 
-    int			count; 
-    pixel_t*		dest; 
-    pixel_t*		dest2;
-    fixed_t		frac;
-    fixed_t		fracstep;	 
-    int                 x;
-    int			heightmask = dc_texheight - 1;
- 
-    count = dc_yh - dc_yl; 
-
-    // Zero length.
-    if (count < 0) 
-	return; 
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	
-	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
-    }
-    //	dccount++; 
-#endif 
-    // Blocky mode, need to multiply by 2.
-    x = dc_x << 1;
-    
-    dest = ylookup[dc_yl] + columnofs[x];
-    dest2 = ylookup[dc_yl] + columnofs[x+1];
-    
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
-    
-  // heightmask is the Tutti-Frutti fix -- killough
-  if (dc_texheight & heightmask) // not a power of 2 -- killough
-  {
-    heightmask++;
-    heightmask <<= FRACBITS;
-
-    if (frac < 0)
-	while ((frac += heightmask) < 0);
-    else
-	while (frac >= heightmask)
-	    frac -= heightmask;
-
-    do
-    {
-	// [crispy] brightmaps
-	const byte source = dc_source[frac>>FRACBITS];
-	*dest2 = *dest = dc_colormap[dc_brightmap[source]][source];
-
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-
-	if ((frac += fracstep) >= heightmask)
-	    frac -= heightmask;
-    } while (count--);
-  }
-  else // texture height is a power of 2 -- killough
-  {
-    do 
-    {
-	// Hack. Does not work corretly.
-	// [crispy] brightmaps
-	const byte source = dc_source[(frac>>FRACBITS)&heightmask];
-	*dest2 = *dest = dc_colormap[dc_brightmap[source]][source];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-
-	frac += fracstep; 
-
-    } while (count--);
-  }
+    R_ColumnDrawer(1) ();
 }
 
-
 //
 // Spectre/Invisibility.
 //
@@ -274,7 +229,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+THREADLOCAL int	fuzzpos = 0; 
 
 // [crispy] draw fuzz effect independent of rendering frame rate
 static int fuzzpos_tic;
@@ -287,6 +242,25 @@ void R_SetFuzzPosDraw (void)
 	fuzzpos = fuzzpos_tic;
 }
 
+// Advance fuzzpos as R_DrawFuzzColumn(Low) would for the current
+// column, without drawing anything.
+static void R_SkipFuzzColumn (void)
+{
+    int		yl = dc_yl;
+    int		yh = dc_yh;
+
+    if (!yl)
+	yl = 1;
+
+    if (yh == viewheight-1)
+	yh = viewheight - 2;
+
+    if (yh < yl)
+	return;
+
+    fuzzpos = (fuzzpos + yh - yl + 1) % FUZZTABLE;
+}
+
 //
 // Framebuffer postprocessing.
 // Creates a fuzzy image by copying pixels
@@ -456,186 +430,42 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+THREADLOCAL byte*	dc_translation;
 byte*	translationtables;
 
-void R_DrawTranslatedColumn (void) 
-{ 
-    int			count; 
-    pixel_t*		dest;
-    fixed_t		frac;
-    fixed_t		fracstep;	 
- 
-    count = dc_yh - dc_yl; 
-    if (count < 0) 
-	return; 
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, dc_x);
-    }
-    
-#endif 
-
-
-    dest = ylookup[dc_yl] + columnofs[dc_x]; 
-
-    // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
-
-    // Here we do an additional index re-mapping.
-    do 
-    {
-	// Translation tables are used
-	//  to map certain colorramps to other ones,
-	//  used with PLAY sprites.
-	// Thus the "green" ramp of the player 0 sprite
-	//  is mapped to gray, red, black/indigo. 
-	*dest = fullcolormap[dc_colormap[0][dc_translation[dc_source[frac>>FRACBITS]]]];
-	dest += SCREENWIDTH;
-	
-	frac += fracstep; 
-    } while (count--); 
-} 
-
-void R_DrawTranslatedColumnLow (void) 
-{ 
-    int			count; 
-    pixel_t*		dest; 
-    pixel_t*		dest2; 
-    fixed_t		frac;
-    fixed_t		fracstep;	 
-    int                 x;
- 
-    count = dc_yh - dc_yl; 
-    if (count < 0) 
-	return; 
-
-    // low detail, need to scale by 2
-    x = dc_x << 1;
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, x);
-    }
-    
-#endif 
-
-
-    dest = ylookup[dc_yl] + columnofs[x];
-    dest2 = ylookup[dc_yl] + columnofs[x+1];
-
-    // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
-
-    // Here we do an additional index re-mapping.
-    do 
-    {
-	// Translation tables are used
-	//  to map certain colorramps to other ones,
-	//  used with PLAY sprites.
-	// Thus the "green" ramp of the player 0 sprite
-	//  is mapped to gray, red, black/indigo. 
-	*dest = dc_colormap[0][dc_translation[dc_source[frac>>FRACBITS]]];
-	*dest2 = dc_colormap[0][dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-	
-	frac += fracstep; 
-    } while (count--); 
-} 
+#define DRAWCOL_NAME	R_DrawTranslatedColumn
+#define DRAWCOL_LOW	0
+#define DRAWCOL_WRAP	COLWRAP_NONE
+// Translation tables are used
+//  to map certain colorramps to other ones,
+//  used with PLAY sprites.
+// Thus the "green" ramp of the player 0 sprite
+//  is mapped to gray, red, black/indigo. 
+#define DRAWCOL_PIXEL(s, d)	fullcolormap[dc_colormap[0][dc_translation[s]]]
+#include "r_drawcol.h"
+
+#define DRAWCOL_NAME	R_DrawTranslatedColumnLow
+#define DRAWCOL_LOW	1
+#define DRAWCOL_WRAP	COLWRAP_NONE
+#define DRAWCOL_PIXEL(s, d)	dc_colormap[0][dc_translation[s]]
+#include "r_drawcol.h"
 
 // [crispy] draw translucent column
 extern byte *tranmap;
 
-void R_DrawTLColumn (void)
-{
-    int			count;
-    byte*		dest;
-    fixed_t		frac;
-    fixed_t		fracstep;
-
-    count = dc_yh - dc_yl;
-    if (count < 0)
-	return;
-
-#ifdef RANGECHECK
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, dc_x);
-    }
-#endif
-
-    dest = ylookup[dc_yl] + columnofs[dc_x];
-
-    fracstep = dc_iscale;
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
-
-    do
-    {
-        // actual translucency map lookup taken from boom202s/R_DRAW.C:255
-        *dest = tranmap[(*dest<<8)+dc_colormap[0][dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-
-	frac += fracstep;
-    } while (count--);
-}
+// actual translucency map lookup taken from boom202s/R_DRAW.C:255
+#define DRAWCOL_NAME	R_DrawTLColumn
+#define DRAWCOL_LOW	0
+#define DRAWCOL_WRAP	COLWRAP_NONE
+#define DRAWCOL_PIXEL(s, d)	tranmap[((d)<<8)+dc_colormap[0][s]]
+#include "r_drawcol.h"
 
 // [crispy] draw translucent column, low-resolution version
-void R_DrawTLColumnLow (void)
-{
-    int			count;
-    byte*		dest;
-    byte*		dest2;
-    fixed_t		frac;
-    fixed_t		fracstep;
-    int                 x;
-
-    count = dc_yh - dc_yl;
-    if (count < 0)
-	return;
-
-    x = dc_x << 1;
-
-#ifdef RANGECHECK
-    if ((unsigned)x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, x);
-    }
-#endif
-
-    dest = ylookup[dc_yl] + columnofs[x];
-    dest2 = ylookup[dc_yl] + columnofs[x+1];
-
-    fracstep = dc_iscale;
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
-
-    do
-    {
-	*dest = tranmap[(*dest<<8)+dc_colormap[0][dc_source[frac>>FRACBITS]]];
-	*dest2 = tranmap[(*dest2<<8)+dc_colormap[0][dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-
-	frac += fracstep;
-    } while (count--);
-}
+#define DRAWCOL_NAME	R_DrawTLColumnLow
+#define DRAWCOL_LOW	1
+#define DRAWCOL_WRAP	COLWRAP_NONE
+#define DRAWCOL_PIXEL(s, d)	tranmap[((d)<<8)+dc_colormap[0][s]]
+#include "r_drawcol.h"
 
 //
 // R_InitTranslationTables
@@ -684,121 +514,531 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
-
-lighttable_t*		ds_colormap[2];
-byte*			ds_brightmap;
-
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+THREADLOCAL byte*			ds_brightmap;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+THREADLOCAL byte*			ds_source;	
 
 // just for profiling
 int			dscount;
 
 
 //
-// Draws the actual span.
-void R_DrawSpan (void) 
-{ 
-//  unsigned int position, step;
-    pixel_t *dest;
-    int count;
-    int spot;
-    unsigned int xtemp, ytemp;
+// R_SpanSpots
+// Works out the flat texel offsets of the next count pixels of
+//  a span, advancing xfrac and yfrac past them.
+// Only bits 16-21 of each coordinate are used, so the fractions
+//  may wrap around freely; the vector versions step 4 pixels at
+//  a time and give the same offsets as the scalar loop.
+//
+#define SPANCHUNK	32
+
+static inline void
+R_SpanSpots
+( int*		spots,
+  int		count,
+  unsigned int*	xfrac,
+  unsigned int*	yfrac,
+  unsigned int	xstep,
+  unsigned int	ystep )
+{
+    unsigned int	xf = *xfrac;
+    unsigned int	yf = *yfrac;
+    int			i = 0;
 
-#ifdef RANGECHECK
-    if (ds_x2 < ds_x1
-	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH
-	|| (unsigned)ds_y>SCREENHEIGHT)
+#if defined(__SSE2__)
+    if (count >= 4)
+    {
+	const __m128i xmask = _mm_set1_epi32(0x3f);
+	const __m128i ymask = _mm_set1_epi32(0x0fc0);
+	const __m128i xstep4 = _mm_set1_epi32(xstep * 4);
+	const __m128i ystep4 = _mm_set1_epi32(ystep * 4);
+	__m128i x = _mm_setr_epi32(xf, xf + xstep, xf + 2*xstep, xf + 3*xstep);
+	__m128i y = _mm_setr_epi32(yf, yf + ystep, yf + 2*ystep, yf + 3*ystep);
+
+	for ( ; i + 4 <= count; i += 4)
+	{
+	    __m128i spot = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(y, 10), ymask),
+	                                _mm_and_si128(_mm_srli_epi32(x, 16), xmask));
+	    _mm_storeu_si128((__m128i *) &spots[i], spot);
+	    x = _mm_add_epi32(x, xstep4);
+	    y = _mm_add_epi32(y, ystep4);
+	}
+
+	xf += i * xstep;
+	yf += i * ystep;
+    }
+#elif defined(__ARM_NEON)
+    if (count >= 4)
     {
-	I_Error( "R_DrawSpan: %i to %i at %i",
-		 ds_x1,ds_x2,ds_y);
+	const uint32_t xinit[4] = { xf, xf + xstep, xf + 2*xstep, xf + 3*xstep };
+	const uint32_t yinit[4] = { yf, yf + ystep, yf + 2*ystep, yf + 3*ystep };
+	const uint32x4_t xmask = vdupq_n_u32(0x3f);
+	const uint32x4_t ymask = vdupq_n_u32(0x0fc0);
+	const uint32x4_t xstep4 = vdupq_n_u32(xstep * 4);
+	const uint32x4_t ystep4 = vdupq_n_u32(ystep * 4);
+	uint32x4_t x = vld1q_u32(xinit);
+	uint32x4_t y = vld1q_u32(yinit);
+
+	for ( ; i + 4 <= count; i += 4)
+	{
+	    uint32x4_t spot = vorrq_u32(vandq_u32(vshrq_n_u32(y, 10), ymask),
+	                                vandq_u32(vshrq_n_u32(x, 16), xmask));
+	    vst1q_s32(&spots[i], vreinterpretq_s32_u32(spot));
+	    x = vaddq_u32(x, xstep4);
+	    y = vaddq_u32(y, ystep4);
+	}
+
+	xf += i * xstep;
+	yf += i * ystep;
+    }
+#elif defined(__wasm_simd128__)
+    if (count >= 4)
+    {
+	const v128_t xmask = wasm_i32x4_splat(0x3f);
+	const v128_t ymask = wasm_i32x4_splat(0x0fc0);
+	const v128_t xstep4 = wasm_i32x4_splat(xstep * 4);
+	const v128_t ystep4 = wasm_i32x4_splat(ystep * 4);
+	v128_t x = wasm_i32x4_make(xf, xf + xstep, xf + 2*xstep, xf + 3*xstep);
+	v128_t y = wasm_i32x4_make(yf, yf + ystep, yf + 2*ystep, yf + 3*ystep);
+
+	for ( ; i + 4 <= count; i += 4)
+	{
+	    v128_t spot = wasm_v128_or(wasm_v128_and(wasm_u32x4_shr(y, 10), ymask),
+	                               wasm_v128_and(wasm_u32x4_shr(x, 16), xmask));
+	    wasm_v128_store(&spots[i], spot);
+	    x = wasm_i32x4_add(x, xstep4);
+	    y = wasm_i32x4_add(y, ystep4);
+	}
+
+	xf += i * xstep;
+	yf += i * ystep;
     }
-//	dscount++;
 #endif
 
-    dest = ylookup[ds_y] + columnofs[ds_x1];
+    for ( ; i < count; i++)
+    {
+	// [crispy] fix flats getting more distorted the closer they are to the right
+	spots[i] = ((yf >> 10) & 0x0fc0) | ((xf >> 16) & 0x3f);
+	xf += xstep;
+	yf += ystep;
+    }
+
+    *xfrac = xf;
+    *yfrac = yf;
+}
 
-    // We do not check for zero spans here?
-    count = ds_x2 - ds_x1;
+//
+// Draws the actual span.
+void R_DrawSpan (const spandef_t *spans, int count) 
+{ 
+    const byte *source = ds_source;
+    const byte *brightmap = ds_brightmap;
+    const spandef_t *span, *end;
+    int spots[SPANCHUNK];
 
-    do
+    for (span = spans, end = spans + count; span < end; span++)
     {
-	byte source;
-	// Calculate current texture index in u,v.
-        // [crispy] fix flats getting more distorted the closer they are to the right
-        ytemp = (ds_yfrac >> 10) & 0x0fc0;
-        xtemp = (ds_xfrac >> 16) & 0x3f;
-        spot = xtemp | ytemp;
-
-	// Lookup pixel from flat texture tile,
-	//  re-index using light/colormap.
-	source = ds_source[spot];
-	*dest++ = fullcolormap[ds_colormap[ds_brightmap[source]][source]];
-
-        ds_xfrac += ds_xstep;
-        ds_yfrac += ds_ystep;
-
-    } while (count--);
+	lighttable_t *const *colormap = span->colormap;
+	pixel_t *dest;
+	unsigned int xfrac, yfrac;
+	int n, i;
+
+#ifdef RANGECHECK
+	if (span->x2 < span->x1
+	    || span->x1<0
+	    || span->x2>=SCREENWIDTH
+	    || (unsigned)span->y>SCREENHEIGHT)
+	{
+	    I_Error( "R_DrawSpan: %i to %i at %i",
+		     span->x1,span->x2,span->y);
+	}
+//	dscount++;
+#endif
+
+	dest = ylookup[span->y] + columnofs[span->x1];
+	xfrac = span->xfrac;
+	yfrac = span->yfrac;
+
+	// We do not check for zero spans here?
+	for (n = span->x2 - span->x1 + 1; n > 0; n -= SPANCHUNK)
+	{
+	    const int chunk = MIN(n, SPANCHUNK);
+
+	    // Calculate current texture index in u,v.
+	    R_SpanSpots(spots, chunk, &xfrac, &yfrac, span->xstep, span->ystep);
+
+	    // Lookup pixel from flat texture tile,
+	    //  re-index using light/colormap.
+	    for (i = 0; i < chunk; i++)
+	    {
+		const byte texel = source[spots[i]];
+		*dest++ = fullcolormap[colormap[brightmap[texel]][texel]];
+	    }
+	}
+    }
 }
 
 //
 // Again..
 //
-void R_DrawSpanLow (void)
+void R_DrawSpanLow (const spandef_t *spans, int count)
 {
-    unsigned int xtemp, ytemp;
-    pixel_t *dest;
-    int count;
-    int spot;
+    const byte *source = ds_source;
+    const byte *brightmap = ds_brightmap;
+    const spandef_t *span, *end;
+    int spots[SPANCHUNK];
+
+    for (span = spans, end = spans + count; span < end; span++)
+    {
+	lighttable_t *const *colormap = span->colormap;
+	pixel_t *dest;
+	unsigned int xfrac, yfrac;
+	int n, i;
 
 #ifdef RANGECHECK
-    if (ds_x2 < ds_x1
-	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH
-	|| (unsigned)ds_y>SCREENHEIGHT)
+	if (span->x2 < span->x1
+	    || span->x1<0
+	    || span->x2>=SCREENWIDTH
+	    || (unsigned)span->y>SCREENHEIGHT)
+	{
+	    I_Error( "R_DrawSpan: %i to %i at %i",
+		     span->x1,span->x2,span->y);
+	}
+#endif
+
+	// Blocky mode, need to multiply by 2.
+	dest = ylookup[span->y] + columnofs[span->x1 << 1];
+	xfrac = span->xfrac;
+	yfrac = span->yfrac;
+
+	for (n = span->x2 - span->x1 + 1; n > 0; n -= SPANCHUNK)
+	{
+	    const int chunk = MIN(n, SPANCHUNK);
+
+	    R_SpanSpots(spots, chunk, &xfrac, &yfrac, span->xstep, span->ystep);
+
+	    // Lowres/blocky mode does it twice,
+	    //  while scale is adjusted appropriately.
+	    for (i = 0; i < chunk; i++)
+	    {
+		const byte texel = source[spots[i]];
+		*dest++ = colormap[brightmap[texel]][texel];
+		*dest++ = colormap[brightmap[texel]][texel];
+	    }
+	}
+    }
+}
+
+//
+// Threaded drawing.
+// With -rthreads, the column and span drawers are not run while the
+//  BSP is walked. Each call is recorded along with the drawer state
+//  it reads, and at the end of the frame the list is replayed by
+//  several threads, each owning a vertical strip of the view.
+// Every pixel still sees the same drawer calls in the same order as
+//  in the serial renderer, so the output is identical.
+//
+typedef struct
+{
+    void		(*func) (void);
+    boolean		span;
+    int			x1, x2;
+    int			yl, yh;
+    fixed_t		xfrac, xstep;	// dc_texturemid, dc_iscale for columns
+    fixed_t		yfrac, ystep;
+    int			texheight;
+    int			fuzzpos;
+    byte*		source;
+    byte*		brightmap;
+    byte*		translation;
+    lighttable_t*	colormap[2];
+} drawcmd_t;
+
+static drawcmd_t	*drawcmds = NULL;
+static int		numdrawcmds;
+static int		maxdrawcmds = 0;
+
+static int		numdrawthreads = 1;
+static boolean		deferring = false;
+
+// Lumps the recorded calls draw from, kept PU_STATIC until they have
+//  been replayed, so that the cache cannot purge them in between.
+static int		*heldlumps = NULL;
+static int		numheldlumps;
+static int		maxheldlumps = 0;
+static byte		*lumpheld = NULL;
+static unsigned int	lumpheldsize = 0;
+
+static void		(*realcolfunc) (void);
+static void		(*realfuzzcolfunc) (void);
+static void		(*realtranscolfunc) (void);
+static void		(*realtlcolfunc) (void);
+static void		(*realspanfunc) (const spandef_t *spans, int count);
+
+static drawcmd_t *R_NewDrawCmd (void (*func) (void))
+{
+    drawcmd_t	*cmd;
+
+    if (numdrawcmds == maxdrawcmds)
     {
-	I_Error( "R_DrawSpan: %i to %i at %i",
-		 ds_x1,ds_x2,ds_y);
+	maxdrawcmds = maxdrawcmds ? 2 * maxdrawcmds : 4096;
+	drawcmds = I_Realloc(drawcmds, maxdrawcmds * sizeof(*drawcmds));
     }
-#endif
 
-    count = (ds_x2 - ds_x1);
+    cmd = &drawcmds[numdrawcmds++];
+    cmd->func = func;
+
+    return cmd;
+}
+
+static void R_QueueColumnFunc (void (*func) (void))
+{
+    drawcmd_t	*cmd = R_NewDrawCmd(func);
+
+    cmd->span = false;
+    cmd->x1 = cmd->x2 = dc_x;
+    cmd->yl = dc_yl;
+    cmd->yh = dc_yh;
+    cmd->xfrac = dc_texturemid;
+    cmd->xstep = dc_iscale;
+    cmd->texheight = dc_texheight;
+    cmd->fuzzpos = fuzzpos;
+    cmd->source = dc_source;
+    cmd->brightmap = dc_brightmap;
+    cmd->translation = dc_translation;
+    cmd->colormap[0] = dc_colormap[0];
+    cmd->colormap[1] = dc_colormap[1];
+}
+
+static void R_QueueColumn (void)
+{
+    R_QueueColumnFunc(realcolfunc);
+}
+
+static void R_QueueFuzzColumn (void)
+{
+    R_QueueColumnFunc(realfuzzcolfunc);
+
+    // The fuzz drawer carries fuzzpos from one column to the next.
+    R_SkipFuzzColumn();
+}
+
+static void R_QueueTranslatedColumn (void)
+{
+    R_QueueColumnFunc(realtranscolfunc);
+}
+
+static void R_QueueTLColumn (void)
+{
+    R_QueueColumnFunc(realtlcolfunc);
+}
+
+static void R_QueueSpan (const spandef_t *spans, int count)
+{
+    const spandef_t	*span;
+    drawcmd_t		*cmd;
+
+    for (span = spans; span < spans + count; span++)
+    {
+	cmd = R_NewDrawCmd(NULL);
+
+	cmd->span = true;
+	cmd->x1 = span->x1;
+	cmd->x2 = span->x2;
+	cmd->yl = cmd->yh = span->y;
+	cmd->xfrac = span->xfrac;
+	cmd->xstep = span->xstep;
+	cmd->yfrac = span->yfrac;
+	cmd->ystep = span->ystep;
+	cmd->source = ds_source;
+	cmd->brightmap = ds_brightmap;
+	cmd->colormap[0] = span->colormap[0];
+	cmd->colormap[1] = span->colormap[1];
+    }
+}
+
+//
+// R_HoldLump
+// Called with each lump that a drawer reads from, once it has been
+//  cached. Caching a lump again as PU_CACHE makes it purgable, so this
+//  has to follow every W_CacheLumpNum and W_ReleaseLumpNum of it.
+//
+void R_HoldLump (int lump)
+{
+    if (!deferring)
+	return;
+
+    // Already cached by the caller, so this only changes the tag.
+    W_CacheLumpNum(lump, PU_STATIC);
+
+    if (lumpheld[lump])
+	return;
+
+    if (numheldlumps == maxheldlumps)
+    {
+	maxheldlumps = maxheldlumps ? 2 * maxheldlumps : 256;
+	heldlumps = I_Realloc(heldlumps, maxheldlumps * sizeof(*heldlumps));
+    }
+
+    heldlumps[numheldlumps++] = lump;
+    lumpheld[lump] = 1;
+}
+
+//
+// R_DrawStrip
+// Replays the recorded drawer calls that touch one strip.
+// Spans are clipped to the strip, with their texture coordinates
+//  stepped forward to the first pixel drawn.
+//
+static void R_DrawStrip (void *data, int strip)
+{
+    int		numstrips = *(int *) data;
+    int		x1 = strip * viewwidth / numstrips;
+    int		x2 = (strip + 1) * viewwidth / numstrips - 1;
+    drawcmd_t	*cmd, *end;
+    spandef_t	span;
+    int		skip;
+
+    for (cmd = drawcmds, end = drawcmds + numdrawcmds; cmd < end; cmd++)
+    {
+	if (cmd->x2 < x1 || cmd->x1 > x2)
+	    continue;
+
+	if (cmd->span)
+	{
+	    span.y = cmd->yl;
+	    span.x1 = MAX(cmd->x1, x1);
+	    span.x2 = MIN(cmd->x2, x2);
+	    skip = span.x1 - cmd->x1;
+	    span.xfrac = (fixed_t) ((unsigned) cmd->xfrac + (unsigned) skip * cmd->xstep);
+	    span.yfrac = (fixed_t) ((unsigned) cmd->yfrac + (unsigned) skip * cmd->ystep);
+	    span.xstep = cmd->xstep;
+	    span.ystep = cmd->ystep;
+	    span.colormap[0] = cmd->colormap[0];
+	    span.colormap[1] = cmd->colormap[1];
+	    ds_source = cmd->source;
+	    ds_brightmap = cmd->brightmap;
+
+	    realspanfunc(&span, 1);
+	}
+	else
+	{
+	    dc_x = cmd->x1;
+	    dc_yl = cmd->yl;
+	    dc_yh = cmd->yh;
+	    dc_texturemid = cmd->xfrac;
+	    dc_iscale = cmd->xstep;
+	    dc_texheight = cmd->texheight;
+	    fuzzpos = cmd->fuzzpos;
+	    dc_source = cmd->source;
+	    dc_brightmap = cmd->brightmap;
+	    dc_translation = cmd->translation;
+	    dc_colormap[0] = cmd->colormap[0];
+	    dc_colormap[1] = cmd->colormap[1];
+
+	    cmd->func();
+	}
+    }
+}
+
+//
+// R_InitDrawThreads
+//
+void R_InitDrawThreads (void)
+{
+    int		p;
+
+    //!
+    // @category video
+    // @arg <n>
+    //
+    // Draw the 3D view using n threads, or one per CPU if n is 0.
+    // Levels are also loaded using these threads.
+    //
+
+    p = M_CheckParmWithArgs("-rthreads", 1);
+
+    if (p > 0)
+    {
+	numdrawthreads = atoi(myargv[p+1]);
+
+	if (numdrawthreads <= 0)
+	    numdrawthreads = I_GetNumCPUs();
+
+	numdrawthreads = I_InitThreads(numdrawthreads);
+    }
+}
+
+//
+// R_BeginDeferredDraw
+// Called before the BSP walk; from here on the drawers only record.
+//
+void R_BeginDeferredDraw (void)
+{
+    if (numdrawthreads <= 1)
+	return;
 
-    // Blocky mode, need to multiply by 2.
-    ds_x1 <<= 1;
-    ds_x2 <<= 1;
+    realcolfunc = basecolfunc;
+    realfuzzcolfunc = fuzzcolfunc;
+    realtranscolfunc = transcolfunc;
+    realtlcolfunc = tlcolfunc;
+    realspanfunc = spanfunc;
 
-    dest = ylookup[ds_y] + columnofs[ds_x1];
+    colfunc = basecolfunc = R_QueueColumn;
+    fuzzcolfunc = R_QueueFuzzColumn;
+    transcolfunc = R_QueueTranslatedColumn;
+    tlcolfunc = R_QueueTLColumn;
+    spanfunc = R_QueueSpan;
 
-    do
+    if (lumpheldsize < numlumps)
     {
-	byte source;
-	// Calculate current texture index in u,v.
-        // [crispy] fix flats getting more distorted the closer they are to the right
-        ytemp = (ds_yfrac >> 10) & 0x0fc0;
-        xtemp = (ds_xfrac >> 16) & 0x3f;
-        spot = xtemp | ytemp;
+	lumpheld = I_Realloc(lumpheld, numlumps);
+	memset(lumpheld + lumpheldsize, 0, numlumps - lumpheldsize);
+	lumpheldsize = numlumps;
+    }
+
+    numdrawcmds = 0;
+    numheldlumps = 0;
+    deferring = true;
+}
+
+//
+// R_FinishDeferredDraw
+// Draws everything recorded since R_BeginDeferredDraw.
+//
+void R_FinishDeferredDraw (void)
+{
+    int		numstrips;
+    int		savedfuzzpos;
+    int		i;
+
+    if (!deferring)
+	return;
+
+    deferring = false;
 
-	// Lowres/blocky mode does it twice,
-	//  while scale is adjusted appropriately.
-	source = ds_source[spot];
-	*dest++ = ds_colormap[ds_brightmap[source]][source];
-	*dest++ = ds_colormap[ds_brightmap[source]][source];
+    colfunc = basecolfunc = realcolfunc;
+    fuzzcolfunc = realfuzzcolfunc;
+    transcolfunc = realtranscolfunc;
+    tlcolfunc = realtlcolfunc;
+    spanfunc = realspanfunc;
 
-	ds_xfrac += ds_xstep;
-	ds_yfrac += ds_ystep;
+    // A few more strips than threads evens out the load between
+    //  busy and empty parts of the view.
+    numstrips = MIN(2 * numdrawthreads, viewwidth);
 
+    // This thread takes part in the replay; keep the fuzzpos that
+    //  the recording left behind.
+    savedfuzzpos = fuzzpos;
+    I_RunParallel(R_DrawStrip, &numstrips, numstrips);
+    fuzzpos = savedfuzzpos;
 
-    } while (count--);
+    for (i = 0; i < numheldlumps; i++)
+    {
+	W_ReleaseLumpNum(heldlumps[i]);
+	lumpheld[heldlumps[i]] = 0;
+    }
 }
 
 //
@@ -964,6 +1204,13 @@ R_VideoErase
     if (background_buffer != NULL)
     {
         memcpy(I_VideoBuffer + ofs, background_buffer + ofs, count * sizeof(*I_VideoBuffer));
+
+        // Mark the rows touched, for GIF capture.
+        if (ofs % SCREENWIDTH + count <= SCREENWIDTH)
+            V_MarkRect(ofs % SCREENWIDTH, ofs / SCREENWIDTH, count, 1);
+        else
+            V_MarkRect(0, ofs / SCREENWIDTH, SCREENWIDTH,
+                       (ofs + count - 1) / SCREENWIDTH - ofs / SCREENWIDTH + 1);
     }
 } 
 
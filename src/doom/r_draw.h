@@ -23,17 +23,17 @@
 
 
 
-extern lighttable_t*	dc_colormap[2];
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
-extern int		dc_texheight;
-extern byte*		dc_brightmap;
+extern THREADLOCAL lighttable_t*	dc_colormap[2];
+extern THREADLOCAL int		dc_x;
+extern THREADLOCAL int		dc_yl;
+extern THREADLOCAL int		dc_yh;
+extern THREADLOCAL fixed_t		dc_iscale;
+extern THREADLOCAL fixed_t		dc_texturemid;
+extern THREADLOCAL int		dc_texheight;
+extern THREADLOCAL byte*		dc_brightmap;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern THREADLOCAL byte*		dc_source;		
 
 
 // The span blitting interface.
@@ -64,31 +64,22 @@ R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
-
-extern lighttable_t*	ds_colormap[2];
-extern byte*		ds_brightmap;
-
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern THREADLOCAL byte*		ds_brightmap;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern THREADLOCAL byte*		ds_source;		
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern THREADLOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
 // No Sepctre effect needed.
-void 	R_DrawSpan (void);
+// Draws a batch of spans that share ds_source and ds_brightmap.
+void 	R_DrawSpan (const spandef_t *spans, int count);
 
 // Low resolution mode, 160x200?
-void 	R_DrawSpanLow (void);
+void 	R_DrawSpanLow (const spandef_t *spans, int count);
 
 
 void
@@ -103,6 +94,14 @@ void	R_InitTranslationTables (void);
 
 
 
+// Threaded drawing (-rthreads): drawer calls made between Begin
+// and Finish are recorded, then replayed in parallel by Finish.
+void	R_InitDrawThreads (void);
+void	R_BeginDeferredDraw (void);
+void	R_FinishDeferredDraw (void);
+void	R_HoldLump (int lump);
+
+
 // Rendering function.
 void R_FillBackScreen (void);
 
@@ -0,0 +1,119 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Column drawer kernel. Not a regular header: r_draw.c includes
+//	it once per drawer, with the following defined:
+//
+//	DRAWCOL_NAME		name of the function to generate
+//	DRAWCOL_LOW		1 to write every texel to two pixels
+//	DRAWCOL_WRAP		how texture rows are wrapped, COLWRAP_*
+//	DRAWCOL_PIXEL(s, d)	value to store over pixel d for texel s
+//	DRAWCOL_STATIC		(optional) give the function internal linkage
+//
+//	All choices are made by the preprocessor, leaving nothing
+//	but the lookups themselves in the inner loop.
+//
+
+#ifndef COLWRAP_NONE
+#define COLWRAP_NONE	0	// no wrapping (sprites, masked columns)
+#define COLWRAP_POW2	1	// power-of-two height, mask the row
+#define COLWRAP_ANY	2	// any height -- killough's Tutti-Frutti fix
+#endif
+
+#ifdef DRAWCOL_STATIC
+static
+#endif
+void DRAWCOL_NAME (void)
+{
+    int			count;
+    pixel_t*		dest;
+#if DRAWCOL_LOW
+    pixel_t*		dest2;
+    const int		x = dc_x << 1;
+#else
+    const int		x = dc_x;
+#endif
+    fixed_t		frac;
+    fixed_t		fracstep;
+#if DRAWCOL_WRAP == COLWRAP_POW2
+    const int		heightmask = dc_texheight - 1;
+#elif DRAWCOL_WRAP == COLWRAP_ANY
+    const fixed_t	heightmask = dc_texheight << FRACBITS;
+#endif
+
+    count = dc_yh - dc_yl;
+
+    // Zero length, column does not exceed a pixel.
+    if (count < 0)
+	return;
+
+#ifdef RANGECHECK
+    if ((unsigned)x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+    {
+	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, x);
+    }
+#endif
+
+    // Framebuffer destination address.
+    // Use ylookup LUT to avoid multiply with ScreenWidth.
+    dest = ylookup[dc_yl] + columnofs[x];
+#if DRAWCOL_LOW
+    dest2 = ylookup[dc_yl] + columnofs[x+1];
+#endif
+
+    // Determine scaling,
+    //  which is the only mapping to be done.
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+#if DRAWCOL_WRAP == COLWRAP_ANY
+    if (frac < 0)
+	while ((frac += heightmask) < 0);
+    else
+	while (frac >= heightmask)
+	    frac -= heightmask;
+#endif
+
+    do
+    {
+#if DRAWCOL_WRAP == COLWRAP_POW2
+	const byte source = dc_source[(frac>>FRACBITS)&heightmask];
+#else
+	const byte source = dc_source[frac>>FRACBITS];
+#endif
+
+	*dest = DRAWCOL_PIXEL(source, *dest);
+	dest += SCREENWIDTH;
+#if DRAWCOL_LOW
+	*dest2 = DRAWCOL_PIXEL(source, *dest2);
+	dest2 += SCREENWIDTH;
+#endif
+
+#if DRAWCOL_WRAP == COLWRAP_ANY
+	if ((frac += fracstep) >= heightmask)
+	    frac -= heightmask;
+#else
+	frac += fracstep;
+#endif
+    } while (count--);
+}
+
+#undef DRAWCOL_NAME
+#undef DRAWCOL_LOW
+#undef DRAWCOL_WRAP
+#undef DRAWCOL_PIXEL
+#undef DRAWCOL_STATIC
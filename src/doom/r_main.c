@@ -33,6 +33,7 @@
 #include "m_bbox.h"
 #include "m_menu.h"
 
+#include "i_perf.h"
 #include "i_system.h" // [crispy] I_Realloc()
 #include "p_local.h" // [crispy] MLOOKUNIT
 #include "r_local.h"
@@ -129,7 +130,38 @@ void (*basecolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
 void (*tlcolfunc) (void);
-void (*spanfunc) (void);
+void (*spanfunc) (const spandef_t *spans, int count);
+
+// Drawers for each detail level.
+static const struct
+{
+    void (*colfunc) (void);
+    void (*fuzzcolfunc) (void);
+    void (*transcolfunc) (void);
+    void (*tlcolfunc) (void);
+    void (*spanfunc) (const spandef_t *spans, int count);
+} drawfuncs[2] =
+{
+    { R_DrawColumn, R_DrawFuzzColumn, R_DrawTranslatedColumn,
+      R_DrawTLColumn, R_DrawSpan },
+    { R_DrawColumnLow, R_DrawFuzzColumnLow, R_DrawTranslatedColumnLow,
+      R_DrawTLColumnLow, R_DrawSpanLow },
+};
+
+//
+// R_SetDrawFuncs
+// Installs the drawers for the current detail level.
+// Done at the start of every frame, so each frame starts from the
+//  plain drawers whatever the previous one swapped in.
+//
+static void R_SetDrawFuncs (void)
+{
+    colfunc = basecolfunc = drawfuncs[detailshift].colfunc;
+    fuzzcolfunc = drawfuncs[detailshift].fuzzcolfunc;
+    transcolfunc = drawfuncs[detailshift].transcolfunc;
+    tlcolfunc = drawfuncs[detailshift].tlcolfunc;
+    spanfunc = drawfuncs[detailshift].spanfunc;
+}
 
 
 
@@ -829,22 +861,7 @@ void R_ExecuteSetViewSize (void)
     centeryfrac = centery<<FRACBITS;
     projection = centerxfrac;
 
-    if (!detailshift)
-    {
-	colfunc = basecolfunc = R_DrawColumn;
-	fuzzcolfunc = R_DrawFuzzColumn;
-	transcolfunc = R_DrawTranslatedColumn;
-	tlcolfunc = R_DrawTLColumn;
-	spanfunc = R_DrawSpan;
-    }
-    else
-    {
-	colfunc = basecolfunc = R_DrawColumnLow;
-	fuzzcolfunc = R_DrawFuzzColumnLow;
-	transcolfunc = R_DrawTranslatedColumnLow;
-	tlcolfunc = R_DrawTLColumnLow;
-	spanfunc = R_DrawSpanLow;
-    }
+    R_SetDrawFuncs ();
 
     R_InitBuffer (scaledviewwidth, viewheight);
 	
@@ -921,6 +938,7 @@ void R_Init (void)
     R_InitLightTables ();
     R_InitSkyMap ();
     R_InitTranslationTables ();
+    R_InitDrawThreads ();
 	
     framecount = 0;
 }
@@ -966,6 +984,8 @@ void R_SetupFrame (player_t* player)
     
     viewplayer = player;
 
+    R_SetDrawFuncs ();
+
     viewx = player->mo->x;
     viewy = player->mo->y;
     viewz = player->viewz;
@@ -1031,6 +1051,8 @@ void R_RenderPlayerView (player_t* player)
     extern void V_DrawFilledBox (int x, int y, int w, int h, int c);
     extern void R_InterpolateTextureOffsets (void);
 
+    I_PerfBegin (PERF_BSP);
+
     R_SetupFrame (player);
 
     // Clear buffers.
@@ -1041,6 +1063,7 @@ void R_RenderPlayerView (player_t* player)
     if (automapactive)
     {
         R_RenderBSPNode (numnodes-1);
+        I_PerfEnd (PERF_BSP);
         return;
     }
     
@@ -1053,21 +1076,34 @@ void R_RenderPlayerView (player_t* player)
 
     // [crispy] smooth texture scrolling
     R_InterpolateTextureOffsets();
+
+    R_BeginDeferredDraw ();
+
     // The head node is the last node output.
     R_RenderBSPNode (numnodes-1);
     
     // Check for new console commands.
     NetUpdate ();
     
+    I_PerfBegin (PERF_PLANES);
     R_DrawPlanes ();
+    I_PerfEnd (PERF_PLANES);
     
     // Check for new console commands.
     NetUpdate ();
     
     // [crispy] draw fuzz effect independent of rendering frame rate
     R_SetFuzzPosDraw();
+    I_PerfBegin (PERF_MASKED);
     R_DrawMasked ();
+    I_PerfEnd (PERF_MASKED);
+
+    I_PerfBegin (PERF_DRAW);
+    R_FinishDeferredDraw ();
+    I_PerfEnd (PERF_DRAW);
 
     // Check for new console commands.
     NetUpdate ();				
+
+    I_PerfEnd (PERF_BSP);
 }
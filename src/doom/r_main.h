@@ -100,7 +100,7 @@ extern void		(*basecolfunc) (void);
 extern void		(*fuzzcolfunc) (void);
 extern void		(*tlcolfunc) (void);
 // No shadow effects on floors.
-extern void		(*spanfunc) (void);
+extern void		(*spanfunc) (const spandef_t *spans, int count);
 
 
 //
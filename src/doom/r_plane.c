@@ -49,6 +49,34 @@ visplane_t*		floorplane;
 visplane_t*		ceilingplane;
 static int		numvisplanes;
 
+// R_FindPlane looks visplanes up through a hash on (height, picnum,
+// lightlevel) instead of scanning them all. Chains hold indices into
+// visplanes[], since R_RaiseVisplanes may move the array. Only the
+// first visplane of each key is hashed: R_FindPlane always returns the
+// earliest match, the later ones are split off by R_CheckPlane.
+#define VISPLANEHASHBITS	9
+#define VISPLANEHASHSIZE	(1 << VISPLANEHASHBITS)
+static int		visplanehash[VISPLANEHASHSIZE];
+
+#define visplane_hash(picnum, lightlevel, height) \
+  (((unsigned)(picnum) * 3 + (unsigned)(lightlevel) + \
+    (unsigned)(height) * 7) & (VISPLANEHASHSIZE - 1))
+
+// Per-frame statistics: visplanes created (by either R_FindPlane or
+// R_CheckPlane) and R_FindPlane lookups that reused an existing one.
+int			visplanes_created;
+int			visplanes_reused;
+
+// Spans of the visplane being drawn, handed to spanfunc in batches
+#define MAXSPANBATCH	MAXHEIGHT
+static spandef_t	spanbatch[MAXSPANBATCH];
+static int		numspans = 0;
+
+// [crispy] swirling flat buffers, handed out by R_DistortedFlat
+static char		**distortedflats = NULL;
+static int		numdistortedflats;
+static int		maxdistortedflats = 0;
+
 // ?
 #define MAXOPENINGS	MAXWIDTH*64*4
 int			openings[MAXOPENINGS]; // [crispy] 32-bit integer math
@@ -99,6 +127,21 @@ void R_InitPlanes (void)
 }
 
 
+//
+// R_FlushSpans
+// Draws the spans collected by R_MapPlane.
+//
+static void R_FlushSpans (void)
+{
+    if (numspans > 0)
+    {
+	// high or low detail
+	spanfunc (spanbatch, numspans);
+	numspans = 0;
+    }
+}
+
+
 //
 // R_MapPlane
 //
@@ -122,6 +165,7 @@ R_MapPlane
     fixed_t	distance;
     unsigned	index;
     int dx, dy;
+    spandef_t*	span;
 	
 #ifdef RANGECHECK
     if (x2 < x1
@@ -141,27 +185,29 @@ R_MapPlane
 	return;
     }
 
+    span = &spanbatch[numspans];
+
     if (planeheight != cachedheight[y])
     {
 	cachedheight[y] = planeheight;
 	distance = cacheddistance[y] = FixedMul (planeheight, yslope[y]);
-	ds_xstep = cachedxstep[y] = (FixedMul (viewsin, planeheight) / dy) << detailshift;
-	ds_ystep = cachedystep[y] = (FixedMul (viewcos, planeheight) / dy) << detailshift;
+	span->xstep = cachedxstep[y] = (FixedMul (viewsin, planeheight) / dy) << detailshift;
+	span->ystep = cachedystep[y] = (FixedMul (viewcos, planeheight) / dy) << detailshift;
     }
     else
     {
 	distance = cacheddistance[y];
-	ds_xstep = cachedxstep[y];
-	ds_ystep = cachedystep[y];
+	span->xstep = cachedxstep[y];
+	span->ystep = cachedystep[y];
     }
 
     dx = x1 - centerx;
 
-    ds_xfrac = viewx + FixedMul(viewcos, distance) + dx * ds_xstep;
-    ds_yfrac = -viewy - FixedMul(viewsin, distance) + dx * ds_ystep;
+    span->xfrac = viewx + FixedMul(viewcos, distance) + dx * span->xstep;
+    span->yfrac = -viewy - FixedMul(viewsin, distance) + dx * span->ystep;
 
     if (fixedcolormap)
-	ds_colormap[0] = ds_colormap[1] = fixedcolormap;
+	span->colormap[0] = span->colormap[1] = fixedcolormap;
     else
     {
 	index = distance >> LIGHTZSHIFT;
@@ -169,16 +215,16 @@ R_MapPlane
 	if (index >= MAXLIGHTZ )
 	    index = MAXLIGHTZ-1;
 
-	ds_colormap[0] = planezlight[index];
-	ds_colormap[1] = cm_zlight[LIGHTLEVELS-1][MAXLIGHTZ-1];
+	span->colormap[0] = planezlight[index];
+	span->colormap[1] = cm_zlight[LIGHTLEVELS-1][MAXLIGHTZ-1];
     }
 	
-    ds_y = y;
-    ds_x1 = x1;
-    ds_x2 = x2;
+    span->y = y;
+    span->x1 = x1;
+    span->x2 = x2;
 
-    // high or low detail
-    spanfunc ();	
+    if (++numspans == MAXSPANBATCH)
+	R_FlushSpans ();
 }
 
 
@@ -200,6 +246,14 @@ void R_ClearPlanes (void)
 
     lastvisplane = visplanes;
     lastopening = openings;
+
+    for (i = 0; i < VISPLANEHASHSIZE; i++)
+	visplanehash[i] = -1;
+
+    visplanes_created = 0;
+    visplanes_reused = 0;
+
+    numdistortedflats = 0;
     
     // texture calculation
     memset (cachedheight, 0, sizeof(cachedheight));
@@ -249,6 +303,8 @@ R_FindPlane
   int		lightlevel )
 {
     visplane_t*	check;
+    unsigned	hash;
+    int		i;
 	
     // [crispy] add support for MBF sky tranfers
     if (picnum == skyflatnum || picnum & PL_SKYFLAT)
@@ -256,32 +312,38 @@ R_FindPlane
 	height = 0;			// all skys map together
 	lightlevel = 0;
     }
+
+    hash = visplane_hash(picnum, lightlevel, height);
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    for (i = visplanehash[hash]; i != -1; i = check->next)
     {
+	check = visplanes + i;
+
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    visplanes_reused++;
+	    return check;
 	}
     }
-    
-			
-    if (check < lastvisplane)
-	return check;
-		
+
+    check = lastvisplane;
     R_RaiseVisplanes(&check); // [crispy] remove VISPLANES limit
     if (lastvisplane - visplanes == MAXVISPLANES && false)
 	I_Error ("R_FindPlane: no more visplanes");
 		
     lastvisplane++;
+    visplanes_created++;
 
     check->height = height;
     check->picnum = picnum;
     check->lightlevel = lightlevel;
     check->minx = SCREENWIDTH;
     check->maxx = -1;
+
+    check->next = visplanehash[hash];
+    visplanehash[hash] = check - visplanes;
     
     memset (check->top,0xff,sizeof(check->top));
 		
@@ -356,6 +418,8 @@ R_CheckPlane
     pl = lastvisplane++;
     pl->minx = start;
     pl->maxx = stop;
+    pl->next = -1;
+    visplanes_created++;
 
     memset (pl->top,0xff,sizeof(pl->top));
 		
@@ -399,6 +463,8 @@ R_MakeSpans
 
 // [crispy] add support for SMMU swirling flats
 // adapted from smmu/r_ripple.c, by Simon Howard
+// Every call gets a buffer of its own for the rest of the frame,
+// since with -rthreads the spans are only drawn after R_DrawPlanes.
 static char *R_DistortedFlat (int flatnum)
 {
     const int swirlfactor = 8192 / 64;
@@ -410,7 +476,7 @@ static char *R_DistortedFlat (int flatnum)
     static int swirltic;
     static int offset[4096];
 
-    static char distortedflat[4096];
+    char *distortedflat;
     char *normalflat;
     int i;
 
@@ -447,6 +513,15 @@ static char *R_DistortedFlat (int flatnum)
 	swirltic = gametic;
     }
 
+    if (numdistortedflats == maxdistortedflats)
+    {
+	distortedflats = I_Realloc(distortedflats,
+	                           (maxdistortedflats + 1) * sizeof(*distortedflats));
+	distortedflats[maxdistortedflats++] = Z_Malloc(4096, PU_STATIC, NULL);
+    }
+
+    distortedflat = distortedflats[numdistortedflats++];
+
     normalflat = W_CacheLumpNum(flatnum, PU_STATIC);
 
     for (i = 0; i < 4096; i++)
@@ -454,7 +529,7 @@ static char *R_DistortedFlat (int flatnum)
 	distortedflat[i] = normalflat[offset[i]];
     }
 
-    Z_ChangeTag(normalflat, PU_CACHE);
+    W_ReleaseLumpNum(flatnum);
 
     return distortedflat;
 }
@@ -572,7 +647,13 @@ void R_DrawPlanes (void)
 			pl->top[x],
 			pl->bottom[x]);
 	}
+
+	R_FlushSpans ();
 	
         W_ReleaseLumpNum(lumpnum);
+
+	// With -rthreads, the spans have only been recorded.
+	if (!swirling)
+	    R_HoldLump(lumpnum);
     }
 }
\ No newline at end of file
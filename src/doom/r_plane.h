@@ -42,6 +42,9 @@ extern fixed_t*	yslope;
 extern fixed_t		yslopes[LOOKDIRS][MAXHEIGHT];
 extern fixed_t		distscale[MAXWIDTH];
 
+extern int		visplanes_created;
+extern int		visplanes_reused;
+
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
 
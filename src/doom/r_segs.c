@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "i_perf.h"
 #include "i_system.h"
 
 #include "doomdef.h"
@@ -881,7 +882,9 @@ R_StoreWallRange
     if (markfloor)
 	floorplane = R_CheckPlane (floorplane, rw_x, rw_stopx-1);
 
+    I_PerfBegin (PERF_SEGS);
     R_RenderSegLoop ();
+    I_PerfEnd (PERF_SEGS);
 
     
     // save sprite clipping info
@@ -467,6 +467,7 @@ R_DrawVisSprite
 	
 	
     patch = W_CacheLumpNum (vis->patch+firstspritelump, PU_CACHE);
+    R_HoldLump (vis->patch+firstspritelump);
 
     // [crispy] brightmaps for select sprites
     dc_colormap[0] = vis->colormap[0];
@@ -937,6 +938,83 @@ void R_DrawPlayerSprites (void)
 //
 // R_SortVisSprites
 //
+
+// Above this many vissprites, R_SortVisSprites uses a radix sort.
+#define RADIXSORTVISSPRITES	64
+
+static int	*vsprorder = NULL;
+static int	*vsprtemp = NULL;
+static int	vsprordersize = 0;
+
+// Flipping the sign bit makes the unsigned order of the keys match
+//  the signed order of the scales.
+#define VSPRKEY(i)	((unsigned int) vissprites[i].scale ^ 0x80000000u)
+
+//
+// R_RadixSortVisSprites
+// Stable LSD radix sort of vissprites[] by scale, eight bits per
+//  pass, with passes skipped where all keys share the same byte.
+// Returns the indices of the vissprites in drawing order; sprites
+//  of equal scale stay in the order they were added, as with the
+//  other sorts.
+//
+static int *R_RadixSortVisSprites (int count)
+{
+    int			counts[4][256];
+    int			*src, *dst, *swap;
+    unsigned int	key;
+    int			pass, shift;
+    int			i, n, sum;
+
+    if (count > vsprordersize)
+    {
+	vsprordersize = numvissprites;
+	vsprorder = I_Realloc(vsprorder, vsprordersize * sizeof(*vsprorder));
+	vsprtemp = I_Realloc(vsprtemp, vsprordersize * sizeof(*vsprtemp));
+    }
+
+    memset(counts, 0, sizeof(counts));
+
+    for (i = 0; i < count; i++)
+    {
+	key = VSPRKEY(i);
+	counts[0][key & 0xff]++;
+	counts[1][(key >> 8) & 0xff]++;
+	counts[2][(key >> 16) & 0xff]++;
+	counts[3][key >> 24]++;
+	vsprorder[i] = i;
+    }
+
+    src = vsprorder;
+    dst = vsprtemp;
+
+    for (pass = 0; pass < 4; pass++)
+    {
+	shift = pass * 8;
+
+	if (counts[pass][(VSPRKEY(0) >> shift) & 0xff] == count)
+	    continue;
+
+	for (i = 0, sum = 0; i < 256; i++)
+	{
+	    n = counts[pass][i];
+	    counts[pass][i] = sum;
+	    sum += n;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+	    dst[counts[pass][(VSPRKEY(src[i]) >> shift) & 0xff]++] = src[i];
+	}
+
+	swap = src;
+	src = dst;
+	dst = swap;
+    }
+
+    return src;
+}
+
 #ifdef HAVE_QSORT
 // [crispy] use stdlib's qsort() function for sorting the vissprites[] array
 static inline int cmp_vissprites (const void *a, const void *b)
@@ -953,12 +1031,34 @@ void R_SortVisSprites (void)
 {
     int count;
     vissprite_t *ds;
+    static vissprite_t *sorted = NULL;
+    static int sortedsize = 0;
 
     count = vissprite_p - vissprites;
 
     if (!count)
 	return;
 
+    if (count > RADIXSORTVISSPRITES)
+    {
+	int *order = R_RadixSortVisSprites(count);
+	int i;
+
+	if (count > sortedsize)
+	{
+	    sortedsize = numvissprites;
+	    sorted = I_Realloc(sorted, sortedsize * sizeof(*sorted));
+	}
+
+	for (i = 0; i < count; i++)
+	{
+	    sorted[i] = vissprites[order[i]];
+	}
+
+	memcpy(vissprites, sorted, count * sizeof(*vissprites));
+	return;
+    }
+
     // [crispy] maintain a stable sort for deliberately overlaid sprites
     for (ds = vissprites; ds < vissprite_p; ds++)
     {
@@ -986,6 +1086,23 @@ void R_SortVisSprites (void)
 
     if (!count)
 	return;
+
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+
+    if (count > RADIXSORTVISSPRITES)
+    {
+	int *order = R_RadixSortVisSprites(count);
+
+	for (i=0 ; i<count ; i++)
+	{
+	    best = &vissprites[order[i]];
+	    best->next = &vsprsortedhead;
+	    best->prev = vsprsortedhead.prev;
+	    vsprsortedhead.prev->next = best;
+	    vsprsortedhead.prev = best;
+	}
+	return;
+    }
 		
     for (ds=vissprites ; ds<vissprite_p ; ds++)
     {
@@ -1000,7 +1117,6 @@ void R_SortVisSprites (void)
     
     // pull the vissprites out by scale
 
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
     for (i=0 ; i<count ; i++)
     {
 	bestscale = INT_MAX;
@@ -0,0 +1,557 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Offline demo to video renderer. Plays a demo back one tic at a
+//	time, as -timedemo does, and writes every frame to a video file
+//	instead of the screen: a GIF, a YUV4MPEG2 stream, or raw RGB
+//	frames. Sound and music are mixed offline, a tic at a time, into
+//	a WAV file that lines up with the video.
+//
+//	The game thread runs the playsim and the renderer (which can use
+//	the -rthreads pool); frames are passed through a queue to an
+//	encoder thread, so encoding overlaps with the next tics.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+
+#include "i_framequeue.h"
+#include "i_sound.h"
+#include "i_swap.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "m_misc.h"
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "gifenc.h"
+
+#include "renderdemo.h"
+
+#define FRAME_SIZE (SCREENWIDTH * SCREENHEIGHT)
+
+// Frames waiting for the encoder thread.
+#define RENDER_QUEUE_SIZE 16
+
+typedef enum
+{
+    RENDER_RAW,
+    RENDER_Y4M,
+    RENDER_GIF,
+} renderformat_t;
+
+typedef struct
+{
+    pixel_t pixels[FRAME_SIZE];
+    byte palette[256 * 3];
+
+    // The sound of the tic that led to this frame.
+    int16_t *audio;
+    int samples;
+} renderframe_t;
+
+boolean renderingdemo = false;
+
+static renderformat_t format;
+static char *video_name;
+static FILE *video_file;
+static ge_GIF *gif;
+static char *audio_name;
+static FILE *audio_file;
+static int audio_rate;
+static uint32_t audio_bytes;
+
+static int frames;
+static uint64_t start_us;
+
+// Encoder state. The colour tables are for the palette last seen.
+
+static byte last_palette[256 * 3];
+static boolean have_palette;
+static byte *rgb_buffer;
+static byte y_table[256], u_table[256], v_table[256];
+static byte *yuv_buffer;
+static unsigned int gif_time;
+static int encoded_frames;
+
+// The encoder thread's queue, or NULL if frames are encoded as they
+// are drawn.
+
+static framequeue_t *encoder;
+static renderframe_t *queue;
+
+static boolean HasExtension(const char *name, const char *ext)
+{
+    size_t len, extlen;
+
+    len = strlen(name);
+    extlen = strlen(ext);
+
+    return len >= extlen && !strcasecmp(name + len - extlen, ext);
+}
+
+static void WriteLE16(byte *p, int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+}
+
+static void WriteLE32(byte *p, uint32_t value)
+{
+    WriteLE16(p, value & 0xffff);
+    WriteLE16(p + 2, value >> 16);
+}
+
+// A 16-bit stereo WAV header for 'data_bytes' of samples.
+
+static void WriteWAVHeader(FILE *stream, uint32_t data_bytes)
+{
+    byte header[44];
+
+    memcpy(header, "RIFF", 4);
+    WriteLE32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    WriteLE32(header + 16, 16);
+    WriteLE16(header + 20, 1);                  // PCM
+    WriteLE16(header + 22, 2);                  // channels
+    WriteLE32(header + 24, audio_rate);
+    WriteLE32(header + 28, audio_rate * 4);     // bytes per second
+    WriteLE16(header + 32, 4);                  // bytes per sample frame
+    WriteLE16(header + 34, 16);                 // bits per sample
+    memcpy(header + 36, "data", 4);
+    WriteLE32(header + 40, data_bytes);
+
+    fseek(stream, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), stream);
+}
+
+static void PaletteChanged(const byte *palette)
+{
+    int i, r, g, b;
+
+    memcpy(last_palette, palette, sizeof(last_palette));
+    have_palette = true;
+
+    // Full range BT.601, as the C420jpeg colour space says.
+
+    for (i = 0; i < 256; ++i)
+    {
+        r = palette[i * 3];
+        g = palette[i * 3 + 1];
+        b = palette[i * 3 + 2];
+
+        y_table[i] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+        u_table[i] = (-43 * r - 85 * g + 128 * b + 32896) >> 8;
+        v_table[i] = (128 * r - 107 * g - 21 * b + 32896) >> 8;
+    }
+}
+
+static void WriteRaw(renderframe_t *frame)
+{
+    const byte *rgb;
+    byte *dest;
+    int i;
+
+    dest = rgb_buffer;
+
+    for (i = 0; i < FRAME_SIZE; ++i)
+    {
+        rgb = &frame->palette[frame->pixels[i] * 3];
+        *dest++ = rgb[0];
+        *dest++ = rgb[1];
+        *dest++ = rgb[2];
+    }
+
+    fwrite(rgb_buffer, 3, FRAME_SIZE, video_file);
+}
+
+// 4:2:0, with each chroma sample the average of a 2x2 block.
+
+static void WriteY4M(renderframe_t *frame)
+{
+    const pixel_t *row;
+    byte *y, *u, *v;
+    int i, j;
+
+    y = yuv_buffer;
+    u = y + FRAME_SIZE;
+    v = u + FRAME_SIZE / 4;
+
+    for (i = 0; i < FRAME_SIZE; ++i)
+    {
+        y[i] = y_table[frame->pixels[i]];
+    }
+
+    for (j = 0; j < SCREENHEIGHT; j += 2)
+    {
+        row = frame->pixels + j * SCREENWIDTH;
+
+        for (i = 0; i < SCREENWIDTH; i += 2)
+        {
+            *u++ = (u_table[row[i]] + u_table[row[i + 1]]
+                  + u_table[row[i + SCREENWIDTH]]
+                  + u_table[row[i + SCREENWIDTH + 1]] + 2) >> 2;
+            *v++ = (v_table[row[i]] + v_table[row[i + 1]]
+                  + v_table[row[i + SCREENWIDTH]]
+                  + v_table[row[i + SCREENWIDTH + 1]] + 2) >> 2;
+        }
+    }
+
+    fputs("FRAME\n", video_file);
+    fwrite(yuv_buffer, 1, FRAME_SIZE + FRAME_SIZE / 2, video_file);
+}
+
+static void WriteGIF(renderframe_t *frame)
+{
+    unsigned int delay;
+
+    // The first frame's palette is the global one.
+
+    if (gif == NULL)
+    {
+        gif = ge_new_gif(video_name, SCREENWIDTH, SCREENHEIGHT,
+                         frame->palette, 8, 0);
+
+        if (gif == NULL)
+        {
+            I_Error("RenderDemo: Unable to open %s", video_name);
+        }
+    }
+    else
+    {
+        ge_set_palette(gif, frame->palette);
+    }
+
+    // A tic is not a whole number of hundredths of a second; round
+    // each delay so that they add up to the right time.
+
+    delay = (encoded_frames + 1) * 100 / TICRATE - gif_time;
+    gif_time += delay;
+
+    memcpy(gif->frame, frame->pixels, FRAME_SIZE);
+    ge_add_frame(gif, delay);
+}
+
+static void WriteAudio(renderframe_t *frame)
+{
+    int i;
+
+    for (i = 0; i < frame->samples * 2; ++i)
+    {
+        frame->audio[i] = SHORT(frame->audio[i]);
+    }
+
+    fwrite(frame->audio, 4, frame->samples, audio_file);
+    audio_bytes += frame->samples * 4;
+}
+
+static void EncodeFrame(void *data)
+{
+    renderframe_t *frame = data;
+
+    if (format != RENDER_GIF
+     && (!have_palette
+      || memcmp(frame->palette, last_palette, sizeof(last_palette))))
+    {
+        PaletteChanged(frame->palette);
+    }
+
+    switch (format)
+    {
+        case RENDER_RAW:
+            WriteRaw(frame);
+            break;
+
+        case RENDER_Y4M:
+            WriteY4M(frame);
+            break;
+
+        case RENDER_GIF:
+            WriteGIF(frame);
+            break;
+    }
+
+    if (audio_file != NULL)
+    {
+        WriteAudio(frame);
+    }
+
+    ++encoded_frames;
+}
+
+static void StartEncoder(void)
+{
+    int max_samples;
+    int i;
+
+    queue = calloc(RENDER_QUEUE_SIZE, sizeof(*queue));
+    max_samples = audio_rate / TICRATE + 1;
+
+    for (i = 0; i < RENDER_QUEUE_SIZE; ++i)
+    {
+        queue[i].audio = malloc(max_samples * 2 * sizeof(int16_t));
+    }
+
+    rgb_buffer = malloc(FRAME_SIZE * 3);
+    yuv_buffer = malloc(FRAME_SIZE + FRAME_SIZE / 2);
+
+    encoder = I_StartFrameQueue("renderdemo", queue, sizeof(*queue),
+                                RENDER_QUEUE_SIZE, EncodeFrame);
+
+    if (encoder == NULL)
+    {
+        printf("RenderDemo: No encoder thread, encoding as frames are "
+               "drawn.\n");
+    }
+}
+
+static void StopEncoder(void)
+{
+    if (encoder == NULL)
+    {
+        return;
+    }
+
+    I_StopFrameQueue(encoder);
+    encoder = NULL;
+}
+
+static void OpenOutputs(const char *lumpname)
+{
+    char *base;
+    int p;
+
+    //!
+    // @category demo
+    // @arg <filename>
+    //
+    // Write the video of -renderdemo to the specified file. A .gif
+    // file is an animated GIF and a .y4m file a YUV4MPEG2 stream;
+    // anything else gets raw 320x200 RGB24 frames at 35 fps. The
+    // default is the demo name with .y4m added.
+    //
+
+    p = M_CheckParmWithArgs("-renderout", 1);
+
+    if (p > 0)
+    {
+        video_name = M_StringDuplicate(myargv[p + 1]);
+    }
+    else
+    {
+        base = M_StringDuplicate(lumpname);
+        M_ForceLowercase(base);
+        video_name = M_StringJoin(base, ".y4m", NULL);
+        free(base);
+    }
+
+    if (HasExtension(video_name, ".gif"))
+    {
+        format = RENDER_GIF;
+    }
+    else if (HasExtension(video_name, ".y4m"))
+    {
+        format = RENDER_Y4M;
+    }
+    else
+    {
+        format = RENDER_RAW;
+    }
+
+    // gifenc opens its own file, with the first frame.
+
+    if (format != RENDER_GIF)
+    {
+        video_file = fopen(video_name, "wb");
+
+        if (video_file == NULL)
+        {
+            I_Error("RenderDemo: Unable to open %s", video_name);
+        }
+    }
+
+    if (format == RENDER_Y4M)
+    {
+        // Doom's pixels are taller than they are wide, 5:6, to fill
+        // a 4:3 screen.
+
+        fprintf(video_file, "YUV4MPEG2 W%i H%i F%i:1 Ip A5:6 C420jpeg\n",
+                SCREENWIDTH, SCREENHEIGHT, TICRATE);
+    }
+
+    //!
+    // @category demo
+    // @arg <filename>
+    //
+    // Write the sound of -renderdemo to the specified WAV file. The
+    // default is the video file name with .wav in place of its
+    // extension.
+    //
+
+    p = M_CheckParmWithArgs("-renderaudio", 1);
+
+    if (p > 0)
+    {
+        audio_name = M_StringDuplicate(myargv[p + 1]);
+    }
+    else
+    {
+        char *ext;
+
+        base = M_StringDuplicate(video_name);
+        ext = strrchr(base, '.');
+
+        if (ext != NULL && strchr(ext, DIR_SEPARATOR) == NULL)
+        {
+            *ext = '\0';
+        }
+
+        audio_name = M_StringJoin(base, ".wav", NULL);
+        free(base);
+    }
+
+    audio_rate = I_RenderSoundRate();
+
+    if (audio_rate == 0)
+    {
+        printf("RenderDemo: No sound, not writing %s.\n", audio_name);
+        return;
+    }
+
+    audio_file = fopen(audio_name, "wb");
+
+    if (audio_file == NULL)
+    {
+        I_Error("RenderDemo: Unable to open %s", audio_name);
+    }
+
+    WriteWAVHeader(audio_file, 0);
+}
+
+static void CloseOutputs(void)
+{
+    if (gif != NULL)
+    {
+        ge_close_gif(gif);
+        gif = NULL;
+    }
+
+    if (video_file != NULL)
+    {
+        fclose(video_file);
+        video_file = NULL;
+    }
+
+    if (audio_file != NULL)
+    {
+        WriteWAVHeader(audio_file, audio_bytes);
+        fclose(audio_file);
+        audio_file = NULL;
+    }
+}
+
+void RenderDemoStart(const char *lumpname)
+{
+    OpenOutputs(lumpname);
+    StartEncoder();
+
+    renderingdemo = true;
+    frames = 0;
+
+    printf("RenderDemo: Rendering %s to %s.\n", lumpname, video_name);
+
+    G_TimeDemo((char *) lumpname);
+}
+
+// Fill in a frame from the screen and the sound mixer.
+
+static void CaptureFrame(renderframe_t *frame)
+{
+    int64_t start, end;
+
+    memcpy(frame->pixels, I_VideoBuffer, sizeof(frame->pixels));
+    I_GetPalette(frame->palette);
+
+    // Each frame is one tic; take the samples up to the end of it,
+    // so that rounding doesn't add up.
+
+    start = (int64_t) frames * audio_rate / TICRATE;
+    end = (int64_t) (frames + 1) * audio_rate / TICRATE;
+    frame->samples = end - start;
+
+    I_RenderSound(frame->audio, frame->samples);
+}
+
+void RenderDemoFrame(void)
+{
+    renderframe_t *frame;
+
+    if (!renderingdemo || !demoplayback)
+    {
+        return;
+    }
+
+    if (frames == 0)
+    {
+        start_us = I_GetTimeUS();
+    }
+
+    if (encoder == NULL)
+    {
+        CaptureFrame(&queue[0]);
+        EncodeFrame(&queue[0]);
+        ++frames;
+        return;
+    }
+
+    frame = I_GetFreeFrame(encoder);
+    CaptureFrame(frame);
+    I_QueueFrame(encoder);
+
+    ++frames;
+}
+
+void RenderDemoDone(boolean played)
+{
+    double seconds;
+
+    if (!renderingdemo)
+    {
+        return;
+    }
+
+    StopEncoder();
+    CloseOutputs();
+
+    renderingdemo = false;
+
+    if (played && frames > 0)
+    {
+        seconds = (I_GetTimeUS() - start_us) / 1000000.0;
+
+        printf("RenderDemo: %i frames (%.1f s) in %.1f s, "
+               "%.1f times real time.\n",
+               frames, (double) frames / TICRATE, seconds,
+               seconds > 0 ? frames / (seconds * TICRATE) : 0.0);
+    }
+    else
+    {
+        printf("RenderDemo: The demo could not be played.\n");
+    }
+
+    I_Quit();
+}
@@ -0,0 +1,39 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Offline demo to video renderer (-renderdemo).
+//
+
+#ifndef __RENDERDEMO__
+#define __RENDERDEMO__
+
+#include "doomtype.h"
+
+// True while a -renderdemo run is in progress.
+
+extern boolean renderingdemo;
+
+// Open the outputs and start playing back the given demo lump.
+
+void RenderDemoStart(const char *lumpname);
+
+// Hand the frame just drawn, and the sound of the tic that led to it,
+// to the encoder. Called from D_Display in place of I_FinishUpdate.
+
+void RenderDemoFrame(void);
+
+// Called when the demo has finished (or could not be played). Waits
+// for the encoder to catch up, closes the outputs and quits.
+
+void RenderDemoDone(boolean played);
+
+#endif
@@ -0,0 +1,969 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Batch demo verification. -verifydemo plays a demo back without
+//	drawing anything and checksums the play state of every tic.
+//	-verify runs a list of such jobs, each with its own IWAD and
+//	PWADs, in worker processes forked before anything is set up, so
+//	that every demo starts from fresh global state. The results are
+//	written as JSON, and compared with an earlier report to find the
+//	demos that have gone out of sync.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define HAVE_FORK
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "config.h"
+#include "doomtype.h"
+
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+
+#include "doomstat.h"
+#include "g_game.h"
+#include "p_tick.h"
+
+#include "verify.h"
+
+// What a worker found, sent back to the process running the jobs as
+// one line of text.
+
+typedef struct
+{
+    boolean played;
+    int tics;
+    uint64_t time_us;
+
+    int gamestate;
+    int episode;
+    int map;
+    int leveltime;
+
+    unsigned int checksum;
+
+    // The first tic that did not match the checksums recorded with
+    // the demo (see -demochecksums), or -1, and what differed.
+    int desynctic;
+    int desyncmask;
+
+    // Where the demo's player was on the last tic spent in a level.
+    int x, y, z;
+    unsigned int angle;
+} verifyresult_t;
+
+#define RESULT_FORMAT "%i %i %" PRIu64 " %i %i %i %i %x %i %i %i %i %i %u\n"
+#define RESULT_SCAN   "%i %i %" SCNu64 " %i %i %i %i %x %i %i %i %i %i %u"
+
+boolean verifyingdemo = false;
+
+static verifyresult_t result;
+static uint64_t start_us;
+
+// Pipe to the process running the jobs, or -1 when -verifydemo was
+// given on its own.
+
+static int result_fd = -1;
+
+unsigned int VerifyTicChecksum(void)
+{
+    player_t *player;
+    mobj_t *mo;
+    unsigned int hash;
+    int i;
+
+    hash = M_HASH32_INIT;
+    hash = M_HashInt(hash, gamestate);
+    hash = M_HashInt(hash, gameepisode);
+    hash = M_HashInt(hash, gamemap);
+    hash = M_HashInt(hash, leveltime);
+    hash = M_HashInt(hash, prndindex);
+
+    for (i = 0; i < MAXPLAYERS; ++i)
+    {
+        if (!playeringame[i])
+        {
+            continue;
+        }
+
+        player = &players[i];
+
+        hash = M_HashInt(hash, player->health);
+        hash = M_HashInt(hash, player->armorpoints);
+        hash = M_HashInt(hash, player->readyweapon);
+        hash = M_HashInt(hash, player->killcount);
+        hash = M_HashInt(hash, player->itemcount);
+        hash = M_HashInt(hash, player->secretcount);
+
+        // Outside a level the player's mobj may already be freed.
+
+        mo = player->mo;
+
+        if (gamestate == GS_LEVEL && mo != NULL)
+        {
+            hash = M_HashInt(hash, mo->x);
+            hash = M_HashInt(hash, mo->y);
+            hash = M_HashInt(hash, mo->z);
+            hash = M_HashInt(hash, mo->angle);
+            hash = M_HashInt(hash, mo->momx);
+            hash = M_HashInt(hash, mo->momy);
+        }
+    }
+
+    // Those worked out by P_Ticker cover the rest of the level.
+
+    for (i = 0; i < NUMCHECKSUMS; ++i)
+    {
+        hash = M_HashInt(hash, tic_checksums[i]);
+    }
+
+    return hash;
+}
+
+void VerifyDemoStart(const char *lumpname)
+{
+    static char name[9];
+
+    M_StringCopy(name, lumpname, sizeof(name));
+
+    memset(&result, 0, sizeof(result));
+    result.checksum = M_HASH32_INIT;
+
+    verifyingdemo = true;
+    p_checksums = true;
+    G_TimeDemo(name);
+
+    // Only the playsim is verified.
+
+    nodrawers = true;
+}
+
+void VerifyTic(void)
+{
+    mobj_t *mo;
+
+    if (!verifyingdemo || !demoplayback)
+    {
+        return;
+    }
+
+    // As with -bench, the clock starts with the first tic, so that
+    // loading the level is not counted.
+
+    if (result.tics == 0)
+    {
+        start_us = I_GetTimeUS();
+    }
+
+    ++result.tics;
+    result.checksum = M_HashInt(result.checksum, VerifyTicChecksum());
+
+    mo = players[consoleplayer].mo;
+
+    if (gamestate == GS_LEVEL && mo != NULL)
+    {
+        result.x = mo->x;
+        result.y = mo->y;
+        result.z = mo->z;
+        result.angle = mo->angle;
+    }
+}
+
+static void WriteResult(void)
+{
+    char line[256];
+
+    M_snprintf(line, sizeof(line), RESULT_FORMAT,
+               (int) result.played, result.tics, result.time_us,
+               result.gamestate, result.episode, result.map,
+               result.leveltime, result.checksum,
+               result.desynctic, result.desyncmask,
+               result.x, result.y, result.z, result.angle);
+
+#ifdef HAVE_FORK
+    if (result_fd >= 0)
+    {
+        // Well under PIPE_BUF, so written in one go.
+
+        if (write(result_fd, line, strlen(line)) < 0)
+        {
+            I_Error("VerifyDemoDone: Failed to send the result");
+        }
+
+        return;
+    }
+#endif
+
+    printf("VerifyDemoDone: %s %i tics in %.3fs (%.1f tics/s), "
+           "checksum %08x, player at (%.1f, %.1f, %.1f)\n",
+           result.played ? "played" : "failed to play",
+           result.tics, result.time_us / 1000000.0,
+           result.time_us > 0 ? result.tics * 1000000.0 / result.time_us
+                              : 0.0,
+           result.checksum, result.x / (double) FRACUNIT,
+           result.y / (double) FRACUNIT, result.z / (double) FRACUNIT);
+    fflush(stdout);
+}
+
+void VerifyDemoDone(boolean played)
+{
+    if (!verifyingdemo)
+    {
+        return;
+    }
+
+    verifyingdemo = false;
+
+    result.played = played;
+    result.gamestate = gamestate;
+    result.episode = gameepisode;
+    result.map = gamemap;
+    result.leveltime = leveltime;
+    result.desynctic = demodesynctic;
+    result.desyncmask = demodesyncmask;
+
+    if (result.tics > 0)
+    {
+        result.time_us = I_GetTimeUS() - start_us;
+    }
+
+    WriteResult();
+
+#ifdef HAVE_FORK
+    // A worker leaves without the exit functions, which would have it
+    // save the config files at the same time as the others.
+
+    if (result_fd >= 0)
+    {
+        fflush(NULL);
+        _exit(0);
+    }
+#endif
+
+    I_Quit();
+}
+
+#ifdef HAVE_FORK
+
+typedef enum
+{
+    JOB_PLAYED,         // no earlier checksum to compare with
+    JOB_MATCH,
+    JOB_DESYNC,
+    JOB_ERROR,          // could not be played, or I_Error
+    JOB_CRASHED,
+    JOB_TIMEOUT,
+    NUM_JOB_STATUSES
+} jobstatus_t;
+
+static const char *status_names[] =
+{
+    "played", "match", "desync", "error", "crashed", "timeout",
+};
+
+typedef struct
+{
+    int line;
+    char *iwad;
+    char *demo;
+
+    // The command line of the worker.
+    char **argv;
+    int argc;
+
+    jobstatus_t status;
+    int exitcode;
+    verifyresult_t result;
+
+    boolean have_expected;
+    unsigned int expected;
+} verifyjob_t;
+
+typedef struct
+{
+    pid_t pid;
+    int fd;
+    int job;
+} verifyworker_t;
+
+static verifyjob_t *jobs;
+static int num_jobs;
+
+static void AddArg(verifyjob_t *job, const char *arg)
+{
+    job->argv = I_Realloc(job->argv, (job->argc + 2) * sizeof(*job->argv));
+    job->argv[job->argc++] = M_StringDuplicate(arg);
+    job->argv[job->argc] = NULL;
+}
+
+static boolean IsDehFile(const char *name)
+{
+    return M_StringEndsWith(name, ".deh") || M_StringEndsWith(name, ".DEH")
+        || M_StringEndsWith(name, ".bex") || M_StringEndsWith(name, ".BEX");
+}
+
+// A job is a line of the list: the IWAD, the demo, and then any PWADs
+// and dehacked patches to load. The rest of the line from the first
+// word starting with '-' is passed to the worker as it is.
+
+static void AddJob(char *line, int lineno)
+{
+    verifyjob_t *job;
+    char *words[64];
+    int num_words;
+    boolean have_files;
+    char *word;
+    int i;
+
+    num_words = 0;
+
+    for (word = strtok(line, " \t\r\n"); word != NULL;
+         word = strtok(NULL, " \t\r\n"))
+    {
+        if (word[0] == '#')
+        {
+            break;
+        }
+
+        if (num_words == arrlen(words))
+        {
+            I_Error("VerifyRunJobs: Too many words on line %i", lineno);
+        }
+
+        words[num_words++] = word;
+    }
+
+    if (num_words == 0)
+    {
+        return;
+    }
+
+    if (num_words < 2)
+    {
+        I_Error("VerifyRunJobs: Line %i should give an IWAD and a demo",
+                lineno);
+    }
+
+    jobs = I_Realloc(jobs, (num_jobs + 1) * sizeof(*jobs));
+    job = &jobs[num_jobs++];
+    memset(job, 0, sizeof(*job));
+
+    job->line = lineno;
+    job->iwad = M_StringDuplicate(words[0]);
+    job->demo = M_StringDuplicate(words[1]);
+
+    AddArg(job, myargv[0]);
+    AddArg(job, "-iwad");
+    AddArg(job, job->iwad);
+
+    have_files = false;
+
+    for (i = 2; i < num_words && words[i][0] != '-'; ++i)
+    {
+        if (!IsDehFile(words[i]))
+        {
+            if (!have_files)
+            {
+                AddArg(job, "-file");
+                have_files = true;
+            }
+
+            AddArg(job, words[i]);
+        }
+    }
+
+    have_files = false;
+
+    for (i = 2; i < num_words && words[i][0] != '-'; ++i)
+    {
+        if (IsDehFile(words[i]))
+        {
+            if (!have_files)
+            {
+                AddArg(job, "-deh");
+                have_files = true;
+            }
+
+            AddArg(job, words[i]);
+        }
+    }
+
+    AddArg(job, "-verifydemo");
+    AddArg(job, job->demo);
+
+    for (; i < num_words; ++i)
+    {
+        AddArg(job, words[i]);
+    }
+}
+
+static void ReadJobs(const char *filename)
+{
+    char line[1024];
+    FILE *stream;
+    int lineno;
+
+    stream = fopen(filename, "r");
+
+    if (stream == NULL)
+    {
+        I_Error("VerifyRunJobs: Unable to open %s", filename);
+    }
+
+    lineno = 0;
+
+    while (fgets(line, sizeof(line), stream) != NULL)
+    {
+        AddJob(line, ++lineno);
+    }
+
+    fclose(stream);
+}
+
+// Take the checksums from an earlier report on the same list, which
+// has one "checksum" for each job, in order.
+
+static void ReadExpected(const char *filename)
+{
+    static const char key[] = "\"checksum\": ";
+    FILE *stream;
+    char *buffer;
+    char *p;
+    long length;
+    int i;
+
+    // Read with the C library, as the zone is not set up yet.
+
+    stream = fopen(filename, "rb");
+
+    if (stream == NULL)
+    {
+        I_Error("VerifyRunJobs: Unable to open %s", filename);
+    }
+
+    length = M_FileLength(stream);
+    buffer = malloc(length + 1);
+    length = fread(buffer, 1, length, stream);
+    buffer[length] = '\0';
+    fclose(stream);
+
+    p = buffer;
+
+    for (i = 0; i < num_jobs; ++i)
+    {
+        p = strstr(p, key);
+
+        if (p == NULL)
+        {
+            I_Error("VerifyRunJobs: %s has only %i of %i jobs",
+                    filename, i, num_jobs);
+        }
+
+        p += strlen(key);
+
+        if (sscanf(p, "\"%x\"", &jobs[i].expected) == 1)
+        {
+            jobs[i].have_expected = true;
+        }
+    }
+
+    free(buffer);
+}
+
+// In the worker: redirect the output, which would only get mixed up
+// with that of the others, and take on the job's command line.
+
+static void StartWorker(verifyjob_t *job, int fd, int timeout)
+{
+    int devnull;
+
+    devnull = open("/dev/null", O_WRONLY);
+
+    if (devnull >= 0)
+    {
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        close(devnull);
+    }
+
+    result_fd = fd;
+
+    myargc = job->argc;
+    myargv = job->argv;
+
+    if (timeout > 0)
+    {
+        alarm(timeout);
+    }
+}
+
+static boolean ReadResult(int fd, verifyresult_t *result)
+{
+    char line[256];
+    ssize_t len;
+    int played;
+
+    len = read(fd, line, sizeof(line) - 1);
+
+    if (len <= 0)
+    {
+        return false;
+    }
+
+    line[len] = '\0';
+
+    if (sscanf(line, RESULT_SCAN,
+               &played, &result->tics, &result->time_us,
+               &result->gamestate, &result->episode, &result->map,
+               &result->leveltime, &result->checksum,
+               &result->desynctic, &result->desyncmask,
+               &result->x, &result->y, &result->z, &result->angle) != 14)
+    {
+        return false;
+    }
+
+    result->played = played != 0;
+
+    return true;
+}
+
+static void FinishJob(verifyjob_t *job, int status, int fd)
+{
+    boolean have_result;
+
+    have_result = ReadResult(fd, &job->result);
+    close(fd);
+
+    if (WIFSIGNALED(status))
+    {
+        job->exitcode = WTERMSIG(status);
+        job->status = WTERMSIG(status) == SIGALRM ? JOB_TIMEOUT : JOB_CRASHED;
+    }
+    else if (!have_result || !job->result.played)
+    {
+        job->exitcode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        job->status = JOB_ERROR;
+    }
+    else if (job->result.desynctic >= 0)
+    {
+        job->status = JOB_DESYNC;
+    }
+    else if (!job->have_expected)
+    {
+        job->status = JOB_PLAYED;
+    }
+    else if (job->result.checksum == job->expected)
+    {
+        job->status = JOB_MATCH;
+    }
+    else
+    {
+        job->status = JOB_DESYNC;
+    }
+}
+
+static void PrintString(FILE *stream, const char *s)
+{
+    fputc('"', stream);
+
+    for (; *s != '\0'; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            fputc('\\', stream);
+        }
+
+        fputc(*s, stream);
+    }
+
+    fputc('"', stream);
+}
+
+static void PrintJob(FILE *stream, verifyjob_t *job)
+{
+    verifyresult_t *result = &job->result;
+    boolean have_result;
+    int i;
+
+    have_result = job->status <= JOB_DESYNC;
+
+    fprintf(stream, "    {\n");
+    fprintf(stream, "      \"line\": %i,\n", job->line);
+    fprintf(stream, "      \"iwad\": ");
+    PrintString(stream, job->iwad);
+    fprintf(stream, ",\n      \"demo\": ");
+    PrintString(stream, job->demo);
+    fprintf(stream, ",\n      \"args\": [");
+
+    // Skip the program name.
+
+    for (i = 1; i < job->argc; ++i)
+    {
+        PrintString(stream, job->argv[i]);
+        fprintf(stream, i < job->argc - 1 ? ", " : "");
+    }
+
+    fprintf(stream, "],\n");
+    fprintf(stream, "      \"status\": \"%s\",\n", status_names[job->status]);
+
+    if (!have_result)
+    {
+        fprintf(stream, "      \"exitcode\": %i,\n", job->exitcode);
+    }
+
+    fprintf(stream, "      \"tics\": %i,\n", result->tics);
+    fprintf(stream, "      \"time_ms\": %.3f,\n", result->time_us / 1000.0);
+    fprintf(stream, "      \"tics_per_sec\": %.1f,\n",
+            result->time_us > 0 ? result->tics * 1000000.0 / result->time_us
+                                : 0.0);
+
+    if (have_result)
+    {
+        fprintf(stream, "      \"gamestate\": %i,\n", result->gamestate);
+        fprintf(stream, "      \"episode\": %i,\n", result->episode);
+        fprintf(stream, "      \"map\": %i,\n", result->map);
+        fprintf(stream, "      \"leveltime\": %i,\n", result->leveltime);
+        fprintf(stream, "      \"player\": "
+                "{ \"x\": %.4f, \"y\": %.4f, \"z\": %.4f, "
+                "\"angle\": %.2f },\n",
+                result->x / (double) FRACUNIT, result->y / (double) FRACUNIT,
+                result->z / (double) FRACUNIT,
+                result->angle * (360.0 / 4294967296.0));
+    }
+
+    if (have_result && result->desynctic >= 0)
+    {
+        fprintf(stream, "      \"desync_tic\": %i,\n", result->desynctic);
+        fprintf(stream, "      \"desync_in\": [");
+
+        for (i = 0; i < NUMCHECKSUMS; ++i)
+        {
+            if (result->desyncmask & (1 << i))
+            {
+                fprintf(stream, "\"%s\"%s", checksum_names[i],
+                        (result->desyncmask >> (i + 1)) != 0 ? ", " : "");
+            }
+        }
+
+        fprintf(stream, "],\n");
+    }
+
+    if (job->have_expected)
+    {
+        fprintf(stream, "      \"expected_checksum\": \"%08x\",\n",
+                job->expected);
+    }
+
+    // Always present, so that the report can be compared with later.
+
+    if (have_result)
+    {
+        fprintf(stream, "      \"checksum\": \"%08x\"\n", result->checksum);
+    }
+    else
+    {
+        fprintf(stream, "      \"checksum\": null\n");
+    }
+
+    fprintf(stream, "    }");
+}
+
+static void PrintReport(FILE *stream, int num_workers, uint64_t wall_us)
+{
+    int counts[NUM_JOB_STATUSES];
+    uint64_t time_us;
+    int tics;
+    int i;
+
+    memset(counts, 0, sizeof(counts));
+    time_us = 0;
+    tics = 0;
+
+    fprintf(stream, "{\n");
+    fprintf(stream, "  \"version\": \"%s\",\n", PACKAGE_STRING);
+    fprintf(stream, "  \"jobs\": [\n");
+
+    for (i = 0; i < num_jobs; ++i)
+    {
+        PrintJob(stream, &jobs[i]);
+        fprintf(stream, i < num_jobs - 1 ? ",\n" : "\n");
+
+        ++counts[jobs[i].status];
+        tics += jobs[i].result.tics;
+        time_us += jobs[i].result.time_us;
+    }
+
+    fprintf(stream, "  ],\n");
+    fprintf(stream, "  \"total\": {\n");
+    fprintf(stream, "    \"jobs\": %i,\n", num_jobs);
+
+    for (i = 0; i < NUM_JOB_STATUSES; ++i)
+    {
+        fprintf(stream, "    \"%s\": %i,\n", status_names[i], counts[i]);
+    }
+
+    fprintf(stream, "    \"workers\": %i,\n", num_workers);
+    fprintf(stream, "    \"tics\": %i,\n", tics);
+    fprintf(stream, "    \"time_ms\": %.3f,\n", time_us / 1000.0);
+    fprintf(stream, "    \"wall_ms\": %.3f,\n", wall_us / 1000.0);
+    fprintf(stream, "    \"tics_per_sec\": %.1f\n",
+            wall_us > 0 ? tics * 1000000.0 / wall_us : 0.0);
+    fprintf(stream, "  }\n");
+    fprintf(stream, "}\n");
+}
+
+static void WriteReport(int num_workers, uint64_t wall_us)
+{
+    FILE *stream;
+    int p;
+
+    //!
+    // @category demo
+    // @arg <filename>
+    //
+    // Write the -verify report to the specified file instead of
+    // stdout.
+    //
+
+    p = M_CheckParmWithArgs("-verifyout", 1);
+
+    if (p > 0 && strcmp(myargv[p + 1], "-") != 0)
+    {
+        stream = fopen(myargv[p + 1], "w");
+
+        if (stream == NULL)
+        {
+            I_Error("WriteReport: Unable to open %s", myargv[p + 1]);
+        }
+
+        PrintReport(stream, num_workers, wall_us);
+        fclose(stream);
+    }
+    else
+    {
+        PrintReport(stdout, num_workers, wall_us);
+        fflush(stdout);
+    }
+}
+
+static void RunJobs(int num_workers, int timeout)
+{
+    verifyworker_t *workers;
+    verifyworker_t *worker;
+    int running, next, done;
+    int fds[2];
+    int status;
+    pid_t pid;
+    int i;
+
+    workers = calloc(num_workers, sizeof(*workers));
+    running = 0;
+    next = 0;
+    done = 0;
+
+    while (next < num_jobs || running > 0)
+    {
+        // Fill the free workers.
+
+        for (i = 0; i < num_workers && next < num_jobs; ++i)
+        {
+            worker = &workers[i];
+
+            if (worker->pid > 0)
+            {
+                continue;
+            }
+
+            if (pipe(fds) != 0)
+            {
+                I_Error("VerifyRunJobs: Failed to create a pipe");
+            }
+
+            fflush(stdout);
+            fflush(stderr);
+
+            pid = fork();
+
+            if (pid < 0)
+            {
+                I_Error("VerifyRunJobs: Failed to start a worker");
+            }
+
+            if (pid == 0)
+            {
+                close(fds[0]);
+                StartWorker(&jobs[next], fds[1], timeout);
+                free(workers);
+                return;
+            }
+
+            close(fds[1]);
+
+            worker->pid = pid;
+            worker->fd = fds[0];
+            worker->job = next++;
+            ++running;
+        }
+
+        // Wait for one of them to finish.
+
+        pid = wait(&status);
+
+        if (pid < 0)
+        {
+            I_Error("VerifyRunJobs: Lost track of the workers");
+        }
+
+        for (i = 0; i < num_workers; ++i)
+        {
+            worker = &workers[i];
+
+            if (worker->pid == pid)
+            {
+                FinishJob(&jobs[worker->job], status, worker->fd);
+
+                fprintf(stderr, "[%i/%i] %s: %s\n", ++done, num_jobs,
+                        jobs[worker->job].demo,
+                        status_names[jobs[worker->job].status]);
+
+                worker->pid = 0;
+                --running;
+                break;
+            }
+        }
+    }
+
+    free(workers);
+}
+
+void VerifyRunJobs(void)
+{
+    uint64_t start;
+    int num_workers;
+    int timeout;
+    int p;
+
+    //!
+    // @arg <jobs>
+    // @category demo
+    //
+    // Play back every demo in the given list without drawing it, in
+    // as many processes at once as there are CPUs, and write a JSON
+    // report with the checksum of the play state over every tic, the
+    // player's final position, and how fast each demo ran. Each line
+    // of the list gives an IWAD, a demo, and any PWADs and dehacked
+    // patches to load, followed by any other options for that demo.
+    // Demos recorded with -demochecksums are checked tic by tic, and
+    // the first tic out of sync is reported.
+    //
+
+    p = M_CheckParmWithArgs("-verify", 1);
+
+    if (p == 0)
+    {
+        return;
+    }
+
+    ReadJobs(myargv[p + 1]);
+
+    if (num_jobs == 0)
+    {
+        I_Error("VerifyRunJobs: No jobs in %s", myargv[p + 1]);
+    }
+
+    //!
+    // @arg <report>
+    // @category demo
+    //
+    // Compare the checksums found by -verify with those in a report
+    // written by an earlier run on the same list, and mark the demos
+    // that no longer match as out of sync.
+    //
+
+    p = M_CheckParmWithArgs("-verifybase", 1);
+
+    if (p > 0)
+    {
+        ReadExpected(myargv[p + 1]);
+    }
+
+    //!
+    // @arg <n>
+    // @category demo
+    //
+    // Number of demos that -verify plays back at once. The default
+    // is the number of CPUs.
+    //
+
+    p = M_CheckParmWithArgs("-verifyjobs", 1);
+
+    if (p > 0)
+    {
+        num_workers = atoi(myargv[p + 1]);
+    }
+    else
+    {
+        num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if (num_workers < 1)
+    {
+        num_workers = 1;
+    }
+
+    //!
+    // @arg <seconds>
+    // @category demo
+    //
+    // Give up on a demo played back by -verify after this long.
+    //
+
+    p = M_CheckParmWithArgs("-verifytimeout", 1);
+    timeout = p > 0 ? atoi(myargv[p + 1]) : 0;
+
+    start = I_GetTimeUS();
+
+    RunJobs(num_workers, timeout);
+
+    // Back in a worker, to get on with its job.
+
+    if (result_fd >= 0)
+    {
+        return;
+    }
+
+    WriteReport(num_workers, I_GetTimeUS() - start);
+    exit(0);
+}
+
+#else
+
+void VerifyRunJobs(void)
+{
+    if (M_ParmExists("-verify"))
+    {
+        I_Error("VerifyRunJobs: -verify needs processes to run the jobs in");
+    }
+}
+
+#endif
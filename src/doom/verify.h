@@ -0,0 +1,49 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Batch demo verification (-verify, -verifydemo).
+//
+
+#ifndef __VERIFY__
+#define __VERIFY__
+
+#include "doomtype.h"
+
+// True while a -verifydemo run is in progress.
+
+extern boolean verifyingdemo;
+
+// With -verify, run the jobs in the given list in worker processes and
+// write the report. Called first thing in D_DoomMain; returns only in
+// the workers, with the command line replaced by that of their job, or
+// if -verify was not given.
+
+void VerifyRunJobs(void);
+
+// Start playing back the given demo lump without drawing anything.
+
+void VerifyDemoStart(const char *lumpname);
+
+// Called at the end of every tic, to add it to the checksum.
+
+void VerifyTic(void);
+
+// Called when the demo has finished (or could not be played). Writes
+// the result and quits.
+
+void VerifyDemoDone(boolean played);
+
+// Checksum of the play state at the end of the current tic.
+
+unsigned int VerifyTicChecksum(void);
+
+#endif
@@ -78,10 +78,18 @@
 #define PRINTF_ATTR(fmt, first) __attribute__((format(printf, fmt, first)))
 #define PRINTF_ARG_ATTR(x) __attribute__((format_arg(x)))
 
+#define THREADLOCAL __thread
+
 #else
 #define PACKEDATTR
 #define PRINTF_ATTR(fmt, first)
 #define PRINTF_ARG_ATTR(x)
+
+#ifdef _MSC_VER
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL
+#endif
 #endif
 
 #ifdef __WATCOMC__
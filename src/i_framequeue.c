@@ -0,0 +1,160 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Queue of captured frames for an encoder thread, so that
+//      encoding overlaps with the game. Used by GIF capture and by
+//      -renderdemo.
+//
+
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#include "i_framequeue.h"
+
+// The queue is a ring of frames from 'head', 'count' long, protected
+// by 'mutex'.
+
+struct framequeue_s
+{
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *frame_added;
+    SDL_cond *frame_done;
+
+    framequeue_func_t encode;
+    byte *frames;
+    size_t framesize;
+    int size;
+
+    int head;
+    int count;
+    boolean quit;
+};
+
+static void FreeQueue(framequeue_t *queue)
+{
+    if (queue->frame_done != NULL)
+        SDL_DestroyCond(queue->frame_done);
+    if (queue->frame_added != NULL)
+        SDL_DestroyCond(queue->frame_added);
+    if (queue->mutex != NULL)
+        SDL_DestroyMutex(queue->mutex);
+
+    free(queue);
+}
+
+static int EncoderThread(void *data)
+{
+    framequeue_t *queue = data;
+    void *frame;
+
+    SDL_LockMutex(queue->mutex);
+
+    for (;;)
+    {
+        while (queue->count == 0 && !queue->quit)
+        {
+            SDL_CondWait(queue->frame_added, queue->mutex);
+        }
+
+        if (queue->count == 0)
+        {
+            break;
+        }
+
+        // The frame keeps its slot until it has been encoded.
+
+        frame = queue->frames + queue->head * queue->framesize;
+
+        SDL_UnlockMutex(queue->mutex);
+        queue->encode(frame);
+        SDL_LockMutex(queue->mutex);
+
+        queue->head = (queue->head + 1) % queue->size;
+        --queue->count;
+        SDL_CondSignal(queue->frame_done);
+    }
+
+    SDL_UnlockMutex(queue->mutex);
+
+    return 0;
+}
+
+framequeue_t *I_StartFrameQueue(const char *name, void *frames,
+                                size_t framesize, int count,
+                                framequeue_func_t encode)
+{
+    framequeue_t *queue;
+
+    queue = calloc(1, sizeof(*queue));
+    queue->encode = encode;
+    queue->frames = frames;
+    queue->framesize = framesize;
+    queue->size = count;
+
+    queue->mutex = SDL_CreateMutex();
+    queue->frame_added = SDL_CreateCond();
+    queue->frame_done = SDL_CreateCond();
+
+    if (queue->mutex != NULL && queue->frame_added != NULL
+     && queue->frame_done != NULL)
+    {
+        queue->thread = SDL_CreateThread(EncoderThread, name, queue);
+    }
+
+    if (queue->thread == NULL)
+    {
+        FreeQueue(queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+void *I_GetFreeFrame(framequeue_t *queue)
+{
+    int slot;
+
+    SDL_LockMutex(queue->mutex);
+
+    while (queue->count == queue->size)
+    {
+        SDL_CondWait(queue->frame_done, queue->mutex);
+    }
+
+    slot = (queue->head + queue->count) % queue->size;
+
+    SDL_UnlockMutex(queue->mutex);
+
+    return queue->frames + slot * queue->framesize;
+}
+
+void I_QueueFrame(framequeue_t *queue)
+{
+    SDL_LockMutex(queue->mutex);
+    ++queue->count;
+    SDL_CondSignal(queue->frame_added);
+    SDL_UnlockMutex(queue->mutex);
+}
+
+void I_StopFrameQueue(framequeue_t *queue)
+{
+    SDL_LockMutex(queue->mutex);
+    queue->quit = true;
+    SDL_CondSignal(queue->frame_added);
+    SDL_UnlockMutex(queue->mutex);
+
+    SDL_WaitThread(queue->thread, NULL);
+    FreeQueue(queue);
+}
+
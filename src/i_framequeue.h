@@ -0,0 +1,54 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Queue of captured frames for an encoder thread.
+//
+
+
+#ifndef __I_FRAMEQUEUE__
+#define __I_FRAMEQUEUE__
+
+#include <stddef.h>
+
+#include "doomtype.h"
+
+typedef void (*framequeue_func_t)(void *frame);
+
+typedef struct framequeue_s framequeue_t;
+
+// Start a thread that calls encode() on each frame queued, in turn.
+// 'frames' is an array of 'count' frames of 'framesize' bytes, owned
+// by the caller, that are used as a ring. Returns NULL if the thread
+// could not be started (a wasm build without pthreads), in which case
+// the caller has to encode frames as they are captured.
+
+framequeue_t *I_StartFrameQueue(const char *name, void *frames,
+                                size_t framesize, int count,
+                                framequeue_func_t encode);
+
+// The frame to capture into next, once one is free. It is the free
+// slot at the tail, which the thread does not touch until it has
+// been handed over with I_QueueFrame.
+
+void *I_GetFreeFrame(framequeue_t *queue);
+
+// Hand the frame from I_GetFreeFrame to the thread.
+
+void I_QueueFrame(framequeue_t *queue);
+
+// Wait for every queued frame to be encoded and the thread to exit,
+// and free the queue (but not the frames).
+
+void I_StopFrameQueue(framequeue_t *queue);
+
+#endif
+
@@ -1,8 +1,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "i_framequeue.h"
 #include "i_gif.h"
+#include "i_perf.h"
+#include "i_timer.h"
 #include "i_video.h"
+#include "m_bbox.h"
+#include "v_video.h"
 #include "w_wad.h"
 #include "deh_str.h"
 #include "z_zone.h"
@@ -11,15 +16,120 @@
 #include <emscripten.h>
 
 #define GIF_FRAME_SIZE SCREENWIDTH * SCREENHEIGHT
-#define GIF_MAX_FRAME_COUNT 128
+#define GIF_PALETTE_SIZE 256 * 3
+
+// Frames waiting for the encoder thread. The game only waits when
+// the encoder has fallen this many frames behind.
+#define GIF_QUEUE_SIZE 8
+
+// Capture a frame every this many tics.
+
+int gif_capture_rate = 1;
+
+// Stop capturing after this many frames; 0 for no limit. Frames are
+// written to the file as they are encoded, so long captures take no
+// more memory than short ones.
+
+int gif_max_frames = 0;
+
+typedef struct
+{
+    byte *pixels;
+    uint16_t delay;
+
+    // The part of the screen drawn to since the last frame.
+    uint16_t x, y, w, h;
+
+    // Set if the palette changed since the last frame.
+    boolean newpalette;
+    byte palette[GIF_PALETTE_SIZE];
+} gifframe_t;
 
 ge_GIF *gif = NULL;
 unsigned int frame_count = 0;
 
+// Tic of the last frame captured, and the time in hundredths of a
+// second given to the frames so far, to keep rounding from adding up.
+
+static int last_tic;
+static unsigned int gif_tics;
+static unsigned int gif_time;
+
+// The palette last set with I_SetPaletteGIF.
+
+static byte gif_palette[GIF_PALETTE_SIZE];
+static boolean have_palette = false;
+static boolean palette_changed;
+
+// The encoder thread's queue, or NULL if frames are encoded as they
+// are added (a wasm build without pthreads).
+
+static framequeue_t *encoder = NULL;
+static gifframe_t queue[GIF_QUEUE_SIZE];
+
+static gifframe_t sync_frame;
+
+static void EncodeFrame(void *data)
+{
+    gifframe_t *frame = data;
+
+    if (frame->newpalette)
+    {
+        ge_set_palette(gif, frame->palette);
+    }
+
+    memcpy(gif->frame, frame->pixels, GIF_FRAME_SIZE);
+    ge_add_frame_rect(gif, frame->delay,
+                      frame->x, frame->y, frame->w, frame->h);
+}
+
+static void StartEncoder(void)
+{
+    int i;
+
+    if (queue[0].pixels == NULL)
+    {
+        for (i = 0; i < GIF_QUEUE_SIZE; ++i)
+        {
+            queue[i].pixels = malloc(GIF_FRAME_SIZE);
+        }
+    }
+
+    encoder = I_StartFrameQueue("gifenc", queue, sizeof(*queue),
+                                GIF_QUEUE_SIZE, EncodeFrame);
+}
+
+void I_SetPaletteGIF(const byte *palette)
+{
+    if (!have_palette || memcmp(gif_palette, palette, GIF_PALETTE_SIZE))
+    {
+        memcpy(gif_palette, palette, GIF_PALETTE_SIZE);
+        have_palette = true;
+        palette_changed = true;
+    }
+}
+
 void I_StartGIF()
 {
-    gif = ge_new_gif("temp.gif", SCREENWIDTH, SCREENHEIGHT, W_CacheLumpName (DEH_String("PLAYPAL"), PU_CACHE), 8, 0);
+    byte *palette;
+
+    // Start with the palette on screen, which is PLAYPAL until the
+    // video code has set one.
+
+    if (have_palette)
+        palette = gif_palette;
+    else
+        palette = W_CacheLumpName (DEH_String("PLAYPAL"), PU_CACHE);
+
+    gif = ge_new_gif("temp.gif", SCREENWIDTH, SCREENHEIGHT, palette, 8, 0);
     frame_count = 0;
+    palette_changed = false;
+    last_tic = -1;
+    gif_tics = 0;
+    gif_time = 0;
+
+    if (gif != NULL)
+        StartEncoder();
 }
 
 void I_CloseGIF()
@@ -27,6 +137,12 @@ void I_CloseGIF()
     if (gif == NULL)
         return;
 
+    if (encoder != NULL)
+    {
+        I_StopFrameQueue(encoder);
+        encoder = NULL;
+    }
+
     ge_close_gif(gif);
     gif = NULL;
 
@@ -38,15 +154,97 @@ void I_CloseGIF()
     }, "temp.gif");
 }
 
+// Fill in everything about a frame but its pixels.
+
+static void DescribeFrame(gifframe_t *frame, int tics)
+{
+    unsigned int delay;
+    int x1, y1, x2, y2;
+
+    // The delay is what this frame's tics round to once the ones
+    // before it are taken into account.
+
+    gif_tics += tics;
+    delay = gif_tics * 100 / TICRATE - gif_time;
+    gif_time += delay;
+    frame->delay = MIN(delay, 0xffff);
+
+    // Only the part of the screen that V_MarkRect has been told about
+    // needs to be compared with the last frame.
+
+    x1 = MAX(dirtybox[BOXLEFT], 0);
+    y1 = MAX(dirtybox[BOXBOTTOM], 0);
+    x2 = MIN(dirtybox[BOXRIGHT], SCREENWIDTH - 1);
+    y2 = MIN(dirtybox[BOXTOP], SCREENHEIGHT - 1);
+
+    if (x1 <= x2 && y1 <= y2)
+    {
+        frame->x = x1;
+        frame->y = y1;
+        frame->w = x2 - x1 + 1;
+        frame->h = y2 - y1 + 1;
+    }
+    else
+    {
+        frame->x = frame->y = frame->w = frame->h = 0;
+    }
+
+    M_ClearBox(dirtybox);
+
+    frame->newpalette = palette_changed;
+
+    if (palette_changed)
+    {
+        memcpy(frame->palette, gif_palette, GIF_PALETTE_SIZE);
+        palette_changed = false;
+    }
+}
+
+// Hand a frame to the encoder thread.
+
+static void QueueFrame(int tics)
+{
+    gifframe_t *frame;
+
+    frame = I_GetFreeFrame(encoder);
+    DescribeFrame(frame, tics);
+    memcpy(frame->pixels, I_VideoBuffer, GIF_FRAME_SIZE);
+    I_QueueFrame(encoder);
+}
+
 void I_AddFrameGIF()
 {
+    int tic, tics, rate;
+
     if (gif == NULL)
         return;
 
-    memcpy(gif->frame, I_VideoBuffer, GIF_FRAME_SIZE);
-    ge_add_frame(gif, 1);
+    // Only every gif_capture_rate'th tic is captured; the frame is
+    // shown for as long as it took to get to it.
+
+    rate = MAX(gif_capture_rate, 1);
+    tic = I_GetTime();
+    tics = last_tic < 0 ? rate : tic - last_tic;
+
+    if (tics < rate)
+        return;
+
+    last_tic = tic;
+
+    I_PerfBegin(PERF_GIF);
+    if (encoder != NULL)
+    {
+        QueueFrame(tics);
+    }
+    else
+    {
+        sync_frame.pixels = I_VideoBuffer;
+        DescribeFrame(&sync_frame, tics);
+        EncodeFrame(&sync_frame);
+    }
+    I_PerfEnd(PERF_GIF);
     frame_count++;
 
-    if (frame_count > GIF_MAX_FRAME_COUNT)
+    if (gif_max_frames > 0 && frame_count >= gif_max_frames)
         I_CloseGIF();
 }
\ No newline at end of file
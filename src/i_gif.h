@@ -1,8 +1,14 @@
 #ifndef __I_GIF__
 #define __I_GIF__
 
+#include "doomtype.h"
+
+extern int gif_capture_rate;
+extern int gif_max_frames;
+
 void I_StartGIF();
 void I_CloseGIF();
 void I_AddFrameGIF();
+void I_SetPaletteGIF(const byte *palette);
 
 #endif
\ No newline at end of file
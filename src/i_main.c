@@ -36,6 +36,27 @@
 
 void D_DoomMain (void);
 
+#ifndef __EMSCRIPTEN__
+
+// Native builds have no browser to drive the main loop, so the callback
+// registered by D_DoomMain is stored here and run from main() until
+// it is cancelled (I_Quit runs D_CancelLoopIter).
+
+static em_callback_func main_loop_func = NULL;
+
+void emscripten_set_main_loop(em_callback_func func, int fps,
+                              int simulate_infinite_loop)
+{
+    main_loop_func = func;
+}
+
+void emscripten_cancel_main_loop(void)
+{
+    main_loop_func = NULL;
+}
+
+#endif
+
 int main(int argc, char **argv)
 {
     // save arguments
@@ -49,6 +70,13 @@ int main(int argc, char **argv)
 
     D_DoomMain ();
 
+#ifndef __EMSCRIPTEN__
+    while (main_loop_func != NULL)
+    {
+        main_loop_func();
+    }
+#endif
+
     return 0;
 }
 
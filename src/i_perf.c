@@ -0,0 +1,378 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Per-frame phase timers. Every frame gets a record of how long
+//      each phase took, kept in a ring buffer so that a hitch can be
+//      looked at after the fact, either on the on-screen graph or
+//      from the page through I_GetPerfJSON.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <emscripten.h>
+
+#include "doomtype.h"
+#include "i_perf.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "i_video.h"
+
+// Must be a power of two.
+
+#define PERF_FRAMES 512
+
+#define MAX_PERF_DEPTH 8
+
+typedef struct
+{
+    uint64_t start_us;          // when the frame began
+    uint32_t interval_us;       // since the previous frame began
+    uint32_t total_us;          // inside the frame brackets
+    uint32_t phase_us[NUM_PERF_PHASES];
+} perfframe_t;
+
+static const char *phase_names[NUM_PERF_PHASES] =
+{
+    "tics", "bsp", "segs", "planes", "masked", "draw",
+    "hud", "blit", "sound", "gif",
+};
+
+static perfframe_t perf_frames[PERF_FRAMES];
+static unsigned int perf_head;  // frames recorded so far
+
+// The frame being measured.
+
+static uint64_t frame_start_us;
+static uint64_t last_frame_start_us;
+static uint64_t phase_us[NUM_PERF_PHASES];
+
+// Phases currently open, innermost last. The innermost one is charged
+// for the time since perf_mark_us.
+
+static perfphase_t perf_stack[MAX_PERF_DEPTH];
+static int perf_depth;
+static uint64_t perf_mark_us;
+
+void I_PerfBegin(perfphase_t phase)
+{
+    uint64_t now;
+
+    now = I_GetTimeUS();
+
+    if (perf_depth > 0)
+    {
+        phase_us[perf_stack[perf_depth - 1]] += now - perf_mark_us;
+    }
+
+    if (perf_depth < MAX_PERF_DEPTH)
+    {
+        perf_stack[perf_depth] = phase;
+    }
+
+    ++perf_depth;
+    perf_mark_us = now;
+}
+
+void I_PerfEnd(perfphase_t phase)
+{
+    uint64_t now;
+
+    now = I_GetTimeUS();
+
+    if (perf_depth <= 0)
+    {
+        return;
+    }
+
+    phase_us[phase] += now - perf_mark_us;
+
+    --perf_depth;
+    perf_mark_us = now;
+}
+
+void I_PerfBeginFrame(void)
+{
+    frame_start_us = I_GetTimeUS();
+}
+
+void I_PerfEndFrame(void)
+{
+    perfframe_t *frame;
+    int i;
+
+    frame = &perf_frames[perf_head & (PERF_FRAMES - 1)];
+    ++perf_head;
+
+    frame->start_us = frame_start_us;
+    frame->total_us = (uint32_t) (I_GetTimeUS() - frame_start_us);
+
+    if (last_frame_start_us != 0)
+    {
+        frame->interval_us = (uint32_t) (frame_start_us - last_frame_start_us);
+    }
+    else
+    {
+        frame->interval_us = frame->total_us;
+    }
+
+    last_frame_start_us = frame_start_us;
+
+    for (i = 0; i < NUM_PERF_PHASES; ++i)
+    {
+        frame->phase_us[i] = (uint32_t) phase_us[i];
+        phase_us[i] = 0;
+    }
+}
+
+//
+// I_GetPerfJSON
+//
+
+static char *perf_json = NULL;
+static size_t perf_json_len;
+static size_t perf_json_size = 0;
+
+static void PerfPrintf(const char *fmt, ...) PRINTF_ATTR(1, 2);
+
+static void PerfPrintf(const char *fmt, ...)
+{
+    va_list args;
+    int len;
+
+    for (;;)
+    {
+        va_start(args, fmt);
+        len = vsnprintf(perf_json + perf_json_len,
+                        perf_json_size - perf_json_len, fmt, args);
+        va_end(args);
+
+        if (len >= 0 && perf_json_len + len < perf_json_size)
+        {
+            perf_json_len += len;
+            return;
+        }
+
+        perf_json_size = perf_json_size ? 2 * perf_json_size : 16384;
+        perf_json = I_Realloc(perf_json, perf_json_size);
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *I_GetPerfJSON(int count)
+{
+    const perfframe_t *frame;
+    unsigned int first;
+    int i, p;
+
+    if (count < 0 || (unsigned int) count > perf_head)
+    {
+        count = perf_head;
+    }
+
+    if (count > PERF_FRAMES)
+    {
+        count = PERF_FRAMES;
+    }
+
+    first = perf_head - count;
+
+    perf_json_len = 0;
+    PerfPrintf("[\n");
+
+    for (i = 0; i < count; ++i)
+    {
+        frame = &perf_frames[(first + i) & (PERF_FRAMES - 1)];
+
+        PerfPrintf("  { \"frame\": %u, \"start_us\": %" PRIu64
+                   ", \"interval_us\": %u, \"total_us\": %u",
+                   first + i, frame->start_us,
+                   frame->interval_us, frame->total_us);
+
+        for (p = 0; p < NUM_PERF_PHASES; ++p)
+        {
+            PerfPrintf(", \"%s_us\": %u", phase_names[p], frame->phase_us[p]);
+        }
+
+        PerfPrintf(" }%s\n", i < count - 1 ? "," : "");
+    }
+
+    PerfPrintf("]\n");
+
+    return perf_json;
+}
+
+//
+// Frame time graph: one column per frame, newest on the right, with
+// each phase stacked in its own colour from the bottom up, one pixel
+// per millisecond. The dotted line marks one tic (1000/35 ms).
+//
+
+#define GRAPH_W 128
+#define GRAPH_H 48
+#define GRAPH_X (SCREENWIDTH - GRAPH_W - 2)
+#define GRAPH_Y 2
+
+static const byte phase_colors[NUM_PERF_PHASES][3] =
+{
+    { 0x00, 0xff, 0x00 },   // tics
+    { 0x00, 0x80, 0xff },   // bsp
+    { 0x00, 0x00, 0xc0 },   // segs
+    { 0xc0, 0x60, 0x00 },   // planes
+    { 0xff, 0x00, 0xff },   // masked
+    { 0x00, 0xc0, 0xc0 },   // draw
+    { 0xff, 0xff, 0x00 },   // hud
+    { 0xff, 0x00, 0x00 },   // blit
+    { 0x80, 0x40, 0x20 },   // sound
+    { 0xff, 0x80, 0x80 },   // gif
+};
+
+static boolean display_perf_graph = false;
+static boolean graph_drawn = false;
+static pixel_t graph_background[GRAPH_W * GRAPH_H];
+
+EMSCRIPTEN_KEEPALIVE
+void I_DisplayPerfGraph(boolean graph_on)
+{
+    display_perf_graph = graph_on;
+}
+
+static pixel_t *GraphPixel(int x, int y)
+{
+    return I_VideoBuffer + (GRAPH_Y + GRAPH_H - 1 - y) * SCREENWIDTH
+         + GRAPH_X + x;
+}
+
+static void DrawGraphColumn(int x, const perfframe_t *frame,
+                            const pixel_t *colors, pixel_t other,
+                            pixel_t clipped)
+{
+    uint64_t sum_us;
+    int y, top;
+    int p;
+
+    // Rounding the running sum, not each phase, keeps short phases
+    // from adding up to more than the frame took.
+
+    sum_us = 0;
+    y = 0;
+
+    for (p = 0; p <= NUM_PERF_PHASES && y < GRAPH_H; ++p)
+    {
+        if (p < NUM_PERF_PHASES)
+        {
+            sum_us += frame->phase_us[p];
+        }
+        else if (frame->total_us > sum_us)
+        {
+            sum_us = frame->total_us;
+        }
+
+        top = (int) ((sum_us + 500) / 1000);
+
+        if (top > GRAPH_H)
+        {
+            top = GRAPH_H;
+        }
+
+        for (; y < top; ++y)
+        {
+            *GraphPixel(x, y) = p < NUM_PERF_PHASES ? colors[p] : other;
+        }
+    }
+
+    if ((sum_us + 500) / 1000 > GRAPH_H)
+    {
+        *GraphPixel(x, GRAPH_H - 1) = clipped;
+    }
+}
+
+void I_DrawPerfGraph(void)
+{
+    pixel_t colors[NUM_PERF_PHASES];
+    pixel_t black, grey, white;
+    pixel_t *dest;
+    unsigned int frame;
+    int tic_y;
+    int x, y;
+
+    if (!display_perf_graph)
+    {
+        return;
+    }
+
+    // Save what is under the graph, then clear it.
+
+    for (y = 0; y < GRAPH_H; ++y)
+    {
+        dest = I_VideoBuffer + (GRAPH_Y + y) * SCREENWIDTH + GRAPH_X;
+        memcpy(graph_background + y * GRAPH_W, dest, GRAPH_W * sizeof(*dest));
+    }
+
+    graph_drawn = true;
+
+    // Look the colours up every time, as the palette may have changed.
+
+    for (x = 0; x < NUM_PERF_PHASES; ++x)
+    {
+        colors[x] = I_GetPaletteIndex(phase_colors[x][0],
+                                      phase_colors[x][1],
+                                      phase_colors[x][2]);
+    }
+
+    black = I_GetPaletteIndex(0x00, 0x00, 0x00);
+    grey = I_GetPaletteIndex(0x80, 0x80, 0x80);
+    white = I_GetPaletteIndex(0xff, 0xff, 0xff);
+
+    tic_y = (1000 + TICRATE / 2) / TICRATE;
+
+    for (x = 0; x < GRAPH_W; ++x)
+    {
+        for (y = 0; y < GRAPH_H; ++y)
+        {
+            *GraphPixel(x, y) = y == tic_y && (x & 1) ? grey : black;
+        }
+
+        // Frames are lined up on the right hand side.
+
+        if (perf_head < (unsigned int) (GRAPH_W - x))
+        {
+            continue;
+        }
+
+        frame = perf_head - (GRAPH_W - x);
+
+        DrawGraphColumn(x, &perf_frames[frame & (PERF_FRAMES - 1)],
+                        colors, grey, white);
+    }
+}
+
+void I_RestorePerfGraphBackground(void)
+{
+    pixel_t *dest;
+    int y;
+
+    if (!graph_drawn)
+    {
+        return;
+    }
+
+    for (y = 0; y < GRAPH_H; ++y)
+    {
+        dest = I_VideoBuffer + (GRAPH_Y + y) * SCREENWIDTH + GRAPH_X;
+        memcpy(dest, graph_background + y * GRAPH_W, GRAPH_W * sizeof(*dest));
+    }
+
+    graph_drawn = false;
+}
+
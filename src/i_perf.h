@@ -0,0 +1,65 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Per-frame phase timers, kept for the last few hundred frames.
+//
+
+
+#ifndef __I_PERF__
+#define __I_PERF__
+
+#include "doomtype.h"
+
+typedef enum
+{
+    PERF_TICS,          // TryRunTics: game tics and networking
+    PERF_BSP,           // frame setup and the BSP walk
+    PERF_SEGS,          // wall columns (R_RenderSegLoop)
+    PERF_PLANES,        // R_DrawPlanes
+    PERF_MASKED,        // sprites and masked midtextures
+    PERF_DRAW,          // replaying queued drawing on worker threads
+    PERF_HUD,           // status bar, HUD, automap, menus and wipes
+    PERF_BLIT,          // I_FinishUpdate
+    PERF_SOUND,         // S_UpdateSounds
+    PERF_GIF,           // GIF frame capture
+    NUM_PERF_PHASES
+} perfphase_t;
+
+// Time spent in a phase is exclusive: while a phase is nested inside
+// another, the outer one is not charged. Calls must pair up.
+
+void I_PerfBegin(perfphase_t phase);
+void I_PerfEnd(perfphase_t phase);
+
+// Bracket one iteration of the main loop. Phase time measured outside
+// of a frame is charged to the next one.
+
+void I_PerfBeginFrame(void);
+void I_PerfEndFrame(void);
+
+// The last 'count' frames, oldest first, as JSON. The string is
+// overwritten by the next call.
+
+const char *I_GetPerfJSON(int count);
+
+// Set whether the frame time graph is drawn over the screen.
+
+void I_DisplayPerfGraph(boolean graph_on);
+
+// Draw the graph into I_VideoBuffer, and put back what it covered
+// once the screen has been blitted.
+
+void I_DrawPerfGraph(void);
+void I_RestorePerfGraphBackground(void);
+
+#endif
+
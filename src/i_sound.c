@@ -17,7 +17,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "SDL.h"
 #include "SDL_mixer.h"
 
 #include "config.h"
@@ -46,6 +48,11 @@ int snd_maxslicetime_ms = 28 * 4;
 
 char *snd_musiccmd = "";
 
+// If true, sound is not played but mixed on request by I_RenderSound.
+// Set before I_InitSound.
+
+boolean snd_offline = false;
+
 // Whether to vary the pitch of sound effects
 // Each game will set the default differently
 
@@ -212,6 +219,20 @@ void I_InitSound(boolean use_sfx_prefix)
 
     nomusic = M_CheckParm("-nomusic") > 0;
 
+#ifdef HEADLESS
+    // There is no audio device (or Web Audio context) to play to. Sound
+    // mixed offline goes through SDL's dummy driver instead.
+
+    if (snd_offline)
+    {
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+    else
+    {
+        nosound = true;
+    }
+#endif
+
     // Initialize the sound and music subsystems.
 
     if (!nosound && !screensaver_mode)
@@ -236,6 +257,15 @@ void I_InitSound(boolean use_sfx_prefix)
         {
             InitMusicModule();
         }
+
+        // The modules are up, and the OPL emulator has been detected
+        // (which needs time to pass), so stop the device from mixing
+        // anything that I_RenderSound should.
+
+        if (snd_offline && (sound_module != NULL || music_module != NULL))
+        {
+            Mix_PauseAudio(1);
+        }
     }
 }
 
@@ -340,6 +370,55 @@ boolean I_SoundIsPlaying(int channel)
     }
 }
 
+// Sample rate of the sound mixed by I_RenderSound, or 0 if nothing
+// is mixed.
+
+int I_RenderSoundRate(void)
+{
+    static boolean warned = false;
+    int freq, channels;
+    Uint16 format;
+
+    if (!snd_offline || (sound_module == NULL && music_module == NULL)
+     || !Mix_QuerySpec(&freq, &format, &channels))
+    {
+        return 0;
+    }
+
+    // The samples are handed out as they are mixed, so the device has
+    // to be 16-bit stereo in the machine's byte order, as asked for;
+    // SDL_mixer can settle for something else.
+
+    if (format != AUDIO_S16SYS || channels != 2)
+    {
+        if (!warned)
+        {
+            fprintf(stderr, "I_RenderSound: Mixer is format 0x%x with "
+                            "%i channels, not 16-bit stereo.\n",
+                    format, channels);
+            warned = true;
+        }
+
+        return 0;
+    }
+
+    return freq;
+}
+
+// Mix the next 'samples' stereo samples of sound and music into
+// 'buffer', with snd_offline set. Silence if there is no sound.
+
+void I_RenderSound(int16_t *buffer, int samples)
+{
+    if (I_RenderSoundRate() == 0)
+    {
+        memset(buffer, 0, samples * 2 * sizeof(*buffer));
+        return;
+    }
+
+    Mix_MixAudio((Uint8 *) buffer, samples * 2 * sizeof(*buffer));
+}
+
 void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
 {
     if (sound_module != NULL && sound_module->CacheSounds != NULL)
@@ -161,6 +161,8 @@ int I_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, int pitch);
 void I_StopSound(int channel);
 boolean I_SoundIsPlaying(int channel);
 void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds);
+int I_RenderSoundRate(void);
+void I_RenderSound(int16_t *buffer, int samples);
 
 // Interface for music modules
 
@@ -235,6 +237,7 @@ extern int snd_cachesize;
 extern int snd_maxslicetime_ms;
 extern char *snd_musiccmd;
 extern int snd_pitchshift;
+extern boolean snd_offline;
 
 void I_BindSoundVariables(void);
 
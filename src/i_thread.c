@@ -0,0 +1,206 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Worker thread pool, built on SDL threads. Where threads are
+//      not available (a wasm build without pthreads) everything
+//      runs on the calling thread.
+//
+
+#include <stdio.h>
+
+#include "SDL.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+
+#define MAX_THREADS 64
+
+static SDL_Thread *workers[MAX_THREADS];
+static int num_workers = 0;
+
+static SDL_mutex *pool_mutex;
+static SDL_cond *work_cond;
+static SDL_cond *done_cond;
+
+// The current batch of jobs, protected by pool_mutex. 'generation'
+// is bumped for every batch so that sleeping workers can tell a new
+// batch from a spurious wakeup.
+
+static parallel_func_t work_func;
+static void *work_data;
+static int work_count;
+static int work_next;
+static int work_pending;
+static int generation;
+static boolean quitting;
+
+int I_GetNumCPUs(void)
+{
+    int cpus;
+
+    cpus = SDL_GetCPUCount();
+
+    return cpus > 0 ? cpus : 1;
+}
+
+// Take jobs off the current batch until none are left. Called, and
+// returns, with pool_mutex held.
+
+static void RunJobs(void)
+{
+    int index;
+
+    while (work_next < work_count)
+    {
+        index = work_next++;
+
+        SDL_UnlockMutex(pool_mutex);
+        work_func(work_data, index);
+        SDL_LockMutex(pool_mutex);
+
+        if (--work_pending == 0)
+        {
+            SDL_CondBroadcast(done_cond);
+        }
+    }
+}
+
+static int WorkerThread(void *unused)
+{
+    int seen;
+
+    SDL_LockMutex(pool_mutex);
+
+    seen = generation;
+
+    while (!quitting)
+    {
+        if (generation == seen)
+        {
+            SDL_CondWait(work_cond, pool_mutex);
+            continue;
+        }
+
+        seen = generation;
+        RunJobs();
+    }
+
+    SDL_UnlockMutex(pool_mutex);
+
+    return 0;
+}
+
+static void I_ShutdownThreads(void)
+{
+    int i;
+
+    if (num_workers == 0)
+    {
+        return;
+    }
+
+    SDL_LockMutex(pool_mutex);
+    quitting = true;
+    SDL_CondBroadcast(work_cond);
+    SDL_UnlockMutex(pool_mutex);
+
+    for (i = 0; i < num_workers; ++i)
+    {
+        SDL_WaitThread(workers[i], NULL);
+    }
+
+    num_workers = 0;
+}
+
+int I_InitThreads(int count)
+{
+    char name[16];
+
+    if (num_workers > 0 || count <= 1)
+    {
+        return I_NumThreads();
+    }
+
+    if (count > MAX_THREADS + 1)
+    {
+        count = MAX_THREADS + 1;
+    }
+
+    pool_mutex = SDL_CreateMutex();
+    work_cond = SDL_CreateCond();
+    done_cond = SDL_CreateCond();
+
+    if (pool_mutex == NULL || work_cond == NULL || done_cond == NULL)
+    {
+        printf("I_InitThreads: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    while (num_workers < count - 1)
+    {
+        snprintf(name, sizeof(name), "worker%i", num_workers);
+        workers[num_workers] = SDL_CreateThread(WorkerThread, name, NULL);
+
+        if (workers[num_workers] == NULL)
+        {
+            printf("I_InitThreads: %s\n", SDL_GetError());
+            break;
+        }
+
+        ++num_workers;
+    }
+
+    I_AtExit(I_ShutdownThreads, false);
+
+    return I_NumThreads();
+}
+
+int I_NumThreads(void)
+{
+    return num_workers + 1;
+}
+
+void I_RunParallel(parallel_func_t func, void *data, int count)
+{
+    int i;
+
+    if (num_workers == 0 || count <= 1)
+    {
+        for (i = 0; i < count; ++i)
+        {
+            func(data, i);
+        }
+
+        return;
+    }
+
+    SDL_LockMutex(pool_mutex);
+
+    work_func = func;
+    work_data = data;
+    work_count = count;
+    work_next = 0;
+    work_pending = count;
+    ++generation;
+
+    SDL_CondBroadcast(work_cond);
+
+    RunJobs();
+
+    while (work_pending > 0)
+    {
+        SDL_CondWait(done_cond, pool_mutex);
+    }
+
+    SDL_UnlockMutex(pool_mutex);
+}
+
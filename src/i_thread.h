@@ -0,0 +1,45 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Worker thread pool.
+//
+
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+#include "doomtype.h"
+
+typedef void (*parallel_func_t)(void *data, int index);
+
+// Number of CPUs available to the process (at least 1).
+
+int I_GetNumCPUs(void);
+
+// Start a pool of worker threads so that up to 'count' jobs can run
+// at once, the calling thread included. Returns the number of threads
+// actually available; 1 if threads are not supported on this platform.
+
+int I_InitThreads(int count);
+
+// Number of threads that I_RunParallel will use.
+
+int I_NumThreads(void);
+
+// Call func(data, i) for every i from 0 to count-1, spread over the
+// pool. The calling thread takes part and the function returns once
+// every job has finished. Not reentrant.
+
+void I_RunParallel(parallel_func_t func, void *data, int count);
+
+#endif
+
@@ -58,6 +58,29 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+//
+// High resolution time in microseconds, for profiling
+//
+
+uint64_t I_GetTimeUS(void)
+{
+    static Uint64 basecounter = 0;
+    Uint64 counter, freq;
+
+    counter = SDL_GetPerformanceCounter();
+    freq = SDL_GetPerformanceFrequency();
+
+    if (basecounter == 0)
+        basecounter = counter;
+
+    counter -= basecounter;
+
+    // Split the division so the multiplication can't overflow.
+
+    return (counter / freq) * 1000000
+         + ((counter % freq) * 1000000) / freq;
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
@@ -26,7 +26,9 @@
 #include "deh_str.h"
 #include "doomtype.h"
 #include "i_input.h"
+#include "i_gif.h"
 #include "i_joystick.h"
+#include "i_perf.h"
 #include "i_system.h"
 #include "i_timer.h"
 #include "i_video.h"
@@ -599,6 +601,8 @@ void I_FinishUpdate (void)
     if (noblit)
         return;
 
+    I_PerfBegin(PERF_BLIT);
+
     UpdateGrab();
 
     // draws little dots on the bottom of the screen
@@ -614,10 +618,13 @@ void I_FinishUpdate (void)
 	    I_VideoBuffer[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0xff;
 	for ( ; i<20*4 ; i+=4)
 	    I_VideoBuffer[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
+
+	V_MarkRect(0, SCREENHEIGHT-1, 20*4, 1);
     }
 
     // Draw disk icon before blit, if necessary.
     V_DrawDiskIcon();
+    I_DrawPerfGraph();
 
     if (palette_to_set)
     {
@@ -663,6 +670,9 @@ void I_FinishUpdate (void)
 
     // Restore background and undo the disk indicator, if it was drawn.
     V_RestoreDiskBackground();
+    I_RestorePerfGraphBackground();
+
+    I_PerfEnd(PERF_BLIT);
 }
 
 
@@ -680,6 +690,7 @@ void I_ReadScreen (pixel_t* scr)
 //
 void I_SetPalette (byte *doompalette)
 {
+    byte gifpalette[256 * 3];
     int i;
 
     for (i=0; i<256; ++i)
@@ -690,11 +701,33 @@ void I_SetPalette (byte *doompalette)
         palette[i].r = gammatable[usegamma][*doompalette++] & ~3;
         palette[i].g = gammatable[usegamma][*doompalette++] & ~3;
         palette[i].b = gammatable[usegamma][*doompalette++] & ~3;
+
+        gifpalette[i * 3] = palette[i].r;
+        gifpalette[i * 3 + 1] = palette[i].g;
+        gifpalette[i * 3 + 2] = palette[i].b;
     }
 
+    // Captured GIFs follow palette changes, such as damage flashes.
+
+    I_SetPaletteGIF(gifpalette);
+
     palette_to_set = true;
 }
 
+// The palette last set, as 256 RGB triplets.
+
+void I_GetPalette(byte *rgb)
+{
+    int i;
+
+    for (i = 0; i < 256; ++i)
+    {
+        rgb[i * 3] = palette[i].r;
+        rgb[i * 3 + 1] = palette[i].g;
+        rgb[i * 3 + 2] = palette[i].b;
+    }
+}
+
 // Given an RGB value, find the closest matching palette index.
 
 int I_GetPaletteIndex(int r, int g, int b)
@@ -1038,6 +1071,22 @@ void I_InitGraphics(void)
     byte *doompal;
     char *env;
 
+#ifdef HEADLESS
+    // Headless builds render into a plain buffer that is never shown.
+    // "initialized" stays false, which keeps all of the SDL window,
+    // event and blitting code above out of the way.
+
+    I_VideoBuffer = Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+    V_RestoreBuffer();
+
+    memset(I_VideoBuffer, 0, SCREENWIDTH * SCREENHEIGHT);
+
+    doompal = W_CacheLumpName(DEH_String("PLAYPAL"), PU_CACHE);
+    I_SetPalette(doompal);
+
+    return;
+#endif
+
     SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
 
     // Pass through the XSCREENSAVER_WINDOW environment variable to 
@@ -1147,4 +1196,6 @@ void I_BindVideoVariables(void)
     M_BindStringVariable("window_position",        &window_position);
     M_BindIntVariable("usegamma",                  &usegamma);
     M_BindIntVariable("png_screenshots",           &png_screenshots);
+    M_BindIntVariable("gif_capture_rate",          &gif_capture_rate);
+    M_BindIntVariable("gif_max_frames",            &gif_max_frames);
 }
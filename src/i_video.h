@@ -44,6 +44,7 @@ void I_ShutdownGraphics(void);
 
 // Takes full 8 bit values.
 void I_SetPalette (byte* palette);
+void I_GetPalette(byte *rgb);
 int I_GetPaletteIndex(int r, int g, int b);
 
 void I_UpdateNoBlit (void);
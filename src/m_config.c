@@ -825,6 +825,20 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(png_screenshots),
 
+    //!
+    // Capture a frame of a GIF recording every this many tics. 1
+    // captures every tic, 35 frames a second.
+    //
+
+    CONFIG_VARIABLE_INT(gif_capture_rate),
+
+    //!
+    // Stop a GIF recording after this many frames. If zero, recordings
+    // only end when stopped.
+    //
+
+    CONFIG_VARIABLE_INT(gif_max_frames),
+
     //!
     // Sound output sample rate, in Hz.  Typical values to use are
     // 11025, 22050, 44100 and 48000.
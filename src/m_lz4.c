@@ -0,0 +1,274 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	LZ4 block compression. The data is a run of sequences, each a
+//	token byte holding the literal count and match length, the
+//	literals, and a 16 bit offset back to the match. The last
+//	sequence has literals only. Data compressed here can be read by
+//	the reference LZ4 library, and the other way around.
+//
+
+#include <string.h>
+
+#include "m_lz4.h"
+
+#define MINMATCH        4
+#define LASTLITERALS    5       // the last bytes are always literals
+#define MFLIMIT         12      // no match starts closer to the end
+#define MAXOFFSET       65535
+
+#define HASH_BITS       12
+
+static unsigned int Read32(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static unsigned int Hash32(unsigned int v)
+{
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// Write a length that did not fit in its four bits of the token.
+
+static byte *WriteLength(byte *op, int len)
+{
+    for (; len >= 255; len -= 255)
+    {
+        *op++ = 255;
+    }
+
+    *op++ = len;
+
+    return op;
+}
+
+static byte *WriteSequence(byte *op, const byte *literals, int numliterals,
+                           int offset, int matchlen)
+{
+    byte *token;
+
+    token = op++;
+
+    if (numliterals >= 15)
+    {
+        *token = 15 << 4;
+        op = WriteLength(op, numliterals - 15);
+    }
+    else
+    {
+        *token = numliterals << 4;
+    }
+
+    memcpy(op, literals, numliterals);
+    op += numliterals;
+
+    if (matchlen > 0)
+    {
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+
+        matchlen -= MINMATCH;
+
+        if (matchlen >= 15)
+        {
+            *token |= 15;
+            op = WriteLength(op, matchlen - 15);
+        }
+        else
+        {
+            *token |= matchlen;
+        }
+    }
+
+    return op;
+}
+
+int M_LZ4Compress(const byte *src, int len, byte *dest, int destlen)
+{
+    int table[1 << HASH_BITS];
+    const byte *ip, *anchor, *ref;
+    const byte *mflimit, *matchlimit;
+    const byte *end = src + len;
+    byte *op = dest;
+    int matchlen;
+    unsigned int h;
+
+    // Positions are stored plus one, so that 0 is an empty slot.
+
+    memset(table, 0, sizeof(table));
+
+    ip = anchor = src;
+    mflimit = end - MFLIMIT;
+    matchlimit = end - LASTLITERALS;
+
+    while (len > MFLIMIT && ip <= mflimit)
+    {
+        h = Hash32(Read32(ip));
+        ref = table[h] ? src + table[h] - 1 : NULL;
+        table[h] = ip - src + 1;
+
+        if (ref == NULL || ip - ref > MAXOFFSET
+         || Read32(ref) != Read32(ip))
+        {
+            ++ip;
+            continue;
+        }
+
+        matchlen = MINMATCH;
+
+        while (ip + matchlen < matchlimit && ref[matchlen] == ip[matchlen])
+        {
+            ++matchlen;
+        }
+
+        // Token, lengths, literals and offset.
+
+        if ((op - dest) + 1 + (ip - anchor) / 255 + 1 + (ip - anchor)
+          + 2 + matchlen / 255 + 1 > destlen)
+        {
+            return 0;
+        }
+
+        op = WriteSequence(op, anchor, ip - anchor, ip - ref, matchlen);
+
+        ip += matchlen;
+        anchor = ip;
+    }
+
+    if ((op - dest) + 1 + (end - anchor) / 255 + 1 + (end - anchor) > destlen)
+    {
+        return 0;
+    }
+
+    op = WriteSequence(op, anchor, end - anchor, 0, 0);
+
+    return op - dest;
+}
+
+// Read a length that did not fit in its four bits of the token.
+// Returns -1 if the data runs out first.
+
+static int ReadLength(const byte **ip, const byte *end)
+{
+    int len = 0;
+    byte b;
+
+    do
+    {
+        if (*ip >= end || len > INT_MAX - 255)
+        {
+            return -1;
+        }
+
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+
+    return len;
+}
+
+int M_LZ4Decompress(const byte *src, int len, byte *dest, int destlen)
+{
+    const byte *ip = src;
+    const byte *end = src + len;
+    byte *op = dest;
+    byte *oend = dest + destlen;
+    const byte *match;
+    int token, n, offset;
+
+    while (ip < end)
+    {
+        token = *ip++;
+
+        // Literals
+
+        n = token >> 4;
+
+        if (n == 15)
+        {
+            int extra = ReadLength(&ip, end);
+
+            if (extra < 0)
+            {
+                return -1;
+            }
+
+            n += extra;
+        }
+
+        if (n > end - ip || n > oend - op)
+        {
+            return -1;
+        }
+
+        memcpy(op, ip, n);
+        ip += n;
+        op += n;
+
+        // The last sequence ends with its literals.
+
+        if (ip == end)
+        {
+            break;
+        }
+
+        // Match
+
+        if (end - ip < 2)
+        {
+            return -1;
+        }
+
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > op - dest)
+        {
+            return -1;
+        }
+
+        n = token & 15;
+
+        if (n == 15)
+        {
+            int extra = ReadLength(&ip, end);
+
+            if (extra < 0)
+            {
+                return -1;
+            }
+
+            n += extra;
+        }
+
+        n += MINMATCH;
+
+        if (n > oend - op)
+        {
+            return -1;
+        }
+
+        // The match may overlap what it is copied to, so a byte at a
+        // time.
+
+        match = op - offset;
+
+        while (n-- > 0)
+        {
+            *op++ = *match++;
+        }
+    }
+
+    return op - dest;
+}
+
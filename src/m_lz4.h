@@ -0,0 +1,38 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	LZ4 block compression.
+//
+
+
+#ifndef __M_LZ4__
+#define __M_LZ4__
+
+#include "doomtype.h"
+
+// Largest compressed size of 'len' bytes.
+
+#define M_LZ4_BOUND(len) ((len) + (len) / 255 + 16)
+
+// Compress 'len' bytes from 'src' into 'dest', which has room for
+// 'destlen'. Returns the compressed size, or 0 if it did not fit.
+
+int M_LZ4Compress(const byte *src, int len, byte *dest, int destlen);
+
+// Decompress 'len' bytes from 'src' into 'dest', which has room for
+// 'destlen'. Returns the decompressed size, or -1 if the data is
+// corrupt or does not fit.
+
+int M_LZ4Decompress(const byte *src, int len, byte *dest, int destlen);
+
+#endif
+
@@ -631,3 +631,29 @@ int M_snprintf(char *buf, size_t buf_len, const char *s, ...)
     va_end(args);
     return result;
 }
+
+uint64_t M_HashBytes(uint64_t hash, const void *data, size_t len)
+{
+    const byte *p = data;
+
+    while (len-- > 0)
+    {
+        hash ^= *p++;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+unsigned int M_HashInt(unsigned int hash, int value)
+{
+    int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
@@ -51,5 +51,14 @@ int M_vsnprintf(char *buf, size_t buf_len, const char *s, va_list args);
 int M_snprintf(char *buf, size_t buf_len, const char *s, ...) PRINTF_ATTR(3, 4);
 char *M_OEMToUTF8(const char *ansi);
 
+// 64-bit FNV-1a, for naming cache files after what they were built from.
+#define M_HASH_INIT 0xcbf29ce484222325ULL
+uint64_t M_HashBytes(uint64_t hash, const void *data, size_t len);
+
+// 32-bit FNV-1a of an int, lowest byte first, for play state checksums
+// that have to come out the same on every platform.
+#define M_HASH32_INIT 2166136261u
+unsigned int M_HashInt(unsigned int hash, int value);
+
 #endif
 
@@ -0,0 +1,41 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Stand-in for <emscripten.h> used by native (non-wasm) builds.
+//	Inline JavaScript is compiled out and the browser main loop is
+//	emulated by main() in i_main.c.
+//
+
+#ifndef __NATIVE_EMSCRIPTEN__
+#define __NATIVE_EMSCRIPTEN__
+
+#ifdef __EMSCRIPTEN__
+#error "native/emscripten.h must not be used for wasm builds"
+#endif
+
+#define EMSCRIPTEN_KEEPALIVE
+
+// There is no JavaScript side to talk to; the inline snippets are
+// dropped and the value-returning variants evaluate to zero.
+
+#define EM_ASM(...)         ((void) 0)
+#define EM_ASM_(...)        ((void) 0)
+#define EM_ASM_INT(...)     (0)
+#define EM_ASM_DOUBLE(...)  (0.0)
+
+typedef void (*em_callback_func)(void);
+
+void emscripten_set_main_loop(em_callback_func func, int fps,
+                              int simulate_infinite_loop);
+void emscripten_cancel_main_loop(void);
+
+#endif
@@ -436,6 +436,8 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
         I_Error("Bad V_DrawTLPatch");
     }
 
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+
     col = 0;
     desttop = dest_screen + y * SCREENWIDTH + x;
 
@@ -487,6 +489,8 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
             return;
     }
 
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+
     col = 0;
     desttop = dest_screen + y * SCREENWIDTH + x;
 
@@ -540,6 +544,8 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
         I_Error("Bad V_DrawAltTLPatch");
     }
 
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+
     col = 0;
     desttop = dest_screen + y * SCREENWIDTH + x;
 
@@ -594,6 +600,8 @@ void V_DrawShadowedPatch(int x, int y, patch_t *patch)
         I_Error("Bad V_DrawShadowedPatch");
     }
 
+    V_MarkRect(x, y, SHORT(patch->width) + 2, SHORT(patch->height) + 2);
+
     col = 0;
     desttop = dest_screen + y * SCREENWIDTH + x;
     desttop2 = dest_screen + (y + 2) * SCREENWIDTH + (x + 2);
@@ -711,6 +719,8 @@ void V_DrawFilledBox(int x, int y, int w, int h, int c)
     pixel_t *buf, *buf1;
     int x1, y1;
 
+    V_MarkRect(x, y, w, h);
+
     buf = I_VideoBuffer + SCREENWIDTH * y + x;
 
     for (y1 = 0; y1 < h; ++y1)
@@ -735,6 +745,8 @@ void V_DrawHorizLine(int x, int y, int w, int c)
     if (x + w > SCREENWIDTH)
 	w = SCREENWIDTH - x;
 
+    V_MarkRect(x, y, w, 1);
+
     buf = I_VideoBuffer + SCREENWIDTH * y + x;
 
     for (x1 = 0; x1 < w; ++x1)
@@ -748,6 +760,8 @@ void V_DrawVertLine(int x, int y, int h, int c)
     pixel_t *buf;
     int y1;
 
+    V_MarkRect(x, y, 1, h);
+
     buf = I_VideoBuffer + SCREENWIDTH * y + x;
 
     for (y1 = 0; y1 < h; ++y1)
@@ -777,6 +791,7 @@ void V_DrawBox(int x, int y, int w, int h, int c)
 void V_DrawRawScreen(pixel_t *raw)
 {
     memcpy(dest_screen, raw, SCREENWIDTH * SCREENHEIGHT * sizeof(*dest_screen));
+    V_MarkRect(0, 0, SCREENWIDTH, SCREENHEIGHT);
 }
 
 //
@@ -26,6 +26,9 @@
 #include "w_file.h"
 
 extern wad_file_class_t stdc_wad_file;
+extern wad_file_class_t stream_wad_file;
+
+extern wad_file_t *W_OpenLZ4File(wad_file_t *file);
 
 #ifdef _WIN32
 extern wad_file_class_t win32_wad_file;
@@ -46,19 +49,29 @@ static wad_file_class_t *wad_file_classes[] =
     &stdc_wad_file,
 };
 
-wad_file_t *W_OpenFile(char *path)
+static wad_file_t *OpenFile(char *path)
 {
     wad_file_t *result;
     int i;
 
+    // WADs given as URLs are streamed, whatever the other options.
+
+    result = stream_wad_file.OpenFile(path);
+
+    if (result != NULL)
+    {
+        return result;
+    }
+
     //!
     // @category obscure
     //
-    // Use the OS's virtual memory subsystem to map WAD files
-    // directly into memory.
+    // Read WAD files into memory instead of using the OS's virtual
+    // memory subsystem to map them, which is the default where it
+    // is available.
     //
 
-    if (!M_CheckParm("-mmap"))
+    if (M_CheckParm("-nommap"))
     {
         return stdc_wad_file.OpenFile(path);
     }
@@ -80,6 +93,22 @@ wad_file_t *W_OpenFile(char *path)
     return result;
 }
 
+wad_file_t *W_OpenFile(char *path)
+{
+    wad_file_t *result;
+
+    result = OpenFile(path);
+
+    // Compressed WADs are read through the file opened above.
+
+    if (result != NULL)
+    {
+        result = W_OpenLZ4File(result);
+    }
+
+    return result;
+}
+
 void W_CloseFile(wad_file_t *wad)
 {
     wad->file_class->CloseFile(wad);
@@ -91,3 +120,10 @@ size_t W_Read(wad_file_t *wad, unsigned int offset,
     return wad->file_class->Read(wad, offset, buffer, buffer_len);
 }
 
+void W_Prefetch(wad_file_t *wad, unsigned int offset, size_t len)
+{
+    if (wad->file_class->Prefetch != NULL)
+    {
+        wad->file_class->Prefetch(wad, offset, len);
+    }
+}
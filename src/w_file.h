@@ -37,6 +37,10 @@ typedef struct
     // provided buffer.  Returns the number of bytes read.
     size_t (*Read)(wad_file_t *file, unsigned int offset,
                    void *buffer, size_t buffer_len);
+
+    // Get ready to read the given range soon. May be NULL, for files
+    // that are as quick to read in any order.
+    void (*Prefetch)(wad_file_t *file, unsigned int offset, size_t len);
 } wad_file_class_t;
 
 struct _wad_file_s
@@ -71,4 +75,8 @@ void W_CloseFile(wad_file_t *wad);
 size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len);
 
+// Hint that the specified range of the file will be read soon.
+
+void W_Prefetch(wad_file_t *wad, unsigned int offset, size_t len);
+
 #endif /* #ifndef __W_FILE__ */
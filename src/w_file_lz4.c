@@ -0,0 +1,363 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WADs with each lump compressed on its own, as written by
+//	tools/wadpack. The file is read through another wad_file_t,
+//	which may be streamed, and made to look like the WAD it was
+//	packed from: a header and directory are made up in memory, and
+//	the lumps follow one after another. A lump is decompressed when
+//	it is read, which W_CacheLumpNum does straight into the zone.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_swap.h"
+#include "i_system.h"
+#include "m_lz4.h"
+#include "w_file.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+typedef struct
+{
+    unsigned int position;      // in the unpacked WAD
+    unsigned int size;
+    unsigned int filepos;       // in the packed one
+    unsigned int csize;
+} lz4lump_t;
+
+typedef struct
+{
+    wad_file_t wad;
+    wad_file_t *file;
+
+    // The made up header and directory, which the lumps follow.
+    byte *header;
+    unsigned int headerlen;
+
+    lz4lump_t *lumps;
+    int numlumps;
+
+    // Space to read compressed lumps into.
+    byte *packed;
+    unsigned int packedlen;
+
+    // The last lump unpacked for a read of only part of it.
+    int partlump;
+    byte *partdata;
+} lz4_wad_file_t;
+
+extern wad_file_class_t lz4_wad_file;
+
+static void ReadPacked(lz4_wad_file_t *lz4, unsigned int offset,
+                       void *buffer, size_t len)
+{
+    if (W_Read(lz4->file, offset, buffer, len) < len)
+    {
+        I_Error("W_LZ4: failed to read %u bytes at %u of %s",
+                (unsigned int) len, offset, lz4->wad.path);
+    }
+}
+
+// Unpack a whole lump into 'dest'.
+
+static void UnpackLump(lz4_wad_file_t *lz4, int lumpnum, byte *dest)
+{
+    lz4lump_t *lump = &lz4->lumps[lumpnum];
+
+    if (lump->csize == lump->size)
+    {
+        ReadPacked(lz4, lump->filepos, dest, lump->size);
+        return;
+    }
+
+    if (lump->csize > lz4->packedlen)
+    {
+        lz4->packedlen = lump->csize;
+        lz4->packed = I_Realloc(lz4->packed, lz4->packedlen);
+    }
+
+    ReadPacked(lz4, lump->filepos, lz4->packed, lump->csize);
+
+    if (M_LZ4Decompress(lz4->packed, lump->csize, dest, lump->size)
+        != lump->size)
+    {
+        I_Error("W_LZ4: lump %d of %s is corrupt", lumpnum, lz4->wad.path);
+    }
+}
+
+wad_file_t *W_OpenLZ4File(wad_file_t *file)
+{
+    lz4wadinfo_t header;
+    lz4filelump_t *fileinfo;
+    wadinfo_t *wadinfo;
+    filelump_t *filelump;
+    lz4_wad_file_t *result;
+    unsigned int position;
+    size_t length;
+    int i;
+
+    if (W_Read(file, 0, &header, sizeof(header)) < sizeof(header)
+     || memcmp(header.magic, LZ4WAD_MAGIC, sizeof(header.magic)))
+    {
+        return file;
+    }
+
+    header.numlumps = LONG(header.numlumps);
+    header.infotableofs = LONG(header.infotableofs);
+
+    // The packed directory has to be within the file, and the made up
+    // one small enough for headerlen.
+
+    if (header.numlumps < 0
+     || header.numlumps > (INT_MAX - sizeof(wadinfo_t)) / sizeof(filelump_t)
+     || (unsigned int) header.infotableofs > file->length
+     || header.numlumps > (file->length - (unsigned int) header.infotableofs)
+                          / sizeof(lz4filelump_t))
+    {
+        I_Error("W_LZ4: %s has a bad directory", file->path);
+    }
+
+    result = Z_Malloc(sizeof(lz4_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &lz4_wad_file;
+    result->wad.mapped = NULL;
+    result->wad.path = file->path;
+    result->file = file;
+    result->numlumps = header.numlumps;
+    result->lumps = calloc(header.numlumps + 1, sizeof(*result->lumps));
+    result->packed = NULL;
+    result->packedlen = 0;
+    result->partlump = -1;
+    result->partdata = NULL;
+
+    length = (size_t) header.numlumps * sizeof(lz4filelump_t);
+    fileinfo = malloc(length);
+    ReadPacked(result, header.infotableofs, fileinfo, length);
+
+    // Make up the header and directory of the unpacked WAD.
+
+    result->headerlen = sizeof(wadinfo_t)
+                      + header.numlumps * sizeof(filelump_t);
+    result->header = malloc(result->headerlen);
+
+    wadinfo = (wadinfo_t *) result->header;
+    memcpy(wadinfo->identification, header.identification,
+           sizeof(wadinfo->identification));
+    wadinfo->numlumps = LONG(header.numlumps);
+    wadinfo->infotableofs = LONG(sizeof(wadinfo_t));
+
+    filelump = (filelump_t *) (wadinfo + 1);
+    position = result->headerlen;
+
+    for (i = 0; i < header.numlumps; ++i)
+    {
+        lz4lump_t *lump = &result->lumps[i];
+
+        lump->position = position;
+        lump->size = LONG(fileinfo[i].size);
+        lump->filepos = LONG(fileinfo[i].filepos);
+        lump->csize = LONG(fileinfo[i].csize);
+
+        if (lump->size > UINT_MAX - position)
+        {
+            I_Error("W_LZ4: %s is too large", file->path);
+        }
+
+        filelump[i].filepos = LONG(lump->position);
+        filelump[i].size = LONG(lump->size);
+        memcpy(filelump[i].name, fileinfo[i].name, sizeof(filelump[i].name));
+
+        position += lump->size;
+    }
+
+    // A last empty lump marks the end, for FindLump.
+
+    result->lumps[header.numlumps].position = position;
+    result->wad.length = position;
+
+    free(fileinfo);
+
+    return &result->wad;
+}
+
+static void W_LZ4_CloseFile(wad_file_t *wad)
+{
+    lz4_wad_file_t *lz4;
+
+    lz4 = (lz4_wad_file_t *) wad;
+
+    W_CloseFile(lz4->file);
+    free(lz4->header);
+    free(lz4->lumps);
+    free(lz4->packed);
+    free(lz4->partdata);
+    Z_Free(lz4);
+}
+
+// The last lump starting at or before 'offset', which must be past
+// the header.
+
+static int FindLump(lz4_wad_file_t *lz4, unsigned int offset)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = lz4->numlumps;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi + 1) / 2;
+
+        if (lz4->lumps[mid].position <= offset)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    return lo;
+}
+
+size_t W_LZ4_Read(wad_file_t *wad, unsigned int offset,
+                  void *buffer, size_t buffer_len)
+{
+    lz4_wad_file_t *lz4;
+    lz4lump_t *lump;
+    byte *dest;
+    size_t left, n;
+    unsigned int skip;
+    int i;
+
+    lz4 = (lz4_wad_file_t *) wad;
+
+    if (offset >= lz4->wad.length)
+    {
+        return 0;
+    }
+
+    if (buffer_len > lz4->wad.length - offset)
+    {
+        buffer_len = lz4->wad.length - offset;
+    }
+
+    dest = buffer;
+    left = buffer_len;
+
+    // The made up header and directory.
+
+    if (offset < lz4->headerlen)
+    {
+        n = lz4->headerlen - offset;
+
+        if (n > left)
+        {
+            n = left;
+        }
+
+        memcpy(dest, lz4->header + offset, n);
+
+        dest += n;
+        offset += n;
+        left -= n;
+    }
+
+    // The lumps. Those read whole, as W_ReadLump does, are unpacked
+    // straight into the buffer.
+
+    for (i = left > 0 ? FindLump(lz4, offset) : 0; left > 0; ++i)
+    {
+        lump = &lz4->lumps[i];
+        skip = offset - lump->position;
+
+        if (skip >= lump->size)
+        {
+            continue;
+        }
+
+        n = lump->size - skip;
+
+        if (n > left)
+        {
+            n = left;
+        }
+
+        if (n == lump->size)
+        {
+            UnpackLump(lz4, i, dest);
+        }
+        else
+        {
+            if (lz4->partlump != i)
+            {
+                lz4->partdata = I_Realloc(lz4->partdata, lump->size);
+                lz4->partlump = i;
+                UnpackLump(lz4, i, lz4->partdata);
+            }
+
+            memcpy(dest, lz4->partdata + skip, n);
+        }
+
+        dest += n;
+        offset += n;
+        left -= n;
+    }
+
+    return buffer_len;
+}
+
+// Prefetching the packed lumps that a range covers is all that the
+// file underneath can do.
+
+static void W_LZ4_Prefetch(wad_file_t *wad, unsigned int offset, size_t len)
+{
+    lz4_wad_file_t *lz4;
+    unsigned int start, end;
+    int first, last;
+
+    lz4 = (lz4_wad_file_t *) wad;
+
+    if (offset + len <= lz4->headerlen || offset >= lz4->wad.length)
+    {
+        return;
+    }
+
+    if (offset < lz4->headerlen)
+    {
+        offset = lz4->headerlen;
+    }
+
+    first = FindLump(lz4, offset);
+    last = FindLump(lz4, offset + len - 1);
+
+    start = lz4->lumps[first].filepos;
+    end = lz4->lumps[last].filepos + lz4->lumps[last].csize;
+
+    if (end > start)
+    {
+        W_Prefetch(lz4->file, start, end - start);
+    }
+}
+
+// Opened by W_OpenFile around another file, not by path.
+
+wad_file_class_t lz4_wad_file =
+{
+    NULL,
+    W_LZ4_CloseFile,
+    W_LZ4_Read,
+    W_LZ4_Prefetch,
+};
+
@@ -44,15 +44,11 @@ static void MapFile(posix_wad_file_t *wad, char *filename)
     int protection;
     int flags;
 
-    // Mapped area can be read and written to.  Ideally
-    // this should be read-only, as none of the Doom code should 
-    // change the WAD files after being read.  However, there may
-    // be code lurking in the source that does.
+    // Mapped area is read-only, so that lumps are shared with the
+    // page cache. Lumps returned by W_CacheLumpNum must not be
+    // changed.
 
-    protection = PROT_READ|PROT_WRITE;
-
-    // Writes to the mapped area result in private changes that are
-    // *not* written to disk.
+    protection = PROT_READ;
 
     flags = MAP_PRIVATE;
 
@@ -60,13 +56,14 @@ static void MapFile(posix_wad_file_t *wad, char *filename)
                   protection, flags, 
                   wad->handle, 0);
 
-    wad->wad.mapped = result;
-
-    if (result == NULL)
+    if (result == MAP_FAILED)
     {
         fprintf(stderr, "W_POSIX_OpenFile: Unable to mmap() %s - %s\n",
                         filename, strerror(errno));
+        result = NULL;
     }
+
+    wad->wad.mapped = result;
 }
 
 unsigned int GetFileLength(int handle)
@@ -109,6 +106,11 @@ static void W_POSIX_CloseFile(wad_file_t *wad)
 
     // If mapped, unmap it.
 
+    if (posix_wad->wad.mapped != NULL)
+    {
+        munmap(posix_wad->wad.mapped, posix_wad->wad.length);
+    }
+
     // Close the file
   
     close(posix_wad->handle);
@@ -157,12 +159,36 @@ size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
     return bytes_read;
 }
 
+// Ask the OS to start paging in a range that will be read soon.
+
+static void W_POSIX_Prefetch(wad_file_t *wad, unsigned int offset,
+                             size_t len)
+{
+    uintptr_t start, end, pagemask;
+
+    if (wad->mapped == NULL || offset >= wad->length)
+    {
+        return;
+    }
+
+    if (len > wad->length - offset)
+    {
+        len = wad->length - offset;
+    }
+
+    pagemask = sysconf(_SC_PAGESIZE) - 1;
+    start = (uintptr_t) (wad->mapped + offset) & ~pagemask;
+    end = (uintptr_t) (wad->mapped + offset + len);
+
+    madvise((void *) start, end - start, MADV_WILLNEED);
+}
 
 wad_file_class_t posix_wad_file = 
 {
     W_POSIX_OpenFile,
     W_POSIX_CloseFile,
     W_POSIX_Read,
+    W_POSIX_Prefetch,
 };
 
 
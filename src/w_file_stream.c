@@ -0,0 +1,376 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD files streamed over HTTP. A WAD given as an http:// or
+//	https:// URL is not downloaded up front; the parts of it that
+//	are read are fetched with range requests, in chunks that are
+//	kept once fetched.
+//
+//	In the browser the requests are synchronous XMLHttpRequests, as
+//	the game loop cannot wait for a promise. Native builds have no
+//	HTTP client and serve the ranges from a local file of the same
+//	name instead, for testing.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <emscripten.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+#define CHUNK_SHIFT 16
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+
+typedef struct
+{
+    wad_file_t wad;
+
+    // Chunks of CHUNK_SIZE bytes, NULL until fetched.
+    byte **chunks;
+    unsigned int numchunks;
+
+#ifndef __EMSCRIPTEN__
+    FILE *fstream;
+#endif
+} stream_wad_file_t;
+
+extern wad_file_class_t stream_wad_file;
+
+static boolean IsStreamPath(const char *path)
+{
+    return !strncasecmp(path, "http://", 7)
+        || !strncasecmp(path, "https://", 8);
+}
+
+#ifdef __EMSCRIPTEN__
+
+// Length of the file behind the URL, or -1 if it cannot be found out.
+
+static int RemoteLength(stream_wad_file_t *stream)
+{
+    return EM_ASM_INT({
+        try {
+            var xhr = new XMLHttpRequest();
+            xhr.open("HEAD", UTF8ToString($0), false);
+            xhr.send(null);
+            if (xhr.status < 200 || xhr.status >= 300)
+                return -1;
+            var length = xhr.getResponseHeader("Content-Length");
+            return length === null ? -1 : Number(length);
+        } catch (err) {
+            return -1;
+        }
+    }, stream->wad.path);
+}
+
+// Fetch 'len' bytes at 'offset' into 'dest'. Returns the number of
+// bytes fetched, or -1 on error.
+
+static int RemoteRead(stream_wad_file_t *stream, unsigned int offset,
+                      unsigned int len, byte *dest)
+{
+    return EM_ASM_INT({
+        try {
+            var xhr = new XMLHttpRequest();
+            xhr.open("GET", UTF8ToString($0), false);
+            xhr.setRequestHeader("Range", "bytes=" + $1 + "-" + ($1 + $2 - 1));
+            xhr.overrideMimeType("text/plain; charset=x-user-defined");
+            xhr.send(null);
+            if (xhr.status < 200 || xhr.status >= 300)
+                return -1;
+            // A server that ignores the range sends the whole file.
+            var data = xhr.responseText;
+            var skip = xhr.status == 206 ? 0 : $1;
+            var n = Math.min(data.length - skip, $2);
+            for (var i = 0; i < n; ++i)
+                HEAPU8[$3 + i] = data.charCodeAt(skip + i) & 0xff;
+            return n;
+        } catch (err) {
+            return -1;
+        }
+    }, stream->wad.path, offset, len, dest);
+}
+
+static boolean RemoteOpen(stream_wad_file_t *stream)
+{
+    int length;
+
+    length = RemoteLength(stream);
+
+    if (length < 0)
+    {
+        return false;
+    }
+
+    stream->wad.length = length;
+
+    return true;
+}
+
+static void RemoteClose(stream_wad_file_t *stream)
+{
+}
+
+#else
+
+// The stand-in server: the file of the same name in the directory
+// given with -streamroot, or the current directory.
+
+static boolean RemoteOpen(stream_wad_file_t *stream)
+{
+    const char *root;
+    char *filename;
+    int p;
+
+    //!
+    // @category obscure
+    // @arg <directory>
+    //
+    // Serve WADs given as URLs from this directory, as a stand-in
+    // for the web server in builds that cannot fetch them.
+    //
+
+    p = M_CheckParmWithArgs("-streamroot", 1);
+    root = p > 0 ? myargv[p + 1] : ".";
+
+    filename = M_StringJoin(root, DIR_SEPARATOR_S,
+                            M_BaseName(stream->wad.path), NULL);
+    stream->fstream = fopen(filename, "rb");
+    free(filename);
+
+    if (stream->fstream == NULL)
+    {
+        return false;
+    }
+
+    stream->wad.length = M_FileLength(stream->fstream);
+
+    return true;
+}
+
+static int RemoteRead(stream_wad_file_t *stream, unsigned int offset,
+                      unsigned int len, byte *dest)
+{
+    if (fseek(stream->fstream, offset, SEEK_SET) != 0)
+    {
+        return -1;
+    }
+
+    return fread(dest, 1, len, stream->fstream);
+}
+
+static void RemoteClose(stream_wad_file_t *stream)
+{
+    fclose(stream->fstream);
+}
+
+#endif
+
+static wad_file_t *W_Stream_OpenFile(char *path)
+{
+    stream_wad_file_t *result;
+
+    if (!IsStreamPath(path))
+    {
+        return NULL;
+    }
+
+    result = Z_Malloc(sizeof(stream_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &stream_wad_file;
+    result->wad.mapped = NULL;
+    result->wad.path = M_StringDuplicate(path);
+
+    if (!RemoteOpen(result))
+    {
+        free((char *) result->wad.path);
+        Z_Free(result);
+        return NULL;
+    }
+
+    result->numchunks = (result->wad.length + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    result->chunks = calloc(result->numchunks, sizeof(*result->chunks));
+
+    return &result->wad;
+}
+
+static void W_Stream_CloseFile(wad_file_t *wad)
+{
+    stream_wad_file_t *stream;
+    unsigned int i;
+
+    stream = (stream_wad_file_t *) wad;
+
+    RemoteClose(stream);
+
+    for (i = 0; i < stream->numchunks; ++i)
+    {
+        free(stream->chunks[i]);
+    }
+
+    free(stream->chunks);
+    free((char *) stream->wad.path);
+    Z_Free(stream);
+}
+
+// Fetch every chunk from 'first' to 'last' that has not been fetched
+// yet, with one request for each run of missing chunks.
+
+static void FetchChunks(stream_wad_file_t *stream,
+                        unsigned int first, unsigned int last)
+{
+    unsigned int start, end, offset, len, i;
+    byte *buffer;
+    int result;
+
+    for (start = first; start <= last; start = end)
+    {
+        if (stream->chunks[start] != NULL)
+        {
+            end = start + 1;
+            continue;
+        }
+
+        for (end = start + 1; end <= last && stream->chunks[end] == NULL;
+             ++end);
+
+        offset = start << CHUNK_SHIFT;
+        len = (end << CHUNK_SHIFT) - offset;
+
+        if (offset + len > stream->wad.length)
+        {
+            len = stream->wad.length - offset;
+        }
+
+        buffer = malloc(len);
+        result = RemoteRead(stream, offset, len, buffer);
+
+        if (result < 0 || (unsigned int) result < len)
+        {
+            I_Error("W_Stream: failed to fetch %u bytes at %u of %s",
+                    len, offset, stream->wad.path);
+        }
+
+        for (i = start; i < end; ++i)
+        {
+            unsigned int chunklen;
+
+            chunklen = len - ((i - start) << CHUNK_SHIFT);
+
+            if (chunklen > CHUNK_SIZE)
+            {
+                chunklen = CHUNK_SIZE;
+            }
+
+            stream->chunks[i] = malloc(chunklen);
+            memcpy(stream->chunks[i], buffer + ((i - start) << CHUNK_SHIFT),
+                   chunklen);
+        }
+
+        free(buffer);
+    }
+}
+
+// Clip a range to the file; returns false if nothing is left of it.
+
+static boolean ClipRange(stream_wad_file_t *stream, unsigned int offset,
+                         size_t *len)
+{
+    if (offset >= stream->wad.length || *len == 0)
+    {
+        return false;
+    }
+
+    if (*len > stream->wad.length - offset)
+    {
+        *len = stream->wad.length - offset;
+    }
+
+    return true;
+}
+
+size_t W_Stream_Read(wad_file_t *wad, unsigned int offset,
+                     void *buffer, size_t buffer_len)
+{
+    stream_wad_file_t *stream;
+    unsigned int chunk, skip, n;
+    byte *dest;
+    size_t left;
+
+    stream = (stream_wad_file_t *) wad;
+
+    if (!ClipRange(stream, offset, &buffer_len))
+    {
+        return 0;
+    }
+
+    FetchChunks(stream, offset >> CHUNK_SHIFT,
+                (offset + buffer_len - 1) >> CHUNK_SHIFT);
+
+    dest = buffer;
+    left = buffer_len;
+
+    while (left > 0)
+    {
+        chunk = offset >> CHUNK_SHIFT;
+        skip = offset & (CHUNK_SIZE - 1);
+        n = CHUNK_SIZE - skip;
+
+        if (n > left)
+        {
+            n = left;
+        }
+
+        memcpy(dest, stream->chunks[chunk] + skip, n);
+
+        dest += n;
+        offset += n;
+        left -= n;
+    }
+
+    return buffer_len;
+}
+
+// Fetch a range that is about to be read, along with anything else
+// missing between its ends, so that a list of lumps sorted by
+// position costs only a few requests.
+
+static void W_Stream_Prefetch(wad_file_t *wad, unsigned int offset,
+                              size_t len)
+{
+    stream_wad_file_t *stream;
+
+    stream = (stream_wad_file_t *) wad;
+
+    if (!ClipRange(stream, offset, &len))
+    {
+        return;
+    }
+
+    FetchChunks(stream, offset >> CHUNK_SHIFT,
+                (offset + len - 1) >> CHUNK_SHIFT);
+}
+
+wad_file_class_t stream_wad_file =
+{
+    W_Stream_OpenFile,
+    W_Stream_CloseFile,
+    W_Stream_Read,
+    W_Stream_Prefetch,
+};
+
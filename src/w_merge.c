@@ -709,6 +709,8 @@ void W_NWTDashMerge(char *filename)
             // nwt -merge does.
 
             M_StringCopy(iwad_sprites.lumps[i]->name, "", 8);
+            iwad_sprites.lumps[i]->namekey =
+                W_LumpNameKey(iwad_sprites.lumps[i]->name);
         }
     }
 
@@ -35,22 +35,6 @@
 
 #include "w_wad.h"
 
-typedef PACKED_STRUCT (
-{
-    // Should be "IWAD" or "PWAD".
-    char		identification[4];
-    int			numlumps;
-    int			infotableofs;
-}) wadinfo_t;
-
-
-typedef PACKED_STRUCT (
-{
-    int			filepos;
-    int			size;
-    char		name[8];
-}) filelump_t;
-
 //
 // GLOBALS
 //
@@ -59,8 +43,18 @@ typedef PACKED_STRUCT (
 lumpinfo_t **lumpinfo;
 unsigned int numlumps = 0;
 
-// Hash table for fast lookups
-static lumpindex_t *lumphash;
+// Hash table for fast lookups. Open addressing, with the name keys
+// stored in the table so that a probe touches only one cache line.
+// The size is a power of two at least twice numlumps.
+
+typedef struct
+{
+    uint64_t namekey;
+    lumpindex_t lump;           // -1 for an empty slot
+} lumphashslot_t;
+
+static lumphashslot_t *lumphash;
+static unsigned int lumphashbits;
 
 // Variables for the reload hack: filename of the PWAD to reload, and the
 // lumps from WADs before the reload file, so we can resent numlumps and
@@ -87,6 +81,28 @@ unsigned int W_LumpNameHash(const char *s)
     return result;
 }
 
+// Lump names packed into an integer, upper case, one byte per
+// character, so that two names can be compared in one go. Like
+// strncasecmp(a, b, 8), nothing after a terminating NUL counts.
+uint64_t W_LumpNameKey(const char *s)
+{
+    uint64_t result = 0;
+    unsigned int i;
+
+    for (i=0; i < 8 && s[i] != '\0'; ++i)
+    {
+        result |= (uint64_t) (byte) toupper(s[i]) << (i * 8);
+    }
+
+    return result;
+}
+
+static unsigned int LumpHashSlot(uint64_t namekey)
+{
+    return (unsigned int) ((namekey * 0x9e3779b97f4a7c15ULL)
+                           >> (64 - lumphashbits));
+}
+
 //
 // LUMP BASED ROUTINES.
 //
@@ -217,6 +233,7 @@ wad_file_t *W_AddFile (char *filename)
         lump_p->size = LONG(filerover->size);
         lump_p->cache = NULL;
         strncpy(lump_p->name, filerover->name, 8);
+        lump_p->namekey = W_LumpNameKey(lump_p->name);
         lumpinfo[i] = lump_p;
 
         ++filerover;
@@ -261,22 +278,26 @@ int W_NumLumps (void)
 lumpindex_t W_CheckNumForName(const char *name)
 {
     lumpindex_t i;
+    uint64_t namekey;
+
+    namekey = W_LumpNameKey(name);
 
     // Do we have a hash table yet?
 
     if (lumphash != NULL)
     {
-        int hash;
+        unsigned int mask, slot;
 
         // We do! Excellent.
 
-        hash = W_LumpNameHash(name) % numlumps;
+        mask = (1U << lumphashbits) - 1;
 
-        for (i = lumphash[hash]; i != -1; i = lumpinfo[i]->next)
+        for (slot = LumpHashSlot(namekey); lumphash[slot].lump != -1;
+             slot = (slot + 1) & mask)
         {
-            if (!strncasecmp(lumpinfo[i]->name, name, 8))
+            if (lumphash[slot].namekey == namekey)
             {
-                return i;
+                return lumphash[slot].lump;
             }
         }
     }
@@ -288,7 +309,7 @@ lumpindex_t W_CheckNumForName(const char *name)
 
         for (i = numlumps - 1; i >= 0; --i)
         {
-            if (!strncasecmp(lumpinfo[i]->name, name, 8))
+            if (lumpinfo[i]->namekey == namekey)
             {
                 return i;
             }
@@ -300,7 +321,67 @@ lumpindex_t W_CheckNumForName(const char *name)
     return -1;
 }
 
+//
+// W_CheckNumsForNames
+// Looks up 'count' names of 8 characters each, as in a PNAMES lump,
+// the same as W_CheckNumForName would. The table slots are worked
+// out for a batch of names before any is probed, so that the loads
+// of the slots can overlap.
+//
 
+#define LOOKUPBATCH 16
+
+void W_CheckNumsForNames(const char *names, int count, lumpindex_t *lumps)
+{
+    uint64_t namekeys[LOOKUPBATCH];
+    unsigned int slots[LOOKUPBATCH];
+    unsigned int mask, slot;
+    int i, j, n;
+
+    if (lumphash == NULL)
+    {
+        for (i = 0; i < count; ++i)
+        {
+            char name[9];
+
+            M_StringCopy(name, names + i * 8, sizeof(name));
+            lumps[i] = W_CheckNumForName(name);
+        }
+
+        return;
+    }
+
+    mask = (1U << lumphashbits) - 1;
+
+    for (i = 0; i < count; i += n)
+    {
+        n = count - i < LOOKUPBATCH ? count - i : LOOKUPBATCH;
+
+        for (j = 0; j < n; ++j)
+        {
+            namekeys[j] = W_LumpNameKey(names + (i + j) * 8);
+            slots[j] = LumpHashSlot(namekeys[j]);
+#if defined(__GNUC__)
+            __builtin_prefetch(&lumphash[slots[j]]);
+#endif
+        }
+
+        for (j = 0; j < n; ++j)
+        {
+            lumps[i + j] = -1;
+
+            for (slot = slots[j]; lumphash[slot].lump != -1;
+                 slot = (slot + 1) & mask)
+            {
+                if (lumphash[slot].namekey == namekeys[j])
+                {
+                    lumps[i + j] = lumphash[slot].lump;
+                    break;
+                }
+            }
+        }
+    }
+}
 
 
 //
@@ -324,10 +405,13 @@ lumpindex_t W_GetNumForName(const char *name)
 lumpindex_t W_CheckNumForNameFromTo(const char *name, int from, int to)
 {
     lumpindex_t i;
+    uint64_t namekey;
+
+    namekey = W_LumpNameKey(name);
 
     for (i = from; i >= to; i--)
     {
-        if (!strncasecmp(lumpinfo[i]->name, name, 8))
+        if (lumpinfo[i]->namekey == namekey)
         {
             return i;
         }
@@ -483,6 +567,82 @@ void W_ReleaseLumpName(const char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+//
+// W_PrefetchLumps
+// Tell the files that the given lumps are about to be read, so that
+// files that are slow to seek, such as streamed ones, can get them in
+// a few large reads, and mapped ones can be paged in ahead of time.
+// Lumps close together in the same file are prefetched as one range,
+// gaps included.
+//
+
+#define PREFETCH_GAP 65536
+
+static int ComparePrefetchLumps(const void *a, const void *b)
+{
+    const lumpinfo_t *l1 = *(const lumpinfo_t **) a;
+    const lumpinfo_t *l2 = *(const lumpinfo_t **) b;
+
+    if (l1->wad_file != l2->wad_file)
+    {
+        return l1->wad_file < l2->wad_file ? -1 : 1;
+    }
+
+    return l1->position - l2->position;
+}
+
+void W_PrefetchLumps(const lumpindex_t *lumps, int count)
+{
+    lumpinfo_t **sorted;
+    lumpinfo_t *lump;
+    wad_file_t *wad_file;
+    unsigned int start, end;
+    int i, n;
+
+    sorted = malloc(count * sizeof(*sorted));
+    n = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        if ((unsigned) lumps[i] >= numlumps)
+        {
+            continue;
+        }
+
+        lump = lumpinfo[lumps[i]];
+
+        // Nothing to do for lumps that are cached already.
+
+        if (lump->wad_file->file_class->Prefetch != NULL
+         && lump->cache == NULL && lump->size > 0)
+        {
+            sorted[n++] = lump;
+        }
+    }
+
+    qsort(sorted, n, sizeof(*sorted), ComparePrefetchLumps);
+
+    for (i = 0; i < n; )
+    {
+        wad_file = sorted[i]->wad_file;
+        start = sorted[i]->position;
+        end = start + sorted[i]->size;
+
+        for (++i; i < n && sorted[i]->wad_file == wad_file
+                  && sorted[i]->position <= end + PREFETCH_GAP; ++i)
+        {
+            if (sorted[i]->position + sorted[i]->size > end)
+            {
+                end = sorted[i]->position + sorted[i]->size;
+            }
+        }
+
+        W_Prefetch(wad_file, start, end - start);
+    }
+
+    free(sorted);
+}
+
 // Generate a hash table for fast lookups
 
 void W_GenerateHashTable(void)
@@ -493,28 +653,50 @@ void W_GenerateHashTable(void)
     if (lumphash != NULL)
     {
         Z_Free(lumphash);
+        lumphash = NULL;
     }
 
     // Generate hash table
     if (numlumps > 0)
     {
-        lumphash = Z_Malloc(sizeof(lumpindex_t) * numlumps, PU_STATIC, NULL);
+        unsigned int size, mask;
 
-        for (i = 0; i < numlumps; ++i)
+        // At most half full, so that probe sequences stay short.
+
+        for (lumphashbits = 1; (1U << lumphashbits) < numlumps * 2;
+             ++lumphashbits);
+
+        size = 1U << lumphashbits;
+        mask = size - 1;
+
+        lumphash = Z_Malloc(sizeof(*lumphash) * size, PU_STATIC, NULL);
+
+        for (i = 0; i < size; ++i)
         {
-            lumphash[i] = -1;
+            lumphash[i].lump = -1;
         }
 
+        // Later lumps replace earlier ones with the same name, so that
+        // patch lump files take precedence.
+
         for (i = 0; i < numlumps; ++i)
         {
-            unsigned int hash;
+            uint64_t namekey;
+            unsigned int slot;
 
-            hash = W_LumpNameHash(lumpinfo[i]->name) % numlumps;
+            namekey = lumpinfo[i]->namekey;
 
-            // Hook into the hash table
+            for (slot = LumpHashSlot(namekey); lumphash[slot].lump != -1;
+                 slot = (slot + 1) & mask)
+            {
+                if (lumphash[slot].namekey == namekey)
+                {
+                    break;
+                }
+            }
 
-            lumpinfo[i]->next = lumphash[hash];
-            lumphash[hash] = i;
+            lumphash[slot].namekey = namekey;
+            lumphash[slot].lump = i;
         }
     }
 
@@ -30,6 +30,48 @@
 // TYPES
 //
 
+//
+// On-disk WAD header and directory.
+//
+
+typedef PACKED_STRUCT (
+{
+    // Should be "IWAD" or "PWAD".
+    char		identification[4];
+    int			numlumps;
+    int			infotableofs;
+}) wadinfo_t;
+
+
+typedef PACKED_STRUCT (
+{
+    int			filepos;
+    int			size;
+    char		name[8];
+}) filelump_t;
+
+// A WAD with each lump compressed on its own (see w_file_lz4.c),
+// as written by tools/wadpack.
+
+#define LZ4WAD_MAGIC "LZ4W"
+
+typedef PACKED_STRUCT (
+{
+    char		magic[4];
+    // Of the original WAD.
+    char		identification[4];
+    int			numlumps;
+    int			infotableofs;
+}) lz4wadinfo_t;
+
+typedef PACKED_STRUCT (
+{
+    int			filepos;
+    int			csize;		// same as size if stored as is
+    int			size;
+    char		name[8];
+}) lz4filelump_t;
+
 //
 // WADFILE I/O related stuff.
 //
@@ -45,8 +87,8 @@ struct lumpinfo_s
     int		size;
     void       *cache;
 
-    // Used for hash table lookups
-    lumpindex_t next;
+    // The name in upper case, packed by W_LumpNameKey
+    uint64_t	namekey;
 };
 
 
@@ -60,6 +102,7 @@ lumpindex_t W_CheckNumForName(const char *name);
 lumpindex_t W_GetNumForName(const char *name);
 const lumpinfo_t* W_GetLumpInfoByNum(int lump);
 lumpindex_t W_CheckNumForNameFromTo(const char *name, int from, int to);
+void W_CheckNumsForNames(const char *names, int count, lumpindex_t *lumps);
 
 int W_LumpLength(lumpindex_t lump);
 void W_ReadLump(lumpindex_t lump, void *dest);
@@ -67,9 +110,12 @@ void W_ReadLump(lumpindex_t lump, void *dest);
 void *W_CacheLumpNum(lumpindex_t lump, int tag);
 void *W_CacheLumpName(const char *name, int tag);
 
+void W_PrefetchLumps(const lumpindex_t *lumps, int count);
+
 void W_GenerateHashTable(void);
 
 extern unsigned int W_LumpNameHash(const char *s);
+extern uint64_t W_LumpNameKey(const char *s);
 
 void W_ReleaseLumpNum(lumpindex_t lump);
 void W_ReleaseLumpName(const char *name);
@@ -20,9 +20,12 @@
 //
 
 
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <emscripten.h>
+
 #include "z_zone.h"
 #include "i_system.h"
 #include "doomtype.h"
@@ -31,19 +34,112 @@
 
 typedef struct memblock_s memblock_t;
 
+// Where a block's memory came from.
+
+typedef enum
+{
+    ZK_MALLOC,          // malloc(), linked into allocated_blocks[]
+    ZK_SMALL,           // carved out of an arena chunk
+    ZK_LARGE,           // malloc(), linked into its arena's large list
+} zonekind_t;
+
 struct memblock_s
 {
     int id; // = ZONEID
     int tag;
     int size;
+    zonekind_t kind;
+    int site; // index into zone_sites[]
     void **user;
     memblock_t *prev;
     memblock_t *next;
 };
 
-// Linked list of allocated blocks for each tag type
+// Linked list of allocated blocks for each tag type; the tail is
+// the block that has been in the list longest.
  
 static memblock_t *allocated_blocks[PU_NUM_TAGS];
+static memblock_t *allocated_tails[PU_NUM_TAGS];
+
+// Level arenas.
+//
+// Ownerless PU_LEVEL and PU_LEVSPEC blocks (mobjs, thinkers, sector
+// nodes, level geometry) do not go through the lists above. Small
+// ones are cut from large chunks and recycled through free lists,
+// one per size class; large ones are malloc()ed and kept on a list
+// of their own. When the level is freed, the chunks are kept for
+// the next one and only the large blocks need to be released.
+
+#define ARENA_CHUNK_SIZE    (256 * 1024)
+#define ARENA_GRANULE       16
+#define ARENA_MAX_SMALL     1024
+#define ARENA_NUM_CLASSES   (ARENA_MAX_SMALL / ARENA_GRANULE)
+
+typedef struct arenachunk_s arenachunk_t;
+
+struct arenachunk_s
+{
+    arenachunk_t *next;
+};
+
+// Blocks in a chunk start after the chunk header, kept to a whole
+// granule so that every block stays aligned.
+
+#define ARENA_CHUNK_HEADER \
+    ((sizeof(arenachunk_t) + ARENA_GRANULE - 1) & ~(ARENA_GRANULE - 1))
+
+typedef struct
+{
+    arenachunk_t *chunks;               // in use this level
+    arenachunk_t *spare;                // left over from earlier levels
+    byte *bump;
+    byte *bump_end;
+    memblock_t *free_blocks[ARENA_NUM_CLASSES];
+    memblock_t *large;
+} arena_t;
+
+static arena_t arenas[PU_NUM_TAGS];
+
+#define Z_IsArenaTag(tag) ((tag) == PU_LEVEL || (tag) == PU_LEVSPEC)
+
+// Statistics, kept per tag and per call site. A call site is the
+// file and line of the Z_Malloc, or of the last Z_ChangeTag, along
+// with the tag the block has now. Sizes are those asked for, not
+// counting headers or rounding.
+
+typedef struct
+{
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+    int live_blocks;
+    unsigned int allocs;
+    unsigned int frees;
+    unsigned int evictions;
+} zonestats_t;
+
+typedef struct
+{
+    const char *file; // NULL for an unused slot
+    int line;
+    int tag;
+    zonestats_t stats;
+} zonesite_t;
+
+// Open addressing table of call sites. Once it is three quarters
+// full, further sites are counted in the extra slots at the end, one
+// for each tag.
+
+#define MAX_ZONE_SITES 2048
+
+static zonestats_t tag_stats[PU_NUM_TAGS];
+static zonesite_t zone_sites[MAX_ZONE_SITES + PU_NUM_TAGS];
+static int num_zone_sites;
+
+static const char *tag_names[PU_NUM_TAGS] =
+{
+    "none", "PU_STATIC", "PU_SOUND", "PU_MUSIC", "PU_FREE",
+    "PU_LEVEL", "PU_LEVSPEC", "PU_PURGELEVEL", "PU_CACHE",
+};
 
 #ifdef TESTING
 
@@ -96,6 +192,10 @@ static void Z_InsertBlock(memblock_t *block)
     {
         block->next->prev = block;
     }
+    else
+    {
+        allocated_tails[block->tag] = block;
+    }
 }
 
 // Remove a block from its linked list.
@@ -119,6 +219,12 @@ static void Z_RemoveBlock(memblock_t *block)
     {
         block->next->prev = block->prev;
     }
+    else
+    {
+        // End of list
+
+        allocated_tails[block->tag] = block->prev;
+    }
 }
 
 //
@@ -127,9 +233,292 @@ static void Z_RemoveBlock(memblock_t *block)
 void Z_Init (void)
 {
     memset(allocated_blocks, 0, sizeof(allocated_blocks));
+    memset(allocated_tails, 0, sizeof(allocated_tails));
+    memset(arenas, 0, sizeof(arenas));
+    memset(tag_stats, 0, sizeof(tag_stats));
+    memset(zone_sites, 0, sizeof(zone_sites));
+    num_zone_sites = 0;
     printf("zone memory: Using native C allocator.\n");
 }
 
+static boolean ClearCache(int size);
+
+static int Z_FindSite(const char *file, int line, int tag)
+{
+    zonesite_t *site;
+    unsigned int i;
+
+    i = ((unsigned int) (uintptr_t) file * 31 + line * 8 + tag)
+      & (MAX_ZONE_SITES - 1);
+
+    for (;;)
+    {
+        site = &zone_sites[i];
+
+        if (site->file == NULL)
+        {
+            break;
+        }
+
+        if (site->file == file && site->line == line && site->tag == tag)
+        {
+            return i;
+        }
+
+        i = (i + 1) & (MAX_ZONE_SITES - 1);
+    }
+
+    if (num_zone_sites >= MAX_ZONE_SITES * 3 / 4)
+    {
+        i = MAX_ZONE_SITES + tag;
+        site = &zone_sites[i];
+        file = "(other)";
+        line = 0;
+    }
+    else
+    {
+        ++num_zone_sites;
+    }
+
+    site->file = file;
+    site->line = line;
+    site->tag = tag;
+
+    return i;
+}
+
+static void Z_AddLive(zonestats_t *stats, int size)
+{
+    stats->live_bytes += size;
+    ++stats->live_blocks;
+
+    if (stats->live_bytes > stats->peak_bytes)
+    {
+        stats->peak_bytes = stats->live_bytes;
+    }
+}
+
+static void Z_RemoveLive(zonestats_t *stats, int size)
+{
+    stats->live_bytes -= size;
+    --stats->live_blocks;
+}
+
+static void Z_CountAlloc(memblock_t *block, const char *file, int line)
+{
+    block->site = Z_FindSite(file, line, block->tag);
+
+    Z_AddLive(&tag_stats[block->tag], block->size);
+    Z_AddLive(&zone_sites[block->site].stats, block->size);
+    ++tag_stats[block->tag].allocs;
+    ++zone_sites[block->site].stats.allocs;
+}
+
+static void Z_CountFree(memblock_t *block)
+{
+    Z_RemoveLive(&tag_stats[block->tag], block->size);
+    Z_RemoveLive(&zone_sites[block->site].stats, block->size);
+    ++tag_stats[block->tag].frees;
+    ++zone_sites[block->site].stats.frees;
+}
+
+// Everything with the given tag has been freed at once.
+
+static void Z_CountFreeTag(int tag)
+{
+    zonestats_t *stats;
+    int i;
+
+    for (i = 0; i < MAX_ZONE_SITES + PU_NUM_TAGS; ++i)
+    {
+        if (zone_sites[i].file != NULL && zone_sites[i].tag == tag)
+        {
+            stats = &zone_sites[i].stats;
+            stats->frees += stats->live_blocks;
+            stats->live_blocks = 0;
+            stats->live_bytes = 0;
+        }
+    }
+
+    stats = &tag_stats[tag];
+    stats->frees += stats->live_blocks;
+    stats->live_blocks = 0;
+    stats->live_bytes = 0;
+}
+
+// malloc(), emptying the cache as needed to make room.
+
+static void *Z_SystemMalloc(int size)
+{
+    void *result;
+
+    for (;;)
+    {
+        result = malloc(size);
+
+        if (result != NULL)
+        {
+            return result;
+        }
+
+        if (!ClearCache(size))
+        {
+            I_Error("Z_Malloc: failed on allocation of %i bytes", size);
+        }
+    }
+}
+
+// Size class of an arena block, or -1 if it is too big for one.
+
+static int Z_ArenaClass(int size)
+{
+    int total;
+
+    total = sizeof(memblock_t) + size;
+
+    if (total > ARENA_MAX_SMALL)
+    {
+        return -1;
+    }
+
+    return (total + ARENA_GRANULE - 1) / ARENA_GRANULE - 1;
+}
+
+static memblock_t *Z_ArenaMalloc(arena_t *arena, int size)
+{
+    memblock_t *block;
+    arenachunk_t *chunk;
+    int total;
+    int cls;
+
+    cls = Z_ArenaClass(size);
+
+    if (cls < 0)
+    {
+        block = Z_SystemMalloc(sizeof(memblock_t) + size);
+        block->kind = ZK_LARGE;
+
+        block->prev = NULL;
+        block->next = arena->large;
+
+        if (block->next != NULL)
+        {
+            block->next->prev = block;
+        }
+
+        arena->large = block;
+
+        return block;
+    }
+
+    // Reuse a freed block of the same class if there is one.
+
+    block = arena->free_blocks[cls];
+
+    if (block != NULL)
+    {
+        arena->free_blocks[cls] = block->next;
+        block->kind = ZK_SMALL;
+
+        return block;
+    }
+
+    total = (cls + 1) * ARENA_GRANULE;
+
+    if (arena->bump + total > arena->bump_end)
+    {
+        // Start a new chunk, reusing one from an earlier level if
+        // possible. The tail of the old chunk is lost.
+
+        if (arena->spare != NULL)
+        {
+            chunk = arena->spare;
+            arena->spare = chunk->next;
+        }
+        else
+        {
+            chunk = Z_SystemMalloc(ARENA_CHUNK_HEADER + ARENA_CHUNK_SIZE);
+        }
+
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+
+        arena->bump = (byte *) chunk + ARENA_CHUNK_HEADER;
+        arena->bump_end = arena->bump + ARENA_CHUNK_SIZE;
+    }
+
+    block = (memblock_t *) arena->bump;
+    arena->bump += total;
+    block->kind = ZK_SMALL;
+
+    return block;
+}
+
+static void Z_ArenaFree(memblock_t *block)
+{
+    arena_t *arena;
+    int cls;
+
+    arena = &arenas[block->tag];
+
+    if (block->kind == ZK_LARGE)
+    {
+        if (block->prev == NULL)
+        {
+            arena->large = block->next;
+        }
+        else
+        {
+            block->prev->next = block->next;
+        }
+
+        if (block->next != NULL)
+        {
+            block->next->prev = block->prev;
+        }
+
+        free(block);
+    }
+    else
+    {
+        cls = Z_ArenaClass(block->size);
+
+        // Catch double frees, as the block will not be
+        // returned to the system.
+
+        block->id = 0;
+        block->tag = PU_FREE;
+        block->next = arena->free_blocks[cls];
+        arena->free_blocks[cls] = block;
+    }
+}
+
+// Release every block in an arena at once.
+
+static void Z_ResetArena(arena_t *arena)
+{
+    arenachunk_t *chunk;
+    memblock_t *block;
+
+    while (arena->chunks != NULL)
+    {
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        chunk->next = arena->spare;
+        arena->spare = chunk;
+    }
+
+    while (arena->large != NULL)
+    {
+        block = arena->large;
+        arena->large = block->next;
+        free(block);
+    }
+
+    arena->bump = arena->bump_end = NULL;
+    memset(arena->free_blocks, 0, sizeof(arena->free_blocks));
+}
+
 
 //
 // Z_Free
@@ -145,6 +534,14 @@ void Z_Free (void* ptr)
         I_Error ("Z_Free: freed a pointer without ZONEID");
     }
 		
+    Z_CountFree(block);
+
+    if (block->kind != ZK_MALLOC)
+    {
+        Z_ArenaFree(block);
+        return;
+    }
+
     if (block->tag != PU_FREE && block->user != NULL)
     {
         // clear the user's mark
@@ -170,7 +567,11 @@ static boolean ClearCache(int size)
     memblock_t *next_block;
     int remaining;
 
-    block = allocated_blocks[PU_CACHE];
+    // Start from the end of the PU_CACHE list.  The blocks at the end
+    // of the list are the ones that have been free for longer and
+    // are more likely to be unneeded now.
+
+    block = allocated_tails[PU_CACHE];
 
     if (block == NULL)
     {
@@ -179,15 +580,6 @@ static boolean ClearCache(int size)
         return false;
     }
 
-    // Search to the end of the PU_CACHE list.  The blocks at the end
-    // of the list are the ones that have been free for longer and
-    // are more likely to be unneeded now.
-
-    while (block->next != NULL)
-    {
-        block = block->next;
-    }
-
     // Search backwards through the list freeing blocks until we have
     // freed the amount of memory required.
 
@@ -208,6 +600,10 @@ static boolean ClearCache(int size)
 
         remaining -= block->size;
 
+        Z_CountFree(block);
+        ++tag_stats[block->tag].evictions;
+        ++zone_sites[block->site].stats.evictions;
+
         if (block->user)
         {
             *block->user = NULL;
@@ -226,7 +622,7 @@ static boolean ClearCache(int size)
 // You can pass a NULL user if the tag is < PU_PURGELEVEL.
 //
 
-void *Z_Malloc(int size, int tag, void *user)
+void *Z_Malloc2(int size, int tag, void *user, const char *file, int line)
 {
     memblock_t *newblock;
     unsigned char *data;
@@ -243,32 +639,29 @@ void *Z_Malloc(int size, int tag, void *user)
         I_Error ("Z_Malloc: an owner is required for purgable blocks");
     }
 
-    // Malloc a block of the required size
-    
-    newblock = NULL;
-
-    while (newblock == NULL)
+    if (user == NULL && Z_IsArenaTag(tag))
     {
-        newblock = (memblock_t *) malloc(sizeof(memblock_t) + size);
-
-        if (newblock == NULL)
-        {
-            if (!ClearCache(sizeof(memblock_t) + size))
-            {
-                I_Error("Z_Malloc: failed on allocation of %i bytes", size);
-            }
-        }
+        newblock = Z_ArenaMalloc(&arenas[tag], size);
+        newblock->tag = tag;
     }
+    else
+    {
+        // Malloc a block of the required size
 
-    newblock->tag = tag;
-    
-    // Hook into the linked list for this tag type
+        newblock = (memblock_t *) Z_SystemMalloc(sizeof(memblock_t) + size);
+        newblock->kind = ZK_MALLOC;
+        newblock->tag = tag;
+
+        // Hook into the linked list for this tag type
+
+        Z_InsertBlock(newblock);
+    }
 
     newblock->id = ZONEID;
     newblock->user = user;
     newblock->size = size;
 
-    Z_InsertBlock(newblock);
+    Z_CountAlloc(newblock, file, line);
 
     data = (unsigned char *) newblock;
     result = data + sizeof(memblock_t);
@@ -304,6 +697,8 @@ void Z_FreeTags(int lowtag, int hightag)
 
             // Free this block
 
+            Z_CountFree(block);
+
             if (block->user != NULL)
             {
                 *block->user = NULL;
@@ -319,6 +714,16 @@ void Z_FreeTags(int lowtag, int hightag)
 	// This chain is empty now
 
 	allocated_blocks[i] = NULL;
+	allocated_tails[i] = NULL;
+
+        if (Z_IsArenaTag(i))
+        {
+            Z_ResetArena(&arenas[i]);
+
+            // Whatever was left lived in the arena.
+
+            Z_CountFreeTag(i);
+        }
     }
 }
 
@@ -454,11 +859,31 @@ void Z_ChangeTag2(void *ptr, int tag, const char *file, int line)
         I_Error("%s:%i: Z_ChangeTag: an owner is required "
                 "for purgable blocks", file, line);
 
+    if (block->kind != ZK_MALLOC)
+    {
+        // Level arena blocks are released with their arena.
+
+        if (tag != block->tag)
+            I_Error("%s:%i: Z_ChangeTag: cannot move a level arena "
+                    "block to another tag", file, line);
+
+        return;
+    }
+
     // Remove the block from its current list, and rehook it into
     // its new list.
 
     Z_RemoveBlock(block);
+
+    Z_RemoveLive(&tag_stats[block->tag], block->size);
+    Z_RemoveLive(&zone_sites[block->site].stats, block->size);
+
     block->tag = tag;
+    block->site = Z_FindSite(file, line, tag);
+
+    Z_AddLive(&tag_stats[block->tag], block->size);
+    Z_AddLive(&zone_sites[block->site].stats, block->size);
+
     Z_InsertBlock(block);
 }
 
@@ -473,6 +898,11 @@ void Z_ChangeUser(void *ptr, void **user)
         I_Error("Z_ChangeUser: Tried to change user for invalid block!");
     }
 
+    if (block->kind != ZK_MALLOC)
+    {
+        I_Error("Z_ChangeUser: level arena blocks cannot have an owner");
+    }
+
     block->user = user;
     *user = ptr;
 }
@@ -494,3 +924,148 @@ unsigned int Z_ZoneSize(void)
     return 0;
 }
 
+//
+// Z_GetStatsJSON
+//
+
+static char *stats_json = NULL;
+static size_t stats_json_len;
+static size_t stats_json_size = 0;
+
+static void StatsPrintf(const char *fmt, ...) PRINTF_ATTR(1, 2);
+
+static void StatsPrintf(const char *fmt, ...)
+{
+    va_list args;
+    int len;
+
+    for (;;)
+    {
+        va_start(args, fmt);
+        len = vsnprintf(stats_json + stats_json_len,
+                        stats_json_size - stats_json_len, fmt, args);
+        va_end(args);
+
+        if (len >= 0 && stats_json_len + len < stats_json_size)
+        {
+            stats_json_len += len;
+            return;
+        }
+
+        stats_json_size = stats_json_size ? 2 * stats_json_size : 16384;
+        stats_json = I_Realloc(stats_json, stats_json_size);
+    }
+}
+
+// File names may hold backslashes, or anything else.
+
+static void PrintString(const char *s)
+{
+    StatsPrintf("\"");
+
+    for (; *s != '\0'; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            StatsPrintf("\\%c", *s);
+        }
+        else if ((unsigned char) *s < 0x20)
+        {
+            StatsPrintf("\\u%04x", (unsigned char) *s);
+        }
+        else
+        {
+            StatsPrintf("%c", *s);
+        }
+    }
+
+    StatsPrintf("\"");
+}
+
+static void PrintStats(const zonestats_t *stats)
+{
+    StatsPrintf("\"live_bytes\": %" PRIu64 ", \"peak_bytes\": %" PRIu64
+                ", \"live_blocks\": %i, \"allocs\": %u, \"frees\": %u"
+                ", \"evictions\": %u",
+                stats->live_bytes, stats->peak_bytes, stats->live_blocks,
+                stats->allocs, stats->frees, stats->evictions);
+}
+
+// Biggest users first.
+
+static int CompareSites(const void *a, const void *b)
+{
+    const zonesite_t *sa = &zone_sites[*(const int *) a];
+    const zonesite_t *sb = &zone_sites[*(const int *) b];
+
+    if (sa->stats.live_bytes != sb->stats.live_bytes)
+    {
+        return sa->stats.live_bytes > sb->stats.live_bytes ? -1 : 1;
+    }
+
+    if (sa->stats.peak_bytes != sb->stats.peak_bytes)
+    {
+        return sa->stats.peak_bytes > sb->stats.peak_bytes ? -1 : 1;
+    }
+
+    return *(const int *) a - *(const int *) b;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char *Z_GetStatsJSON(void)
+{
+    static int order[MAX_ZONE_SITES + PU_NUM_TAGS];
+    const zonesite_t *site;
+    int count;
+    int i;
+
+    stats_json_len = 0;
+    StatsPrintf("{\n  \"tags\": [\n");
+
+    for (i = PU_STATIC; i < PU_NUM_TAGS; ++i)
+    {
+        StatsPrintf("    { \"tag\": \"%s\", ", tag_names[i]);
+        PrintStats(&tag_stats[i]);
+        StatsPrintf(" }%s\n", i < PU_NUM_TAGS - 1 ? "," : "");
+    }
+
+    StatsPrintf("  ],\n  \"sites\": [\n");
+
+    count = 0;
+
+    for (i = 0; i < MAX_ZONE_SITES + PU_NUM_TAGS; ++i)
+    {
+        if (zone_sites[i].file != NULL)
+        {
+            order[count++] = i;
+        }
+    }
+
+    qsort(order, count, sizeof(*order), CompareSites);
+
+    for (i = 0; i < count; ++i)
+    {
+        site = &zone_sites[order[i]];
+
+        StatsPrintf("    { \"file\": ");
+        PrintString(site->file);
+        StatsPrintf(", \"line\": %i, \"tag\": \"%s\", ",
+                    site->line, tag_names[site->tag]);
+        PrintStats(&site->stats);
+        StatsPrintf(" }%s\n", i < count - 1 ? "," : "");
+    }
+
+    StatsPrintf("  ]\n}\n");
+
+    return stats_json;
+}
+
+//
+// Z_DumpStats
+//
+
+void Z_DumpStats(void)
+{
+    fputs(Z_GetStatsJSON(), stdout);
+    fflush(stdout);
+}
@@ -51,7 +51,7 @@ enum
         
 
 void	Z_Init (void);
-void*	Z_Malloc (int size, int tag, void *ptr);
+void*	Z_Malloc2 (int size, int tag, void *ptr, const char *file, int line);
 void    Z_Free (void *ptr);
 void    Z_FreeTags (int lowtag, int hightag);
 void    Z_DumpHeap (int lowtag, int hightag);
@@ -62,6 +62,11 @@ void    Z_ChangeUser(void *ptr, void **user);
 int     Z_FreeMemory (void);
 unsigned int Z_ZoneSize(void);
 
+// Allocation statistics, per tag and per call site, as JSON.
+// The string is overwritten by the next call.
+const char *Z_GetStatsJSON(void);
+void    Z_DumpStats (void);
+
 //
 // This is used to get the local FILE:LINE info from CPP
 // prior to really call the function in question.
@@ -69,5 +74,8 @@ unsigned int Z_ZoneSize(void);
 #define Z_ChangeTag(p,t)                                       \
     Z_ChangeTag2((p), (t), __FILE__, __LINE__)
 
+#define Z_Malloc(s,t,p)                                        \
+    Z_Malloc2((s), (t), (p), __FILE__, __LINE__)
+
 
 #endif
@@ -0,0 +1,218 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Pack a WAD into one with each lump compressed on its own, which
+//	the game reads in place of the original (see w_file_lz4.c):
+//
+//	    wadpack input.wad output.wad
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "i_swap.h"
+#include "m_lz4.h"
+#include "w_wad.h"
+
+static void Error(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    fprintf(stderr, "wadpack: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+
+    exit(1);
+}
+
+static void *Alloc(size_t size)
+{
+    void *result;
+
+    result = malloc(size > 0 ? size : 1);
+
+    if (result == NULL)
+    {
+        Error("out of memory allocating %lu bytes", (unsigned long) size);
+    }
+
+    return result;
+}
+
+static void ReadAt(FILE *fp, long offset, void *buffer, size_t len)
+{
+    if (fseek(fp, offset, SEEK_SET) != 0
+     || fread(buffer, 1, len, fp) != len)
+    {
+        Error("failed to read %lu bytes at %ld",
+              (unsigned long) len, offset);
+    }
+}
+
+static void Write(FILE *fp, const void *buffer, size_t len)
+{
+    if (fwrite(buffer, 1, len, fp) != len)
+    {
+        Error("failed to write output");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    wadinfo_t header;
+    lz4wadinfo_t outheader;
+    filelump_t *fileinfo;
+    lz4filelump_t *outinfo;
+    FILE *in, *out;
+    byte *data, *packed, *check;
+    long filepos;
+    unsigned long totalsize, totalcsize;
+    int numlumps;
+    int size, csize;
+    int i;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s input.wad output.wad\n", argv[0]);
+        return 1;
+    }
+
+    in = fopen(argv[1], "rb");
+
+    if (in == NULL)
+    {
+        Error("couldn't open %s", argv[1]);
+    }
+
+    // The directory, read as W_AddFile does.
+
+    ReadAt(in, 0, &header, sizeof(header));
+
+    if (strncmp(header.identification, "IWAD", 4)
+     && strncmp(header.identification, "PWAD", 4))
+    {
+        Error("%s doesn't have IWAD or PWAD id", argv[1]);
+    }
+
+    numlumps = LONG(header.numlumps);
+
+    if (numlumps < 0)
+    {
+        Error("%s has a bad directory", argv[1]);
+    }
+
+    fileinfo = Alloc(numlumps * sizeof(filelump_t));
+    ReadAt(in, LONG(header.infotableofs), fileinfo,
+           numlumps * sizeof(filelump_t));
+
+    out = fopen(argv[2], "wb");
+
+    if (out == NULL)
+    {
+        Error("couldn't open %s", argv[2]);
+    }
+
+    // The lumps follow the header, in directory order, and the
+    // directory comes last.
+
+    memset(&outheader, 0, sizeof(outheader));
+    Write(out, &outheader, sizeof(outheader));
+    filepos = sizeof(outheader);
+
+    outinfo = Alloc(numlumps * sizeof(lz4filelump_t));
+    totalsize = totalcsize = 0;
+
+    for (i = 0; i < numlumps; ++i)
+    {
+        size = LONG(fileinfo[i].size);
+
+        if (size < 0)
+        {
+            Error("lump %d of %s has a bad size", i, argv[1]);
+        }
+
+        data = Alloc(size);
+        packed = Alloc(M_LZ4_BOUND(size));
+        ReadAt(in, LONG(fileinfo[i].filepos), data, size);
+
+        // Store lumps that do not get smaller as they are.
+
+        csize = M_LZ4Compress(data, size, packed, size - 1);
+
+        if (csize > 0)
+        {
+            check = Alloc(size);
+
+            if (M_LZ4Decompress(packed, csize, check, size) != size
+             || memcmp(check, data, size))
+            {
+                Error("lump %d of %s did not survive compression",
+                      i, argv[1]);
+            }
+
+            free(check);
+            Write(out, packed, csize);
+        }
+        else
+        {
+            csize = size;
+            Write(out, data, size);
+        }
+
+        outinfo[i].filepos = LONG(filepos);
+        outinfo[i].csize = LONG(csize);
+        outinfo[i].size = LONG(size);
+        memcpy(outinfo[i].name, fileinfo[i].name, sizeof(outinfo[i].name));
+
+        filepos += csize;
+        totalsize += size;
+        totalcsize += csize;
+
+        free(data);
+        free(packed);
+    }
+
+    Write(out, outinfo, numlumps * sizeof(lz4filelump_t));
+
+    memcpy(outheader.magic, LZ4WAD_MAGIC, sizeof(outheader.magic));
+    memcpy(outheader.identification, header.identification,
+           sizeof(outheader.identification));
+    outheader.numlumps = LONG(numlumps);
+    outheader.infotableofs = LONG(filepos);
+
+    if (fseek(out, 0, SEEK_SET) != 0)
+    {
+        Error("failed to write output");
+    }
+
+    Write(out, &outheader, sizeof(outheader));
+
+    if (fclose(out) != 0)
+    {
+        Error("failed to write output");
+    }
+
+    fclose(in);
+
+    printf("%s: %d lumps, %lu bytes packed into %lu\n",
+           argv[2], numlumps, totalsize, totalcsize);
+
+    free(fileinfo);
+    free(outinfo);
+
+    return 0;
+}